@@ -160,6 +160,8 @@ __INLINE void wait_for_interrupt(void)
 static __INLINE __ASM uint32_t __REV16(uint32_t value)
 {
 rev16 r0, r0 bx lr}
+/* Reverse bit order (32 bit) */
+#define __RBIT		__rbit
 /* Breakpoint */
 #define __BKPT	__bkpt
 #elif defined(__GNUC__)
@@ -204,6 +206,14 @@ uint32_t __REV16(uint32_t value)
     return result;
 }
 
+static inline __attribute__ ((always_inline))
+uint32_t __RBIT(uint32_t value)
+{
+    uint32_t result;
+    __asm__ volatile ("rbit %0, %1":"=r" (result):"r"(value));
+    return result;
+}
+
 static inline __attribute__ ((always_inline))
 void __BKPT(void)
 {
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CORTEX_M4_ITM_REGS_H
+#define CORTEX_M4_ITM_REGS_H
+
+#include "soc-core.h"
+
+/* The Instrumentation Trace Macrocell (ITM) generates trace packets from
+ * software writes to its 32 stimulus port registers. The packets are sent
+ * through the Trace Port Interface Unit (TPIU), which is used here in
+ * asynchronous mode, on the Serial Wire Output (SWO) pin, with the
+ * TPIU formatter bypassed.
+ *
+ * Reading a stimulus port register returns 1 when its FIFO can accept a
+ * new write. A write of 1, 2 or 4 bytes produces a 1, 2 or 4 bytes payload
+ * instrumentation packet.
+ * The ITM registers are only writable once trace is enabled in the DEMCR
+ * register (TRCENA), and the ITM unlocked through its Lock Access register.
+ */
+
+#define TPIU_BASE               ((uint32_t) 0xE0040000) /* Trace Port Interface Unit Base Address */
+
+/*** ITM registers ***/
+/* (RW)  ITM stimulus port n register (ITM_STIMn) */
+#define r_CORTEX_M_ITM_STIM(n)  REG_ADDR(ITM_BASE + (uint32_t)0x000 + ((uint32_t)(n) << 2))
+/* (RW Privileged)  ITM trace enable register (ITM_TER) */
+#define r_CORTEX_M_ITM_TER      REG_ADDR(ITM_BASE + (uint32_t)0xE00)
+/* (RW Privileged)  ITM trace privilege register (ITM_TPR) */
+#define r_CORTEX_M_ITM_TPR      REG_ADDR(ITM_BASE + (uint32_t)0xE40)
+/* (RW Privileged)  ITM trace control register (ITM_TCR) */
+#define r_CORTEX_M_ITM_TCR      REG_ADDR(ITM_BASE + (uint32_t)0xE80)
+/* (WO Privileged)  ITM lock access register (ITM_LAR) */
+#define r_CORTEX_M_ITM_LAR      REG_ADDR(ITM_BASE + (uint32_t)0xFB0)
+
+/* (RW Privileged)  Debug exception and monitor control register (DEMCR) */
+#define r_CORTEX_M_DEMCR        REG_ADDR(CoreDebug_BASE + (uint32_t)0x0C)
+
+/*** TPIU registers ***/
+/* (RW Privileged)  Current parallel port size register (TPIU_CSPSR) */
+#define r_CORTEX_M_TPIU_CSPSR   REG_ADDR(TPIU_BASE + (uint32_t)0x004)
+/* (RW Privileged)  Asynchronous clock prescaler register (TPIU_ACPR) */
+#define r_CORTEX_M_TPIU_ACPR    REG_ADDR(TPIU_BASE + (uint32_t)0x010)
+/* (RW Privileged)  Selected pin protocol register (TPIU_SPPR) */
+#define r_CORTEX_M_TPIU_SPPR    REG_ADDR(TPIU_BASE + (uint32_t)0x0F0)
+/* (RW Privileged)  Formatter and flush control register (TPIU_FFCR) */
+#define r_CORTEX_M_TPIU_FFCR    REG_ADDR(TPIU_BASE + (uint32_t)0x304)
+
+/*** ITM stimulus port n register (ITM_STIMn), read access ***/
+/* Bit 0 FIFOREADY: the stimulus port can accept a new write */
+#define ITM_STIM_FIFOREADY_Pos  0
+#define ITM_STIM_FIFOREADY_Msk  ((uint32_t)0x01 << ITM_STIM_FIFOREADY_Pos)
+
+/*** ITM trace control register (ITM_TCR) ***/
+/* Bit 23 BUSY: the ITM is currently processing events */
+#define ITM_TCR_BUSY_Pos        23
+#define ITM_TCR_BUSY_Msk        ((uint32_t)0x01 << ITM_TCR_BUSY_Pos)
+/* Bits 22:16 TraceBusID: ATB identifier of the ITM trace stream */
+#define ITM_TCR_TRACEBUSID_Pos  16
+#define ITM_TCR_TRACEBUSID_Msk  ((uint32_t)0x7f << ITM_TCR_TRACEBUSID_Pos)
+/* Bit 3 TXENA: forward the DWT packets to the ITM */
+#define ITM_TCR_TXENA_Pos       3
+#define ITM_TCR_TXENA_Msk       ((uint32_t)0x01 << ITM_TCR_TXENA_Pos)
+/* Bit 2 SYNCENA: synchronization packets generation */
+#define ITM_TCR_SYNCENA_Pos     2
+#define ITM_TCR_SYNCENA_Msk     ((uint32_t)0x01 << ITM_TCR_SYNCENA_Pos)
+/* Bit 1 TSENA: local timestamps generation */
+#define ITM_TCR_TSENA_Pos       1
+#define ITM_TCR_TSENA_Msk       ((uint32_t)0x01 << ITM_TCR_TSENA_Pos)
+/* Bit 0 ITMENA: ITM enable */
+#define ITM_TCR_ITMENA_Pos      0
+#define ITM_TCR_ITMENA_Msk      ((uint32_t)0x01 << ITM_TCR_ITMENA_Pos)
+
+/*** ITM lock access register (ITM_LAR) ***/
+#define ITM_LAR_UNLOCK          ((uint32_t)0xC5ACCE55)
+
+/*** Debug exception and monitor control register (DEMCR) ***/
+/* Bit 24 TRCENA: DWT and ITM units enable */
+#define DEMCR_TRCENA_Pos        24
+#define DEMCR_TRCENA_Msk        ((uint32_t)0x01 << DEMCR_TRCENA_Pos)
+
+/*** Asynchronous clock prescaler register (TPIU_ACPR) ***/
+/* Bits 12:0 PRESCALER: SWO baudrate is TRACECLKIN / (PRESCALER + 1) */
+#define TPIU_ACPR_PRESCALER_Pos 0
+#define TPIU_ACPR_PRESCALER_Msk ((uint32_t)0x1fff << TPIU_ACPR_PRESCALER_Pos)
+
+/*** Selected pin protocol register (TPIU_SPPR) ***/
+/* Bits 1:0 TXMODE: trace port protocol */
+#define TPIU_SPPR_TXMODE_Pos    0
+#define TPIU_SPPR_TXMODE_Msk    ((uint32_t)0x03 << TPIU_SPPR_TXMODE_Pos)
+#define TPIU_SPPR_TXMODE_PARALLEL       0
+#define TPIU_SPPR_TXMODE_MANCHESTER     1
+#define TPIU_SPPR_TXMODE_NRZ            2
+
+/*** Formatter and flush control register (TPIU_FFCR) ***/
+/* Bit 8 TrigIn: trigger on trigger event (the only reset value bit) */
+#define TPIU_FFCR_TRIGIN_Pos    8
+#define TPIU_FFCR_TRIGIN_Msk    ((uint32_t)0x01 << TPIU_FFCR_TRIGIN_Pos)
+/* Bit 1 EnFCont: continuous formatting, to be cleared to bypass the
+ * formatter (ITM only trace on SWO) */
+#define TPIU_FFCR_ENFCONT_Pos   1
+#define TPIU_FFCR_ENFCONT_Msk   ((uint32_t)0x01 << TPIU_FFCR_ENFCONT_Pos)
+
+#endif /* CORTEX_M4_ITM_REGS_H */
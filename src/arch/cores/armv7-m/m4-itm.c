@@ -0,0 +1,76 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "m4-itm.h"
+#include "m4-itm-regs.h"
+#include "m4-cpu.h"
+#include "regutils.h"
+
+void core_itm_init(uint32_t prescaler, uint32_t ports)
+{
+    /* enable the trace units and unlock the ITM registers */
+    set_reg_bits(r_CORTEX_M_DEMCR, DEMCR_TRCENA_Msk);
+    write_reg_value(r_CORTEX_M_ITM_LAR, ITM_LAR_UNLOCK);
+    /* stop the ITM while configuring the TPIU */
+    write_reg_value(r_CORTEX_M_ITM_TCR, 0);
+    core_itm_wait_idle();
+
+    /* 1 bit port, SWO in NRZ (UART) mode, no formatter */
+    write_reg_value(r_CORTEX_M_TPIU_CSPSR, 1);
+    write_reg_value(r_CORTEX_M_TPIU_SPPR, TPIU_SPPR_TXMODE_NRZ);
+    set_reg(r_CORTEX_M_TPIU_ACPR, prescaler, TPIU_ACPR_PRESCALER);
+    write_reg_value(r_CORTEX_M_TPIU_FFCR, TPIU_FFCR_TRIGIN_Msk);
+
+    /* stimulus ports are accessible from privileged mode only */
+    write_reg_value(r_CORTEX_M_ITM_TPR, 0);
+    write_reg_value(r_CORTEX_M_ITM_TCR,
+                    ((uint32_t)1 << ITM_TCR_TRACEBUSID_Pos) |
+                    ITM_TCR_SYNCENA_Msk | ITM_TCR_ITMENA_Msk);
+    write_reg_value(r_CORTEX_M_ITM_TER, ports);
+    full_memory_barrier();
+}
+
+void core_itm_wait_idle(void)
+{
+    while (read_reg_value(r_CORTEX_M_ITM_TCR) & ITM_TCR_BUSY_Msk) {
+        continue;
+    }
+}
+
+void core_itm_release(void)
+{
+    core_itm_wait_idle();
+    write_reg_value(r_CORTEX_M_ITM_TER, 0);
+    write_reg_value(r_CORTEX_M_ITM_TCR, 0);
+    full_memory_barrier();
+}
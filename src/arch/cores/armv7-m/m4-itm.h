@@ -0,0 +1,88 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CORTEX_M4_ITM_H
+#define CORTEX_M4_ITM_H
+
+#include "types.h"
+#include "regutils.h"
+#include "m4-itm-regs.h"
+
+/**
+ * core_itm_init - Initialize the ITM and the TPIU for SWO output
+ * @prescaler: SWO baudrate prescaler (TRACECLKIN / baudrate - 1)
+ * @ports: mask of the stimulus ports to enable
+ */
+void core_itm_init(uint32_t prescaler, uint32_t ports);
+
+/**
+ * core_itm_wait_idle - Wait for the pending ITM packets to be sent
+ */
+void core_itm_wait_idle(void);
+
+/**
+ * core_itm_release - Disable the ITM stimulus ports, once idle
+ */
+void core_itm_release(void);
+
+/*
+ * Stimulus ports writes: each write only waits for the stimulus port FIFO
+ * to be ready, which is immediate unless the SWO output is saturated.
+ * The port must have been enabled by core_itm_init(), as a disabled port
+ * never gets ready.
+ */
+static inline void core_itm_write_u8(uint8_t port, uint8_t val)
+{
+    while ((read_reg_value(r_CORTEX_M_ITM_STIM(port)) & ITM_STIM_FIFOREADY_Msk) == 0) {
+        continue;
+    }
+    *(volatile uint8_t *)r_CORTEX_M_ITM_STIM(port) = val;
+}
+
+static inline void core_itm_write_u16(uint8_t port, uint16_t val)
+{
+    while ((read_reg_value(r_CORTEX_M_ITM_STIM(port)) & ITM_STIM_FIFOREADY_Msk) == 0) {
+        continue;
+    }
+    *(volatile uint16_t *)r_CORTEX_M_ITM_STIM(port) = val;
+}
+
+static inline void core_itm_write_u32(uint8_t port, uint32_t val)
+{
+    while ((read_reg_value(r_CORTEX_M_ITM_STIM(port)) & ITM_STIM_FIFOREADY_Msk) == 0) {
+        continue;
+    }
+    write_reg_value(r_CORTEX_M_ITM_STIM(port), val);
+}
+
+#endif /* CORTEX_M4_ITM_H */
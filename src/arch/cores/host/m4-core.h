@@ -0,0 +1 @@
+../armv7-m/m4-core.h
\ No newline at end of file
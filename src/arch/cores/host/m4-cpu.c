@@ -0,0 +1,86 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "m4-cpu.h"
+#include "soc-host.h"
+
+static void *core_psp = NULL;
+static void *core_msp = NULL;
+static uint32_t core_primask = 0;
+
+void core_write_psp(void *ptr)
+{
+    core_psp = ptr;
+}
+
+void core_write_msp(void *ptr)
+{
+    core_msp = ptr;
+}
+
+void *core_read_psp(void)
+{
+    return core_psp;
+}
+
+void *core_read_msp(void)
+{
+    return core_msp;
+}
+
+void enable_irq(void)
+{
+    core_primask = 0;
+    soc_host_irq_check();
+}
+
+void disable_irq(void)
+{
+    core_primask = 1;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return core_primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+    core_primask = priMask & 1;
+    soc_host_irq_check();
+}
+
+void wait_for_interrupt(void)
+{
+    soc_host_wfi();
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef M4_CPU
+#define M4_CPU
+
+#include "types.h"
+
+/*
+ * Host build of the Cortex-M4 core helpers. The host has a single stack:
+ * the stack pointers are virtual registers, written and read back by the
+ * loader but never loaded in the host CPU. The interrupts are delivered by
+ * the simulated SoC (see soc-host.h), when PRIMASK is cleared.
+ */
+
+void core_write_psp(void *ptr);
+
+void core_write_msp(void *ptr);
+
+void *core_read_psp(void);
+
+void *core_read_msp(void);
+
+void enable_irq(void);
+
+void disable_irq(void);
+
+uint32_t __get_PRIMASK(void);
+
+void __set_PRIMASK(uint32_t priMask);
+
+void wait_for_interrupt(void);
+
+__INLINE void full_memory_barrier(void)
+{
+    __sync_synchronize();
+}
+
+
+__INLINE void __NOP(void)
+{
+}
+
+__INLINE void __ISB(void)
+{
+    __sync_synchronize();
+}
+
+__INLINE void __DSB(void)
+{
+    __sync_synchronize();
+}
+
+__INLINE void __DMB(void)
+{
+    __sync_synchronize();
+}
+
+__INLINE uint32_t __REV(uint32_t value)
+{
+    return __builtin_bswap32(value);
+}
+
+__INLINE uint32_t __REV16(uint32_t value)
+{
+    return ((value & 0x00ff00ff) << 8) | ((value >> 8) & 0x00ff00ff);
+}
+
+__INLINE uint32_t __RBIT(uint32_t value)
+{
+    value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+    value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+    value = ((value >> 4) & 0x0f0f0f0f) | ((value & 0x0f0f0f0f) << 4);
+    return __builtin_bswap32(value);
+}
+
+__INLINE void __BKPT(void)
+{
+    __builtin_trap();
+}
+
+#endif                          /*!M4_CPU */
@@ -0,0 +1 @@
+../armv7-m/m4-systick-regs.h
\ No newline at end of file
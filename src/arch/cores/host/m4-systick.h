@@ -0,0 +1 @@
+../armv7-m/m4-systick.h
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-dbgmcu.h
\ No newline at end of file
@@ -0,0 +1,757 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "autoconf.h"
+#include "regutils.h"
+#include "soc-core.h"
+#include "soc-rcc.h"
+#include "soc-rng.h"
+#include "soc-scb.h"
+#include "soc-gpio.h"
+#include "soc-usart-regs.h"
+#include "soc-interrupts.h"
+#include "soc-nvic.h"
+#include "m4-cpu.h"
+#include "soc-bkpsram.h"
+#include "flash_regs.h"
+#include "soc-host.h"
+
+/*
+ * Simulated memory areas, mapped at their SoC addresses. The flash is not
+ * executable: calling the next stage faults, which ends the run.
+ */
+typedef struct {
+    const char *name;
+    uint32_t base;
+    uint32_t size;
+    uint8_t reset;          /* content at reset */
+} host_area_t;
+
+#define HOST_FLASH_BASE         0x08000000
+#define HOST_FLASH_SIZE         0x00200000
+#define HOST_FLASH_BANK2_BASE   0x08100000
+#define HOST_SYSMEM_BASE        0x1ffe0000
+#define HOST_SYSMEM_SIZE        0x00020000
+
+static const host_area_t host_areas[] = {
+    { "flash",              HOST_FLASH_BASE,  HOST_FLASH_SIZE,  0xff },
+    /* OTP area and option bytes */
+    { "system memory",      HOST_SYSMEM_BASE, HOST_SYSMEM_SIZE, 0xff },
+    /* APB1, APB2, AHB1 (including the Backup SRAM) */
+    { "peripherals",        PERIPH_BASE,      0x00080000,       0x00 },
+    { "AHB2 peripherals",   AHB2PERIPH_BASE,  0x00061000,       0x00 },
+    { "Cortex-M system",    ITM_BASE,         0x00100000,       0x00 }
+};
+
+/*
+ * Peripheral registers blocks, counting the register accesses made through
+ * the regutils.h helpers.
+ */
+typedef struct {
+    const char *name;
+    uint32_t base;
+    uint32_t size;
+    uint64_t reads;
+    uint64_t writes;
+} host_block_t;
+
+/* index of the USART blocks in host_blocks[] */
+#define HOST_BLOCK_USART_APB2   5
+#define HOST_BLOCK_USART_APB1   6
+
+static host_block_t host_blocks[] = {
+    { "FLASH",              FLASH_CTRL,      0x400,  0, 0 },
+    { "RCC",                RCC_BASE,        0x400,  0, 0 },
+    { "PWR",                PWR_BASE,        0x400,  0, 0 },
+    { "GPIO",               GPIOA_BASE,      0x2400, 0, 0 },
+    { "SYSCFG/EXTI",        SYSCFG_BASE,     0x800,  0, 0 },
+    { "USART1/USART6",      USART1_BASE,     0x800,  0, 0 },
+    { "USART2-UART5",       USART2_BASE,     0x1000, 0, 0 },
+    { "CRC",                0x40023000,      0x400,  0, 0 },
+    { "DMA",                0x40026000,      0x800,  0, 0 },
+    { "HASH",               0x50060400,      0x400,  0, 0 },
+    { "RNG",                0x50060800,      0x400,  0, 0 },
+    { "ITM",                ITM_BASE,        0x1000, 0, 0 },
+    { "DWT",                0xe0001000,      0x1000, 0, 0 },
+    { "SysTick/NVIC/SCB",   SCS_BASE,        0x1000, 0, 0 }
+};
+
+static const char *const host_event_names[HOST_EVENTS] = {
+    "flash unlocks",
+    "flash option unlocks",
+    "flash option programs",
+    "flash locked writes",
+    "flash sector erases",
+    "flash bank erases",
+    "flash erased bytes",
+    "flash programmed words",
+    "flash interrupts",
+    "RNG words",
+    "cycle counter reads",
+    "console bytes"
+};
+
+/* the bank 2 is always modeled, whatever the flash configuration is */
+#ifndef FLASH_CR_MER1_Msk
+# define FLASH_CR_MER1_Msk      ((uint32_t)1 << 15)
+#endif
+
+#define r_DWT_CTRL      REG_ADDR(0xe0001000)
+#define r_DWT_CYCCNT    REG_ADDR(0xe0001004)
+
+static struct {
+    uint64_t cycles;
+    uint64_t dwt_origin;
+    uint64_t events[HOST_EVENTS];
+    uint32_t rng_state;
+    /* flash registers state not held by the registers themselves */
+    uint64_t flash_busy_until;
+    uint32_t flash_polls;
+    uint32_t flash_sr;
+    uint32_t flash_cr;
+    uint32_t flash_optcr;
+    uint32_t flash_key;
+    uint32_t flash_optkey;
+    uint32_t flash_fault_addr;
+    uint32_t flash_fault_bits;
+    uint32_t dfu_button;
+    /* NVIC enabled interrupts (IRQ 0 to 31) */
+    uint32_t nvic_enabled;
+    bool in_irq;
+    const char *flash_out;
+    const char *bkpsram_out;
+} host;
+
+/*
+ * Run end
+ */
+static void host_report(int fd, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void host_report(int fd, const char *fmt, ...)
+{
+    char line[128];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len > (int)sizeof(line) - 1) {
+        len = sizeof(line) - 1;
+    }
+    if (len > 0 && write(fd, line, len) < 0) {
+        /* nothing more to report to */
+    }
+}
+
+static void host_dump(const char *path, uint32_t base, uint32_t size)
+{
+    int fd;
+
+    if (path == NULL) {
+        return;
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, (void *)(uintptr_t)base, size) != (ssize_t)size) {
+        host_report(2, "[host] unable to write %s\n", path);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void soc_host_exit(int status, const char *reason)
+{
+    uint32_t i;
+
+    host_report(2, "\n[host] %s (exit status %d)\n", reason, status);
+    host_report(2, "[host] %-24s %20llu\n", "cycles",
+                (unsigned long long)host.cycles);
+    for (i = 0; i < HOST_EVENTS; i++) {
+        host_report(2, "[host] %-24s %20llu\n", host_event_names[i],
+                    (unsigned long long)host.events[i]);
+    }
+    for (i = 0; i < (sizeof(host_blocks) / sizeof(host_blocks[0])); i++) {
+        host_report(2, "[host] %-24s %9llu R %9llu W\n", host_blocks[i].name,
+                    (unsigned long long)host_blocks[i].reads,
+                    (unsigned long long)host_blocks[i].writes);
+    }
+    host_dump(host.flash_out, HOST_FLASH_BASE, HOST_FLASH_SIZE);
+    host_dump(host.bkpsram_out, BKPSRAM_BASE, BKPSRAM_SIZE);
+    _exit(status);
+}
+
+uint64_t soc_host_cycles(void)
+{
+    return host.cycles;
+}
+
+uint64_t soc_host_events(host_event_t event)
+{
+    return (event < HOST_EVENTS) ? host.events[event] : 0;
+}
+
+void soc_host_flash_fault(uint32_t addr, uint32_t bits)
+{
+    host.flash_fault_addr = addr;
+    host.flash_fault_bits = bits;
+}
+
+/*
+ * Peripherals models
+ */
+static host_block_t *host_block(volatile const uint32_t *reg)
+{
+    uint32_t addr = (uint32_t)(uintptr_t)reg;
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(host_blocks) / sizeof(host_blocks[0])); i++) {
+        if (addr >= host_blocks[i].base &&
+            addr < (host_blocks[i].base + host_blocks[i].size)) {
+            return &host_blocks[i];
+        }
+    }
+    return NULL;
+}
+
+/* xorshift32, deterministic for a given seed */
+static uint32_t host_rng_next(void)
+{
+    uint32_t x = host.rng_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    host.rng_state = x;
+    return x;
+}
+
+/* flash sector geometry (in each bank): 4 x 16KB, 1 x 64KB, 7 x 128KB */
+static uint32_t host_flash_sector_offset(uint8_t sector)
+{
+    if (sector < 4) {
+        return sector * 0x4000;
+    }
+    if (sector == 4) {
+        return 0x10000;
+    }
+    return 0x20000 * (sector - 4);
+}
+
+/*
+ * write protection of the bank 1 sectors (OPTCR nWRP bit cleared), the
+ * option bytes being applied at once
+ */
+static bool host_flash_write_protected(uint32_t addr)
+{
+    uint8_t sector = 11;
+
+    if (addr < HOST_FLASH_BASE || addr >= HOST_FLASH_BANK2_BASE) {
+        return false;
+    }
+    while (host_flash_sector_offset(sector) > (addr - HOST_FLASH_BASE)) {
+        sector--;
+    }
+    return !(host.flash_optcr & ((uint32_t)1 << (FLASH_OPTCR_nWRP_Pos + sector)));
+}
+
+/*
+ * A flash operation runs in background, BSY being set until its end. It
+ * ends when the clock reaches its end time, or when the CPU waits for it:
+ * busy wait (consecutive status register reads) or WFI.
+ */
+static void host_flash_busy(uint64_t cycles)
+{
+    host.flash_busy_until = host.cycles + cycles;
+    host.flash_sr |= FLASH_SR_BSY_Msk;
+    *r_CORTEX_M_FLASH_SR = host.flash_sr;
+}
+
+static void host_flash_wait(void)
+{
+    if ((host.flash_sr & FLASH_SR_BSY_Msk) && host.cycles < host.flash_busy_until) {
+        host.cycles = host.flash_busy_until;
+    }
+}
+
+static void host_flash_update(void)
+{
+    if ((host.flash_sr & FLASH_SR_BSY_Msk) && host.cycles >= host.flash_busy_until) {
+        host.flash_sr &= ~FLASH_SR_BSY_Msk;
+        /* end of operation flag, only set with its interrupt enabled */
+        if (host.flash_cr & FLASH_CR_EOPIE_Msk) {
+            host.flash_sr |= FLASH_SR_EOP_Msk;
+        }
+        *r_CORTEX_M_FLASH_SR = host.flash_sr;
+    }
+}
+
+static void host_flash_erase(uint32_t addr, uint32_t size, uint64_t cycles)
+{
+    memset((void *)(uintptr_t)addr, 0xff, size);
+    host.events[HOST_FLASH_ERASED_BYTES] += size;
+    host_flash_busy(cycles);
+}
+
+static void host_flash_start(uint32_t cr)
+{
+    uint8_t snb = (cr & FLASH_CR_SNB_Msk) >> FLASH_CR_SNB_Pos;
+    uint8_t sector = snb & 0xf;
+    uint32_t bank = (snb & 0x10) ? HOST_FLASH_BANK2_BASE : HOST_FLASH_BASE;
+    uint32_t size;
+
+    if (host.flash_sr & FLASH_SR_BSY_Msk) {
+        /* the running operation is not interrupted */
+        return;
+    }
+    if (cr & (FLASH_CR_MER_Msk | FLASH_CR_MER1_Msk)) {
+        /* both banks at once: they are erased in parallel */
+        if (cr & FLASH_CR_MER_Msk) {
+            host_flash_erase(HOST_FLASH_BASE, HOST_FLASH_SIZE / 2,
+                             SOC_HOST_ERASE_BANK_CYCLES);
+            host.events[HOST_FLASH_BANK_ERASE]++;
+        }
+        if (cr & FLASH_CR_MER1_Msk) {
+            host_flash_erase(HOST_FLASH_BANK2_BASE, HOST_FLASH_SIZE / 2,
+                             SOC_HOST_ERASE_BANK_CYCLES);
+            host.events[HOST_FLASH_BANK_ERASE]++;
+        }
+    } else if ((cr & FLASH_CR_SER_Msk) && sector < 12 &&
+               host_flash_write_protected(bank + host_flash_sector_offset(sector))) {
+        host.flash_sr |= FLASH_SR_WRPERR_Msk;
+        *r_CORTEX_M_FLASH_SR = host.flash_sr;
+    } else if ((cr & FLASH_CR_SER_Msk) && sector < 12) {
+        size = (sector < 4) ? 0x4000 : ((sector == 4) ? 0x10000 : 0x20000);
+        host_flash_erase(bank + host_flash_sector_offset(sector), size,
+                         (size == 0x4000) ? SOC_HOST_ERASE_16K_CYCLES :
+                         ((size == 0x10000) ? SOC_HOST_ERASE_64K_CYCLES :
+                          SOC_HOST_ERASE_128K_CYCLES));
+        host.events[HOST_FLASH_SECTOR_ERASE]++;
+    } else {
+        /* invalid operation: programming sequence error */
+        host.flash_sr |= FLASH_SR_PGSERR_Msk;
+        *r_CORTEX_M_FLASH_SR = host.flash_sr;
+    }
+}
+
+static void host_flash_cr_write(void)
+{
+    uint32_t cr = *r_CORTEX_M_FLASH_CR;
+
+    if (host.flash_cr & FLASH_CR_LOCK_Msk) {
+        /* write ignored when locked */
+        *r_CORTEX_M_FLASH_CR = host.flash_cr;
+        host.events[HOST_FLASH_LOCKED_WRITE]++;
+        return;
+    }
+    if (cr & FLASH_CR_STRT_Msk) {
+        host_flash_start(cr);
+        cr &= ~FLASH_CR_STRT_Msk;
+        *r_CORTEX_M_FLASH_CR = cr;
+    }
+    host.flash_cr = cr;
+}
+
+static void host_flash_optcr_write(void)
+{
+    uint32_t optcr = *r_CORTEX_M_FLASH_OPTCR;
+
+    if (host.flash_optcr & FLASH_OPTCR_OPTLOCK_Msk) {
+        *r_CORTEX_M_FLASH_OPTCR = host.flash_optcr;
+        host.events[HOST_FLASH_LOCKED_WRITE]++;
+        return;
+    }
+    if (optcr & FLASH_OPTCR_OPTSTRT_Msk) {
+        optcr &= ~FLASH_OPTCR_OPTSTRT_Msk;
+        *r_CORTEX_M_FLASH_OPTCR = optcr;
+        host.events[HOST_FLASH_OPT_PROGRAM]++;
+    }
+    host.flash_optcr = optcr;
+}
+
+/* KEY1 then KEY2 unlocks, any other sequence leaves the register locked */
+static void host_flash_key_write(uint32_t key, uint32_t *state,
+                                 uint32_t key1, uint32_t key2,
+                                 volatile uint32_t *reg, uint32_t *shadow,
+                                 uint32_t lock, host_event_t event)
+{
+    if (key == key1) {
+        *state = key1;
+        return;
+    }
+    if (key == key2 && *state == key1 && (*shadow & lock)) {
+        *shadow &= ~lock;
+        *reg = *shadow;
+        host.events[event]++;
+    }
+    *state = 0;
+}
+
+static void host_usart_write(volatile const uint32_t *reg, uint32_t base,
+                             uint32_t fck)
+{
+    volatile uint32_t *brr = REG_ADDR(base + 0x08);
+    volatile uint32_t *cr1 = REG_ADDR(base + 0x0c);
+    uint32_t div;
+    char c;
+
+    if (reg != REG_ADDR(base + 0x04)) {
+        return;
+    }
+    c = (char)*reg;
+    if (write(1, &c, 1) < 0) {
+        /* console output lost */
+    }
+    host.events[HOST_CONSOLE_BYTE]++;
+    /* frame duration: 10 bits at fck / USARTDIV */
+    if (*cr1 & USART_CR1_OVER8_Msk) {
+        div = ((*brr >> 4) * 8) + (*brr & 0x7);
+    } else {
+        div = *brr;
+    }
+    host.cycles += (10ULL * div * PROD_CORE_FREQUENCY * 1000) / fck;
+}
+
+/*
+ * Interrupts: the flash interrupt is the only one modeled. Its line is
+ * level sensitive, and the interrupt is taken when enabled in the NVIC,
+ * with PRIMASK cleared, at the next register access (or WFI, or interrupts
+ * unmasking).
+ */
+#define HOST_FLASH_IRQ_NUM      (FLASH_IRQ - 0x10)
+#define HOST_IRQ_STORM          1024
+
+/* loader interrupt handlers (only linked with the asynchronous flash) */
+void flash_irq_handler(void) __attribute__((weak));
+
+static bool host_flash_irq_line(void)
+{
+    return ((host.flash_sr & FLASH_SR_EOP_Msk) &&
+            (host.flash_cr & FLASH_CR_EOPIE_Msk)) ||
+           ((host.flash_sr & FLASH_SR_OPERR_Msk) &&
+            (host.flash_cr & FLASH_CR_ERRIE_Msk));
+}
+
+void soc_host_irq_check(void)
+{
+    uint32_t n = 0;
+
+    host_flash_update();
+    if (host.in_irq || __get_PRIMASK() || flash_irq_handler == NULL) {
+        return;
+    }
+    host.in_irq = true;
+    while (host_flash_irq_line() &&
+           (host.nvic_enabled & ((uint32_t)1 << HOST_FLASH_IRQ_NUM))) {
+        if (++n > HOST_IRQ_STORM) {
+            soc_host_exit(SOC_HOST_EXIT_STALL, "flash interrupt never cleared");
+        }
+        host.events[HOST_FLASH_IRQ]++;
+        flash_irq_handler();
+    }
+    host.in_irq = false;
+}
+
+void soc_host_wfi(void)
+{
+    host_flash_wait();
+    soc_host_irq_check();
+}
+
+void soc_host_reg_read(volatile const uint32_t *reg)
+{
+    host_block_t *block = host_block(reg);
+
+    if (block != NULL) {
+        block->reads++;
+    }
+    if (reg == r_CORTEX_M_FLASH_SR) {
+        /* the CPU busy waits for the end of the running operation */
+        if (host.flash_polls++ > 0) {
+            host_flash_wait();
+        }
+        host_flash_update();
+        return;
+    }
+    host.flash_polls = 0;
+    if (reg == r_DWT_CYCCNT) {
+        host.cycles += SOC_HOST_DWT_READ_CYCLES;
+        if (*r_DWT_CTRL & 1) {
+            *r_DWT_CYCCNT = (uint32_t)(host.cycles - host.dwt_origin);
+        }
+        host.events[HOST_DWT_READ]++;
+    } else if (reg == r_CORTEX_M_RNG_DR) {
+        if (*r_CORTEX_M_RNG_CR & RNG_CR_RNGEN_Msk) {
+            *r_CORTEX_M_RNG_DR = host_rng_next();
+            host.cycles += SOC_HOST_RNG_CYCLES;
+            host.events[HOST_RNG_WORD]++;
+        }
+    } else if (reg == GPIO_IDR(GPIOE_BASE)) {
+        /* INFO: DFU button on GPIO E4 (Wookey board) */
+        *GPIO_IDR(GPIOE_BASE) = host.dfu_button << 4;
+    }
+    soc_host_irq_check();
+}
+
+void soc_host_reg_write(volatile const uint32_t *reg)
+{
+    host_block_t *block = host_block(reg);
+    uint32_t val;
+
+    if (block != NULL) {
+        block->writes++;
+    }
+    host.flash_polls = 0;
+    if ((uint32_t)(uintptr_t)reg >= HOST_FLASH_BASE &&
+        (uint32_t)(uintptr_t)reg < (HOST_FLASH_BASE + HOST_FLASH_SIZE)) {
+        /* flash word programming (the host memory keeps a refused word) */
+        if ((host.flash_cr & FLASH_CR_PG_Msk) &&
+            !(host.flash_sr & FLASH_SR_BSY_Msk) &&
+            host_flash_write_protected((uint32_t)(uintptr_t)reg)) {
+            /* no operation started: neither BSY nor EOP */
+            host.flash_sr |= FLASH_SR_WRPERR_Msk;
+            *r_CORTEX_M_FLASH_SR = host.flash_sr;
+        } else if ((host.flash_cr & FLASH_CR_PG_Msk) &&
+                   !(host.flash_sr & FLASH_SR_BSY_Msk)) {
+            host_flash_busy(SOC_HOST_PROGRAM_CYCLES);
+            host.events[HOST_FLASH_PROGRAMMED_WORD]++;
+            if ((uint32_t)(uintptr_t)reg == host.flash_fault_addr) {
+                /* injected fault: bits left erased */
+                *(volatile uint32_t *)reg |= host.flash_fault_bits;
+            }
+        }
+    } else if (reg == r_CORTEX_M_NVIC_ISER0) {
+        host.nvic_enabled |= *r_CORTEX_M_NVIC_ISER0;
+        *r_CORTEX_M_NVIC_ISER0 = host.nvic_enabled;
+        *r_CORTEX_M_NVIC_ICER0 = host.nvic_enabled;
+    } else if (reg == r_CORTEX_M_NVIC_ICER0) {
+        host.nvic_enabled &= ~*r_CORTEX_M_NVIC_ICER0;
+        *r_CORTEX_M_NVIC_ISER0 = host.nvic_enabled;
+        *r_CORTEX_M_NVIC_ICER0 = host.nvic_enabled;
+    } else if (reg == r_CORTEX_M_FLASH_SR) {
+        /* status flags are cleared by writing 1 */
+        host.flash_sr &= ~*r_CORTEX_M_FLASH_SR;
+        *r_CORTEX_M_FLASH_SR = host.flash_sr;
+    } else if (reg == r_CORTEX_M_FLASH_CR) {
+        host_flash_cr_write();
+    } else if (reg == r_CORTEX_M_FLASH_OPTCR) {
+        host_flash_optcr_write();
+    } else if (reg == r_CORTEX_M_FLASH_KEYR) {
+        host_flash_key_write(*r_CORTEX_M_FLASH_KEYR, &host.flash_key,
+                             KEY1, KEY2,
+                             r_CORTEX_M_FLASH_CR, &host.flash_cr,
+                             FLASH_CR_LOCK_Msk, HOST_FLASH_UNLOCK);
+    } else if (reg == r_CORTEX_M_FLASH_OPTKEYR) {
+        host_flash_key_write(*r_CORTEX_M_FLASH_OPTKEYR, &host.flash_optkey,
+                             OPTKEY1, OPTKEY2,
+                             r_CORTEX_M_FLASH_OPTCR, &host.flash_optcr,
+                             FLASH_OPTCR_OPTLOCK_Msk, HOST_FLASH_OPT_UNLOCK);
+    } else if (reg == r_CORTEX_M_RCC_CR) {
+        /* the oscillators and the PLL are immediately ready */
+        val = *r_CORTEX_M_RCC_CR & ~(RCC_CR_HSIRDY | RCC_CR_HSERDY | RCC_CR_PLLRDY);
+        val |= (val & RCC_CR_HSION) ? RCC_CR_HSIRDY : 0;
+        val |= (val & RCC_CR_HSEON) ? RCC_CR_HSERDY : 0;
+        val |= (val & RCC_CR_PLLON) ? RCC_CR_PLLRDY : 0;
+        *r_CORTEX_M_RCC_CR = val;
+    } else if (reg == r_CORTEX_M_RCC_CFGR) {
+        /* the system clock switch is immediate */
+        val = *r_CORTEX_M_RCC_CFGR & ~RCC_CFGR_SWS;
+        *r_CORTEX_M_RCC_CFGR = val | ((val & RCC_CFGR_SW) << 2);
+    } else if (reg == r_CORTEX_M_RNG_CR) {
+        if (*r_CORTEX_M_RNG_CR & RNG_CR_RNGEN_Msk) {
+            *r_CORTEX_M_RNG_SR = RNG_SR_DRDY_Msk;
+        }
+    } else if (reg == r_DWT_CYCCNT) {
+        host.dwt_origin = host.cycles - *r_DWT_CYCCNT;
+    } else if (reg == r_CORTEX_M_SCB_AIRCR) {
+        if ((*r_CORTEX_M_SCB_AIRCR & SCB_AIRCR_SYSRESETREQ_Msk) &&
+            ((*r_CORTEX_M_SCB_AIRCR & SCB_AIRCR_VECTKEY_Msk) >> SCB_AIRCR_VECTKEY_Pos) == 0x5fa) {
+            soc_host_exit(SOC_HOST_EXIT_RESET, "system reset requested");
+        }
+    } else if (block == &host_blocks[HOST_BLOCK_USART_APB2]) {
+        host_usart_write(reg, USART1_BASE, PROD_CLOCK_APB2);
+        host_usart_write(reg, USART6_BASE, PROD_CLOCK_APB2);
+    } else if (block == &host_blocks[HOST_BLOCK_USART_APB1]) {
+        host_usart_write(reg, USART2_BASE, PROD_CLOCK_APB1);
+        host_usart_write(reg, USART3_BASE, PROD_CLOCK_APB1);
+        host_usart_write(reg, UART4_BASE, PROD_CLOCK_APB1);
+        host_usart_write(reg, UART5_BASE, PROD_CLOCK_APB1);
+    }
+    soc_host_irq_check();
+}
+
+/*
+ * Run control
+ */
+static void host_fault(int sig, siginfo_t *info, void *context)
+{
+    ucontext_t *uc = context;
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t addr = (uintptr_t)info->si_addr;
+    char reason[64];
+
+    (void)sig;
+    if (addr == pc && addr >= HOST_FLASH_BASE &&
+        addr < (HOST_FLASH_BASE + HOST_FLASH_SIZE)) {
+        /* instruction fetch in flash: jump to the next boot stage */
+        snprintf(reason, sizeof(reason), "next stage 0x%08lx",
+                 (unsigned long)addr);
+        soc_host_exit(SOC_HOST_EXIT_NEXT_STAGE, reason);
+    }
+    snprintf(reason, sizeof(reason), "fault at 0x%08lx (pc 0x%08lx)",
+             (unsigned long)addr, (unsigned long)pc);
+    soc_host_exit(SOC_HOST_EXIT_FAULT, reason);
+}
+
+static void host_timeout(int sig)
+{
+    (void)sig;
+    soc_host_exit(SOC_HOST_EXIT_STALL, "timeout, the loader is stalled");
+}
+
+static void host_map(const host_area_t *area)
+{
+    void *addr = (void *)(uintptr_t)area->base;
+    void *map;
+
+    map = mmap(addr, area->size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (map != addr) {
+        host_report(2, "[host] unable to map the %s at 0x%08x\n",
+                    area->name, area->base);
+        _exit(SOC_HOST_EXIT_SETUP);
+    }
+    memset(map, area->reset, area->size);
+}
+
+static void host_load_flash(const char *path)
+{
+    ssize_t len;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        host_report(2, "[host] unable to open %s\n", path);
+        _exit(SOC_HOST_EXIT_SETUP);
+    }
+    len = read(fd, (void *)(uintptr_t)HOST_FLASH_BASE, HOST_FLASH_SIZE);
+    close(fd);
+    if (len < 0) {
+        host_report(2, "[host] unable to read %s\n", path);
+        _exit(SOC_HOST_EXIT_SETUP);
+    }
+}
+
+static uint32_t host_env(const char *name, uint32_t def)
+{
+    const char *val = getenv(name);
+
+    return (val != NULL && *val != '\0') ? strtoul(val, NULL, 0) : def;
+}
+
+__attribute__((constructor))
+static void soc_host_init(void)
+{
+    static uint8_t fault_stack[64 * 1024];
+    stack_t ss = { .ss_sp = fault_stack, .ss_size = sizeof(fault_stack) };
+    struct sigaction sa;
+    const char *flash;
+    uint32_t rdp;
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(host_areas) / sizeof(host_areas[0])); i++) {
+        host_map(&host_areas[i]);
+    }
+    flash = getenv("LOADER_HOST_FLASH");
+    if (flash != NULL) {
+        host_load_flash(flash);
+    }
+    host.flash_out = getenv("LOADER_HOST_FLASH_OUT");
+    host.bkpsram_out = getenv("LOADER_HOST_BKPSRAM_OUT");
+
+    /* registers reset values */
+    host.flash_cr = FLASH_CR_LOCK_Msk;
+    *r_CORTEX_M_FLASH_CR = host.flash_cr;
+    switch (host_env("LOADER_HOST_RDP", 0)) {
+        case 0:
+            rdp = 0xaa;
+            break;
+        case 2:
+            rdp = 0xcc;
+            break;
+        default:
+            rdp = 0x55;
+            break;
+    }
+    host.flash_optcr = 0x0fff00ed | (rdp << FLASH_OPTCR_RDP_Pos) |
+                       FLASH_OPTCR_OPTLOCK_Msk;
+    *r_CORTEX_M_FLASH_OPTCR = host.flash_optcr;
+    *_r_CORTEX_M_USART_SR(1) = USART_SR_TXE_Msk | USART_SR_TC_Msk;
+    *_r_CORTEX_M_USART_SR(2) = USART_SR_TXE_Msk | USART_SR_TC_Msk;
+    *_r_CORTEX_M_USART_SR(3) = USART_SR_TXE_Msk | USART_SR_TC_Msk;
+    *_r_CORTEX_M_USART_SR(4) = USART_SR_TXE_Msk | USART_SR_TC_Msk;
+    *_r_CORTEX_M_USART_SR(5) = USART_SR_TXE_Msk | USART_SR_TC_Msk;
+    *_r_CORTEX_M_USART_SR(6) = USART_SR_TXE_Msk | USART_SR_TC_Msk;
+    host.dfu_button = host_env("LOADER_HOST_DFU", 0) ? 1 : 0;
+    *GPIO_IDR(GPIOE_BASE) = host.dfu_button << 4;
+    /* a null xorshift state would stay null */
+    host.rng_state = host_env("LOADER_HOST_RNG_SEED", 0x2545f491);
+    if (host.rng_state == 0) {
+        host.rng_state = 0x2545f491;
+    }
+
+    /* the faults handler runs on its own stack, the loader one moves */
+    sigaltstack(&ss, NULL);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = host_fault;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGBUS, &sa, NULL);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = host_timeout;
+    sa.sa_flags = SA_ONSTACK;
+    sigaction(SIGALRM, &sa, NULL);
+    alarm(host_env("LOADER_HOST_TIMEOUT", 10));
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SOC_HOST_H
+#define SOC_HOST_H
+
+#include "types.h"
+#include "soc-init.h"
+
+/*
+ * Simulated SoC, for the host (x86-64 Linux) build of the loader: make host
+ *
+ * The flash, the system memory (OTP, option bytes), the peripherals and the
+ * Cortex-M system areas are RAM arrays mapped at their SoC addresses, the
+ * loader and the SoC drivers of the target being run unmodified on top of
+ * them. The peripherals side effects (flash erase and locks, RCC ready
+ * flags, RNG data, DWT cycle counter, USART output, system reset) are
+ * modeled when their registers are accessed through the regutils.h helpers.
+ * The flash interrupt is the only one delivered, the other interrupts are
+ * never delivered.
+ *
+ * The time is simulated: the cycle counter only advances with the modeled
+ * peripherals operations (RNG, USART transmission), with each cycle counter
+ * read, and when the CPU waits for the end of a flash operation (busy wait
+ * or WFI), which makes a run, and its benchmark counters, deterministic.
+ * The flash operations (erase, word programming through write_reg_value())
+ * run in background, and overlap with the other modeled operations.
+ *
+ * The simulation is configured by the following environment variables:
+ * - LOADER_HOST_FLASH: flash image, loaded at the flash base address
+ *   (erased flash otherwise)
+ * - LOADER_HOST_FLASH_OUT: flash content dump, at the end of the run
+ * - LOADER_HOST_BKPSRAM_OUT: Backup SRAM content dump, at the end of the run
+ * - LOADER_HOST_DFU: DFU button (GPIO E4) state, 0 (default) or 1
+ * - LOADER_HOST_RDP: flash read protection level, 0 (default), 1 or 2
+ * - LOADER_HOST_RNG_SEED: RNG seed
+ * - LOADER_HOST_TIMEOUT: stall detection timeout, in seconds (default 10)
+ *
+ * The console output is written on the standard output, the run report
+ * (exit reason and benchmark counters) on the standard error. *
+ * The host tests (make tests, see tests/test.h) are linked with the same
+ * objects, the test program replacing the loader main().
+ */
+
+/* run exit statuses */
+#define SOC_HOST_EXIT_NEXT_STAGE    0   /* the next stage has been called */
+#define SOC_HOST_EXIT_SETUP         1   /* simulation setup error */
+#define SOC_HOST_EXIT_RESET         2   /* system reset requested */
+#define SOC_HOST_EXIT_STALL         3   /* no progress before the timeout */
+#define SOC_HOST_EXIT_FAULT         4   /* invalid memory access */
+
+/* simulated duration of the modeled operations, in core cycles */
+#define SOC_HOST_DWT_READ_CYCLES    256
+#define SOC_HOST_RNG_CYCLES         140          /* 40 RNG clock periods */
+#define SOC_HOST_ERASE_16K_CYCLES   (250 * PROD_CORE_FREQUENCY)
+#define SOC_HOST_ERASE_64K_CYCLES   (500 * PROD_CORE_FREQUENCY)
+#define SOC_HOST_ERASE_128K_CYCLES  (1000 * PROD_CORE_FREQUENCY)
+#define SOC_HOST_ERASE_BANK_CYCLES  (8000 * PROD_CORE_FREQUENCY)
+#define SOC_HOST_PROGRAM_CYCLES     ((16 * PROD_CORE_FREQUENCY) / 1000) /* word */
+
+/* modeled operations, counted in the run report */
+typedef enum {
+    HOST_FLASH_UNLOCK,
+    HOST_FLASH_OPT_UNLOCK,
+    HOST_FLASH_OPT_PROGRAM,
+    HOST_FLASH_LOCKED_WRITE,
+    HOST_FLASH_SECTOR_ERASE,
+    HOST_FLASH_BANK_ERASE,
+    HOST_FLASH_ERASED_BYTES,
+    HOST_FLASH_PROGRAMMED_WORD,
+    HOST_FLASH_IRQ,
+    HOST_RNG_WORD,
+    HOST_DWT_READ,
+    HOST_CONSOLE_BYTE,
+    HOST_EVENTS
+} host_event_t;
+
+/**
+ * soc_host_cycles - simulated core cycles since the start of the run
+ */
+uint64_t soc_host_cycles(void);
+
+/**
+ * soc_host_events - number of modeled operations of a kind since the start
+ * of the run
+ */
+uint64_t soc_host_events(host_event_t event);
+
+/**
+ * soc_host_flash_fault - inject a programming fault: the flash word at
+ * @addr keeps its @bits erased when programmed (one faulty word at a time,
+ * @bits 0: no fault)
+ */
+void soc_host_flash_fault(uint32_t addr, uint32_t bits);
+
+/**
+ * soc_host_irq_check - take the pending interrupts, if not masked
+ */
+void soc_host_irq_check(void);
+
+/**
+ * soc_host_wfi - wait for interrupt: wait for the end of the running flash
+ * operation, and take the pending interrupts
+ */
+void soc_host_wfi(void);
+
+/**
+ * soc_host_exit - end the run, printing the report and dumping the memories
+ * @status: SOC_HOST_EXIT_* exit status
+ * @reason: exit reason, printed in the report
+ */
+void soc_host_exit(int status, const char *reason) __attribute__((noreturn));
+
+#endif /* SOC_HOST_H */
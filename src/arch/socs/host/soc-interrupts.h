@@ -0,0 +1 @@
+../stm32f439/soc-interrupts.h
\ No newline at end of file
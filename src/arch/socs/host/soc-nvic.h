@@ -0,0 +1 @@
+../stm32f439/soc-nvic.h
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-pwr.h
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-rcc.h
\ No newline at end of file
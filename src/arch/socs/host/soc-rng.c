@@ -0,0 +1 @@
+../stm32f439/soc-rng.c
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-rng.h
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-usart-regs.h
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-dma.h
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-crc-model.c
\ No newline at end of file
@@ -0,0 +1 @@
+../stm32f439/soc-dma.c
\ No newline at end of file
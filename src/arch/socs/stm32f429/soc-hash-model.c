@@ -0,0 +1 @@
+../stm32f439/soc-hash-model.c
\ No newline at end of file
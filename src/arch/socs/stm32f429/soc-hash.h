@@ -0,0 +1 @@
+../stm32f439/soc-hash.h
\ No newline at end of file
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Register-level software model of the STM32F4 CRC calculation unit:
+ * CRC-32 (polynomial 0x04C11DB7) of 32 bits words, MSB first, without
+ * reflection, the data register being reset to 0xffffffff.
+ *
+ * This allows running the CRC unit driver on targets without CRC unit,
+ * or outside of the target.
+ */
+#include "autoconf.h"
+#include "soc-crc.h"
+
+#ifdef CONFIG_LOADER_CRC32_HW_MODEL
+
+#define CRC_MODEL_POLY                0x04c11db7
+
+static struct {
+    uint32_t dr;
+    uint32_t idr;
+} crc_model = {
+    .dr = CRC_RESET_VALUE,
+    .idr = 0
+};
+
+uint32_t soc_crc_model_read(volatile uint32_t *reg)
+{
+    if (reg == r_CORTEX_M_CRC_DR) {
+        return crc_model.dr;
+    }
+    if (reg == r_CORTEX_M_CRC_IDR) {
+        return crc_model.idr;
+    }
+    /* RESET is a write only bit */
+    return 0;
+}
+
+void soc_crc_model_write(volatile uint32_t *reg, uint32_t value)
+{
+    uint8_t i;
+
+    if (reg == r_CORTEX_M_CRC_DR) {
+        crc_model.dr ^= value;
+        for (i = 0; i < 32; i++) {
+            if (crc_model.dr & 0x80000000) {
+                crc_model.dr = (crc_model.dr << 1) ^ CRC_MODEL_POLY;
+            } else {
+                crc_model.dr <<= 1;
+            }
+        }
+    } else if (reg == r_CORTEX_M_CRC_IDR) {
+        crc_model.idr = value & 0xff;
+    } else if (reg == r_CORTEX_M_CRC_CR) {
+        if (value & CRC_CR_RESET_Msk) {
+            crc_model.dr = CRC_RESET_VALUE;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "autoconf.h"
+#include "regutils.h"
+#include "soc-rcc.h"
+#include "soc-crc.h"
+#ifndef CONFIG_LOADER_CRC32_HW_MODEL
+#include "m4-cpu.h"
+#endif
+
+#if defined(CONFIG_LOADER_CRC32_HW) || defined(CONFIG_LOADER_CRC32_HW_MODEL)
+
+/*
+ * All the CRC unit accesses are made through these accessors, to allow
+ * the use of the register-level software model of the unit. The model
+ * being usable outside of the target, the bit reversal is then made in C.
+ */
+#ifdef CONFIG_LOADER_CRC32_HW_MODEL
+# define crc_read(reg)          soc_crc_model_read(reg)
+# define crc_write(reg, val)    soc_crc_model_write(reg, val)
+
+static uint32_t crc_rbit(uint32_t value)
+{
+    value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+    value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+    value = ((value >> 4) & 0x0f0f0f0f) | ((value & 0x0f0f0f0f) << 4);
+    value = ((value >> 8) & 0x00ff00ff) | ((value & 0x00ff00ff) << 8);
+    return (value >> 16) | (value << 16);
+}
+#else
+# define crc_read(reg)          read_reg_value(reg)
+# define crc_write(reg, val)    write_reg_value(reg, val)
+# define crc_rbit(value)        __RBIT(value)
+#endif
+
+void soc_crc_reset(void)
+{
+#ifndef CONFIG_LOADER_CRC32_HW_MODEL
+    set_reg_bits(r_CORTEX_M_RCC_AHB1ENR, RCC_AHB1ENR_CRCEN);
+#endif
+    crc_write(r_CORTEX_M_CRC_CR, CRC_CR_RESET_Msk);
+}
+
+/*
+ * INFO: the words are pushed by the CPU and not by (memory to memory) DMA:
+ * the unit consumes the words MSB first while the loader CRC32 is
+ * reflected, and the F4 CRC unit has no input bit reversal. Each word has
+ * then to go through RBIT, which the DMA can't do. A word is consumed in 4
+ * AHB cycles, which is the CPU load/rbit/store loop throughput anyway.
+ */
+uint32_t soc_crc_reflected_update(const uint32_t *words, uint32_t nwords)
+{
+    while (nwords > 0) {
+        crc_write(r_CORTEX_M_CRC_DR, crc_rbit(*words));
+        words++;
+        nwords--;
+    }
+    return crc_rbit(crc_read(r_CORTEX_M_CRC_DR));
+}
+
+void soc_crc_release(void)
+{
+#ifndef CONFIG_LOADER_CRC32_HW_MODEL
+    clear_reg_bits(r_CORTEX_M_RCC_AHB1ENR, RCC_AHB1ENR_CRCEN);
+#endif
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SOC_CRC_H
+#define SOC_CRC_H
+
+#include "autoconf.h"
+#include "types.h"
+#include "regutils.h"
+
+/*
+ * CRC calculation unit: CRC-32 (polynomial 0x04C11DB7) of 32 bits words,
+ * MSB first, the data register being reset to 0xffffffff. There is no
+ * input/output bit reversal nor programmable init value on the F4 family.
+ */
+#define CRC_BASE                      ((uint32_t) 0x40023000)
+
+#define r_CORTEX_M_CRC_DR             REG_ADDR(CRC_BASE + (uint32_t) 0x00)
+#define r_CORTEX_M_CRC_IDR            REG_ADDR(CRC_BASE + (uint32_t) 0x04)
+#define r_CORTEX_M_CRC_CR             REG_ADDR(CRC_BASE + (uint32_t) 0x08)
+
+/* CRC control register */
+#define CRC_CR_RESET_Pos              0
+#define CRC_CR_RESET_Msk              ((uint32_t)1 << CRC_CR_RESET_Pos)
+
+#define CRC_RESET_VALUE               0xffffffff
+
+/* Enable the CRC unit and reset its data register to CRC_RESET_VALUE */
+void soc_crc_reset(void);
+
+/*
+ * Push the given (32 bits aligned) little endian words, bit-reversed, to
+ * the CRC unit, and return the bit-reversed data register. This makes the
+ * unit compute the reflected CRC-32 register (as used by the loader, see
+ * crc32.c) of the words content, starting with CRC_RESET_VALUE.
+ */
+uint32_t soc_crc_reflected_update(const uint32_t *words, uint32_t nwords);
+
+void soc_crc_release(void);
+
+#ifdef CONFIG_LOADER_CRC32_HW_MODEL
+/* Software model of the CRC unit registers */
+uint32_t soc_crc_model_read(volatile uint32_t *reg);
+void soc_crc_model_write(volatile uint32_t *reg, uint32_t value);
+#endif
+
+#endif /* SOC_CRC_H */
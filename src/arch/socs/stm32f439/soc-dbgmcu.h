@@ -0,0 +1,70 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SOC_DBGMCU_H
+#define SOC_DBGMCU_H
+
+#include "soc-core.h"
+
+/* MCU debug component (DBGMCU) */
+#define DBGMCU_BASE             ((uint32_t) 0xE0042000)
+
+#define r_CORTEX_M_DBGMCU_IDCODE    REG_ADDR(DBGMCU_BASE + 0x00)
+#define r_CORTEX_M_DBGMCU_CR        REG_ADDR(DBGMCU_BASE + 0x04)
+
+/* Debug MCU configuration register (only reset by a power-on reset) */
+#define DBGMCU_CR_DBG_SLEEP_Pos     0
+#define DBGMCU_CR_DBG_SLEEP_Msk     ((uint32_t)1 << DBGMCU_CR_DBG_SLEEP_Pos)
+#define DBGMCU_CR_DBG_STOP_Pos      1
+#define DBGMCU_CR_DBG_STOP_Msk      ((uint32_t)1 << DBGMCU_CR_DBG_STOP_Pos)
+#define DBGMCU_CR_DBG_STANDBY_Pos   2
+#define DBGMCU_CR_DBG_STANDBY_Msk   ((uint32_t)1 << DBGMCU_CR_DBG_STANDBY_Pos)
+#define DBGMCU_CR_TRACE_IOEN_Pos    5
+#define DBGMCU_CR_TRACE_IOEN_Msk    ((uint32_t)1 << DBGMCU_CR_TRACE_IOEN_Pos)
+#define DBGMCU_CR_TRACE_MODE_Pos    6
+#define DBGMCU_CR_TRACE_MODE_Msk    ((uint32_t)3 << DBGMCU_CR_TRACE_MODE_Pos)
+#	define DBGMCU_CR_TRACE_MODE_ASYNC   0   /* TRACESWO pin only */
+#	define DBGMCU_CR_TRACE_MODE_SYNC_1  1
+#	define DBGMCU_CR_TRACE_MODE_SYNC_2  2
+#	define DBGMCU_CR_TRACE_MODE_SYNC_4  3
+
+/*
+ * Enable the asynchronous trace output: the TRACESWO pin (PB3) is assigned
+ * to the SWO output of the TPIU, whatever its GPIO configuration is
+ */
+void soc_dbgmcu_trace_enable(void);
+
+/* Disable the trace output, the TRACESWO pin going back to its GPIO */
+void soc_dbgmcu_trace_disable(void);
+
+#endif /*!SOC_DBGMCU_H */
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "regutils.h"
+#include "soc-rcc.h"
+#include "soc-dma.h"
+
+static inline volatile uint32_t *dma_isr(uint8_t dma, uint8_t stream)
+{
+    return (stream < 4) ? r_CORTEX_M_DMA_LISR(dma) : r_CORTEX_M_DMA_HISR(dma);
+}
+
+static inline volatile uint32_t *dma_ifcr(uint8_t dma, uint8_t stream)
+{
+    return (stream < 4) ? r_CORTEX_M_DMA_LIFCR(dma) : r_CORTEX_M_DMA_HIFCR(dma);
+}
+
+static inline void dma_clear_flags(uint8_t dma, uint8_t stream)
+{
+    write_reg_value(dma_ifcr(dma, stream), DMA_FLAG_ALL << DMA_FLAG_SHIFT(stream));
+}
+
+bool soc_dma_busy(uint8_t dma, uint8_t stream)
+{
+    return (read_reg_value(r_CORTEX_M_DMA_SxCR(dma, stream)) & DMA_SxCR_EN_Msk) ? true : false;
+}
+
+int soc_dma_start(const soc_dma_xfer_t *xfer)
+{
+    uint32_t cr;
+
+    if (xfer->stream > 7 || xfer->channel > 7) {
+        return -1;
+    }
+    /* only DMA2 is able to handle memory to memory transfers */
+    if (xfer->dma != 2 && (xfer->dma != 1 || xfer->dir == DMA_DIR_MEM_TO_MEM)) {
+        return -1;
+    }
+    set_reg_bits(r_CORTEX_M_RCC_AHB1ENR,
+                 (xfer->dma == 1) ? RCC_AHB1ENR_DMA1EN : RCC_AHB1ENR_DMA2EN);
+    if (soc_dma_busy(xfer->dma, xfer->stream)) {
+        return -1;
+    }
+    dma_clear_flags(xfer->dma, xfer->stream);
+
+    write_reg_value(r_CORTEX_M_DMA_SxPAR(xfer->dma, xfer->stream), xfer->periph);
+    write_reg_value(r_CORTEX_M_DMA_SxM0AR(xfer->dma, xfer->stream), xfer->mem);
+    write_reg_value(r_CORTEX_M_DMA_SxNDTR(xfer->dma, xfer->stream), xfer->count);
+    if (xfer->dir == DMA_DIR_MEM_TO_MEM) {
+        /* direct mode is not allowed in memory to memory mode */
+        write_reg_value(r_CORTEX_M_DMA_SxFCR(xfer->dma, xfer->stream),
+                        DMA_SxFCR_DMDIS_Msk | DMA_SxFCR_FTH_Msk);
+    } else {
+        write_reg_value(r_CORTEX_M_DMA_SxFCR(xfer->dma, xfer->stream), 0);
+    }
+
+    cr = ((uint32_t)xfer->channel << DMA_SxCR_CHSEL_Pos) |
+         ((uint32_t)2 << DMA_SxCR_PL_Pos) |
+         ((uint32_t)xfer->size << DMA_SxCR_MSIZE_Pos) |
+         ((uint32_t)xfer->size << DMA_SxCR_PSIZE_Pos) |
+         ((uint32_t)xfer->dir << DMA_SxCR_DIR_Pos);
+    if (xfer->minc) {
+        cr |= DMA_SxCR_MINC_Msk;
+    }
+    if (xfer->pinc) {
+        cr |= DMA_SxCR_PINC_Msk;
+    }
+    write_reg_value(r_CORTEX_M_DMA_SxCR(xfer->dma, xfer->stream), cr);
+    /* let's go */
+    set_reg_bits(r_CORTEX_M_DMA_SxCR(xfer->dma, xfer->stream), DMA_SxCR_EN_Msk);
+
+    return 0;
+}
+
+int soc_dma_status(uint8_t dma, uint8_t stream)
+{
+    uint32_t flags = read_reg_value(dma_isr(dma, stream)) >> DMA_FLAG_SHIFT(stream);
+
+    if (flags & (DMA_FLAG_TEIF | DMA_FLAG_DMEIF)) {
+        soc_dma_stop(dma, stream);
+        return -1;
+    }
+    if ((flags & DMA_FLAG_TCIF) || !soc_dma_busy(dma, stream)) {
+        dma_clear_flags(dma, stream);
+        return 0;
+    }
+    return 1;
+}
+
+int soc_dma_wait(uint8_t dma, uint8_t stream)
+{
+    int ret;
+
+    do {
+        ret = soc_dma_status(dma, stream);
+    } while (ret == 1);
+
+    return ret;
+}
+
+void soc_dma_stop(uint8_t dma, uint8_t stream)
+{
+    clear_reg_bits(r_CORTEX_M_DMA_SxCR(dma, stream), DMA_SxCR_EN_Msk);
+    /* the stream is effectively disabled once EN is read back as 0 */
+    while (soc_dma_busy(dma, stream)) {
+    };
+    dma_clear_flags(dma, stream);
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SOC_DMA_H
+#define SOC_DMA_H
+
+#include "types.h"
+#include "regutils.h"
+
+/* DMA controllers definitions */
+#define DMA1_BASE                     ((uint32_t) 0x40026000)
+#define DMA2_BASE                     ((uint32_t) 0x40026400)
+
+#define DMA_BASE(dma)                 (((dma) == 1) ? DMA1_BASE : DMA2_BASE)
+
+#define r_CORTEX_M_DMA_LISR(dma)      REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x00)
+#define r_CORTEX_M_DMA_HISR(dma)      REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x04)
+#define r_CORTEX_M_DMA_LIFCR(dma)     REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x08)
+#define r_CORTEX_M_DMA_HIFCR(dma)     REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x0C)
+
+#define r_CORTEX_M_DMA_SxCR(dma, s)   REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x10 + ((uint32_t) 0x18 * (s)))
+#define r_CORTEX_M_DMA_SxNDTR(dma, s) REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x14 + ((uint32_t) 0x18 * (s)))
+#define r_CORTEX_M_DMA_SxPAR(dma, s)  REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x18 + ((uint32_t) 0x18 * (s)))
+#define r_CORTEX_M_DMA_SxM0AR(dma, s) REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x1C + ((uint32_t) 0x18 * (s)))
+#define r_CORTEX_M_DMA_SxM1AR(dma, s) REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x20 + ((uint32_t) 0x18 * (s)))
+#define r_CORTEX_M_DMA_SxFCR(dma, s)  REG_ADDR(DMA_BASE(dma) + (uint32_t) 0x24 + ((uint32_t) 0x18 * (s)))
+
+/* DMA stream x configuration register */
+#define DMA_SxCR_EN_Pos               0
+#define DMA_SxCR_EN_Msk               ((uint32_t)1 << DMA_SxCR_EN_Pos)
+#define DMA_SxCR_DMEIE_Pos            1
+#define DMA_SxCR_DMEIE_Msk            ((uint32_t)1 << DMA_SxCR_DMEIE_Pos)
+#define DMA_SxCR_TEIE_Pos             2
+#define DMA_SxCR_TEIE_Msk             ((uint32_t)1 << DMA_SxCR_TEIE_Pos)
+#define DMA_SxCR_HTIE_Pos             3
+#define DMA_SxCR_HTIE_Msk             ((uint32_t)1 << DMA_SxCR_HTIE_Pos)
+#define DMA_SxCR_TCIE_Pos             4
+#define DMA_SxCR_TCIE_Msk             ((uint32_t)1 << DMA_SxCR_TCIE_Pos)
+#define DMA_SxCR_PFCTRL_Pos           5
+#define DMA_SxCR_PFCTRL_Msk           ((uint32_t)1 << DMA_SxCR_PFCTRL_Pos)
+#define DMA_SxCR_DIR_Pos              6
+#define DMA_SxCR_DIR_Msk              ((uint32_t)3 << DMA_SxCR_DIR_Pos)
+#define DMA_SxCR_CIRC_Pos             8
+#define DMA_SxCR_CIRC_Msk             ((uint32_t)1 << DMA_SxCR_CIRC_Pos)
+#define DMA_SxCR_PINC_Pos             9
+#define DMA_SxCR_PINC_Msk             ((uint32_t)1 << DMA_SxCR_PINC_Pos)
+#define DMA_SxCR_MINC_Pos             10
+#define DMA_SxCR_MINC_Msk             ((uint32_t)1 << DMA_SxCR_MINC_Pos)
+#define DMA_SxCR_PSIZE_Pos            11
+#define DMA_SxCR_PSIZE_Msk            ((uint32_t)3 << DMA_SxCR_PSIZE_Pos)
+#define DMA_SxCR_MSIZE_Pos            13
+#define DMA_SxCR_MSIZE_Msk            ((uint32_t)3 << DMA_SxCR_MSIZE_Pos)
+#define DMA_SxCR_PL_Pos               16
+#define DMA_SxCR_PL_Msk               ((uint32_t)3 << DMA_SxCR_PL_Pos)
+#define DMA_SxCR_CHSEL_Pos            25
+#define DMA_SxCR_CHSEL_Msk            ((uint32_t)7 << DMA_SxCR_CHSEL_Pos)
+
+/* DMA stream x FIFO control register */
+#define DMA_SxFCR_FTH_Pos             0
+#define DMA_SxFCR_FTH_Msk             ((uint32_t)3 << DMA_SxFCR_FTH_Pos)
+#define DMA_SxFCR_DMDIS_Pos           2
+#define DMA_SxFCR_DMDIS_Msk           ((uint32_t)1 << DMA_SxFCR_DMDIS_Pos)
+
+/*
+ * DMA interrupt status flags, for a given stream. Streams 0 to 3 flags are
+ * in LISR/LIFCR, streams 4 to 7 flags are in HISR/HIFCR, at the same
+ * positions.
+ */
+#define DMA_FLAG_SHIFT(s)             (((s) & 0x1 ? 6 : 0) + ((s) & 0x2 ? 16 : 0))
+#define DMA_FLAG_FEIF                 ((uint32_t)1 << 0)
+#define DMA_FLAG_DMEIF                ((uint32_t)1 << 2)
+#define DMA_FLAG_TEIF                 ((uint32_t)1 << 3)
+#define DMA_FLAG_HTIF                 ((uint32_t)1 << 4)
+#define DMA_FLAG_TCIF                 ((uint32_t)1 << 5)
+#define DMA_FLAG_ALL                  (DMA_FLAG_FEIF | DMA_FLAG_DMEIF | DMA_FLAG_TEIF | \
+                                       DMA_FLAG_HTIF | DMA_FLAG_TCIF)
+
+typedef enum {
+    DMA_DIR_PERIPH_TO_MEM = 0,
+    DMA_DIR_MEM_TO_PERIPH = 1,
+    DMA_DIR_MEM_TO_MEM    = 2,
+} dma_dir_t;
+
+typedef enum {
+    DMA_SIZE_BYTE  = 0,
+    DMA_SIZE_HWORD = 1,
+    DMA_SIZE_WORD  = 2,
+} dma_size_t;
+
+/*
+ * A single DMA transfer. In memory to memory mode (DMA2 only), the source
+ * is the peripheral port address.
+ */
+typedef struct {
+    uint8_t     dma;      /* DMA controller (1 or 2) */
+    uint8_t     stream;   /* stream identifier (0 to 7) */
+    uint8_t     channel;  /* channel (request) identifier (0 to 7) */
+    dma_dir_t   dir;
+    dma_size_t  size;     /* both peripheral and memory data size */
+    bool        pinc;     /* peripheral address increment */
+    bool        minc;     /* memory address increment */
+    physaddr_t  periph;
+    physaddr_t  mem;
+    uint16_t    count;    /* number of data items to transfer */
+} soc_dma_xfer_t;
+
+/*
+ * Start the given transfer. Returns 0 on success, -1 if the stream is
+ * already in use.
+ */
+int soc_dma_start(const soc_dma_xfer_t *xfer);
+
+bool soc_dma_busy(uint8_t dma, uint8_t stream);
+
+/*
+ * Returns 1 if the transfer is still ongoing, 0 if it is finished, -1 on
+ * transfer error. Status flags are cleared once the transfer is finished.
+ */
+int soc_dma_status(uint8_t dma, uint8_t stream);
+
+/* Busy wait for the end of the current transfer (same return as above) */
+int soc_dma_wait(uint8_t dma, uint8_t stream);
+
+void soc_dma_stop(uint8_t dma, uint8_t stream);
+
+#endif /* SOC_DMA_H */
@@ -33,6 +33,7 @@
  */
 #include "soc-dwt.h"
 #include "m4-cpu.h"
+#include "regutils.h"
 
 static uint32_t last_dwt = 0;
 
@@ -47,7 +48,7 @@ void soc_dwt_reset_timer(void)
 {
     *SCB_DEMCR = *(uint32_t *) SCB_DEMCR | 0x01000000;
     *LAR = 0xC5ACCE55;
-    *DWT_CYCCNT = 0;   // reset the counter
+    write_reg_value(DWT_CYCCNT, 0);   // reset the counter
     *DWT_CONTROL = 0;
    full_memory_barrier();
 }
@@ -60,12 +61,12 @@ void soc_dwt_start_timer(void)
 
 uint32_t soc_dwt_getcycles(void)
 {
-    return *DWT_CYCCNT;
+    return read_reg_value(DWT_CYCCNT);
 }
 
 uint64_t soc_dwt_getcycles_64(void)
 {
-    uint64_t val = *DWT_CYCCNT;
+    uint64_t val = read_reg_value(DWT_CYCCNT);
     val += cyccnt_loop << 32;
     return val;
 }
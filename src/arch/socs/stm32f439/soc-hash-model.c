@@ -0,0 +1,132 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Register-level software model of the STM32F43x HASH processor, limited to
+ * what the SHA-256 driver (soc-hash.c) uses: SHA-256 algorithm, 8-bit data
+ * type, CPU feeding. The computation itself is made by libecc.
+ *
+ * This allows running the HASH processor driver on targets without HASH
+ * processor, or outside of the target.
+ */
+#include "autoconf.h"
+#include "libsig.h"
+#include "soc-hash.h"
+
+#ifdef CONFIG_LOADER_SHA256_HW_MODEL
+
+static struct {
+    uint32_t cr;
+    uint32_t str;
+    uint32_t sr;
+    uint32_t hr[8];
+    /* the last written word is kept until DCAL, as it may be partial */
+    bool last_valid;
+    uint32_t last;
+    sha256_context sha256_ctx;
+} hash_model;
+
+static void hash_model_push(uint32_t word, uint8_t nbytes)
+{
+    uint8_t bytes[4];
+
+    /* 8-bit data type: bytes are hashed in memory order */
+    bytes[0] = (uint8_t)word;
+    bytes[1] = (uint8_t)(word >> 8);
+    bytes[2] = (uint8_t)(word >> 16);
+    bytes[3] = (uint8_t)(word >> 24);
+    sha256_update(&hash_model.sha256_ctx, bytes, nbytes);
+}
+
+uint32_t soc_hash_model_read(volatile uint32_t *reg)
+{
+    uint32_t offset = (physaddr_t)reg - HASH_BASE;
+
+    if (reg == r_CORTEX_M_HASH_CR) {
+        return hash_model.cr;
+    }
+    if (reg == r_CORTEX_M_HASH_STR) {
+        return hash_model.str;
+    }
+    if (reg == r_CORTEX_M_HASH_SR) {
+        return hash_model.sr;
+    }
+    if ((reg >= r_CORTEX_M_HASH_HR(0)) && (reg <= r_CORTEX_M_HASH_HR(7))) {
+        return hash_model.hr[(offset - 0x310) / sizeof(uint32_t)];
+    }
+    return 0;
+}
+
+void soc_hash_model_write(volatile uint32_t *reg, uint32_t value)
+{
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t nblw;
+    uint8_t i;
+
+    if (reg == r_CORTEX_M_HASH_CR) {
+        /* INIT is a write only bit */
+        hash_model.cr = value & ~HASH_CR_INIT_Msk;
+        if (value & HASH_CR_INIT_Msk) {
+            sha256_init(&hash_model.sha256_ctx);
+            hash_model.last_valid = false;
+            hash_model.str = 0;
+            hash_model.sr = HASH_SR_DINIS_Msk;
+        }
+    } else if (reg == r_CORTEX_M_HASH_DIN) {
+        if (hash_model.last_valid) {
+            hash_model_push(hash_model.last, 4);
+        }
+        hash_model.last = value;
+        hash_model.last_valid = true;
+    } else if (reg == r_CORTEX_M_HASH_STR) {
+        /* DCAL is a write only bit */
+        hash_model.str = value & HASH_STR_NBLW_Msk;
+        if (value & HASH_STR_DCAL_Msk) {
+            nblw = (uint8_t)((hash_model.str & HASH_STR_NBLW_Msk) >> HASH_STR_NBLW_Pos);
+            if (hash_model.last_valid) {
+                hash_model_push(hash_model.last, (nblw == 0) ? 4 : (nblw / 8));
+                hash_model.last_valid = false;
+            }
+            sha256_final(&hash_model.sha256_ctx, digest);
+            for (i = 0; i < 8; i++) {
+                hash_model.hr[i] = ((uint32_t)digest[(4 * i)] << 24) |
+                                   ((uint32_t)digest[(4 * i) + 1] << 16) |
+                                   ((uint32_t)digest[(4 * i) + 2] << 8) |
+                                   ((uint32_t)digest[(4 * i) + 3]);
+            }
+            hash_model.sr |= HASH_SR_DCIS_Msk;
+        }
+    }
+}
+
+#endif
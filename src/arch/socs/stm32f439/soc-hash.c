@@ -0,0 +1,187 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "autoconf.h"
+#include "regutils.h"
+#include "soc-rcc.h"
+#include "soc-dma.h"
+#include "soc-hash.h"
+
+#if defined(CONFIG_LOADER_SHA256_HW) || defined(CONFIG_LOADER_SHA256_HW_MODEL)
+
+/*
+ * All the HASH processor accesses are made through these accessors, to
+ * allow the use of the register-level software model of the processor.
+ */
+#ifdef CONFIG_LOADER_SHA256_HW_MODEL
+# define hash_read(reg)         soc_hash_model_read(reg)
+# define hash_write(reg, val)   soc_hash_model_write(reg, val)
+#else
+# define hash_read(reg)         read_reg_value(reg)
+# define hash_write(reg, val)   write_reg_value(reg, val)
+#endif
+
+void soc_hash_sha256_init(void)
+{
+#ifndef CONFIG_LOADER_SHA256_HW_MODEL
+    set_reg_bits(r_CORTEX_M_RCC_AHB2ENR, RCC_AHB2ENR_HASHEN);
+#endif
+    /* SHA-256, hash mode, bytes (i.e. memory order) data, processor init */
+    hash_write(r_CORTEX_M_HASH_CR,
+               HASH_CR_ALGO_SHA256 | HASH_CR_DATATYPE_8B | HASH_CR_INIT_Msk);
+}
+
+#ifndef CONFIG_LOADER_SHA256_HW_MODEL
+/* a DMA transfer to HASH_DIN is still running when update returns */
+static bool hash_dma_running = false;
+
+/*
+ * Wait for the end of the running DMA transfer, if any, before any other
+ * HASH_DIN write or the digest calculation. Returns -1 on DMA error.
+ */
+static int hash_dma_end(void)
+{
+    int ret;
+
+    if (hash_dma_running == false) {
+        return 0;
+    }
+    ret = soc_dma_wait(HASH_DMA, HASH_DMA_STREAM);
+    hash_write(r_CORTEX_M_HASH_CR, hash_read(r_CORTEX_M_HASH_CR) & ~HASH_CR_DMAE_Msk);
+    hash_dma_running = false;
+
+    return ret;
+}
+
+static int hash_push_dma(const uint32_t *words, uint16_t nwords)
+{
+    int ret;
+    soc_dma_xfer_t xfer = {
+        .dma = HASH_DMA,
+        .stream = HASH_DMA_STREAM,
+        .channel = HASH_DMA_CHANNEL,
+        .dir = DMA_DIR_MEM_TO_PERIPH,
+        .size = DMA_SIZE_WORD,
+        .pinc = false,
+        .minc = true,
+        .periph = (physaddr_t)r_CORTEX_M_HASH_DIN,
+        .mem = (physaddr_t)words,
+        .count = nwords
+    };
+
+    if (hash_dma_end()) {
+        return -1;
+    }
+    /* the DMA stream may be shared with the console (USART1 TX), whose
+     * transfers are asynchronous: wait for the end of such a transfer */
+    soc_dma_wait(HASH_DMA, HASH_DMA_STREAM);
+    /* multiple DMA transfers: the digest calculation is not
+     * automatically started at the end of the transfer */
+    hash_write(r_CORTEX_M_HASH_CR, hash_read(r_CORTEX_M_HASH_CR) | HASH_CR_MDMAT_Msk);
+    hash_write(r_CORTEX_M_HASH_CR, hash_read(r_CORTEX_M_HASH_CR) | HASH_CR_DMAE_Msk);
+    ret = soc_dma_start(&xfer);
+    if (ret == 0) {
+        /* the transfer ends in background, see hash_dma_end() */
+        hash_dma_running = true;
+    } else {
+        hash_write(r_CORTEX_M_HASH_CR, hash_read(r_CORTEX_M_HASH_CR) & ~HASH_CR_DMAE_Msk);
+    }
+
+    return ret;
+}
+#endif
+
+int soc_hash_sha256_update(const uint32_t *words, uint32_t nwords)
+{
+#ifndef CONFIG_LOADER_SHA256_HW_MODEL
+    uint16_t len;
+
+    /* (up to 64K words per DMA transfer) */
+    while (nwords >= HASH_DMA_MIN_WORDS) {
+        len = (nwords > 0xffff) ? 0xffff : (uint16_t)nwords;
+        if (hash_push_dma(words, len)) {
+            return -1;
+        }
+        words += len;
+        nwords -= len;
+    }
+    if ((nwords > 0) && hash_dma_end()) {
+        return -1;
+    }
+#endif
+    /* The bus is stalled when the input FIFO is full, no need to poll */
+    while (nwords > 0) {
+        hash_write(r_CORTEX_M_HASH_DIN, *words);
+        words++;
+        nwords--;
+    }
+    return 0;
+}
+
+int soc_hash_sha256_final(uint32_t last, uint8_t last_len,
+                          uint8_t digest[SOC_HASH_SHA256_DIGEST_SIZE])
+{
+    uint32_t hr;
+    uint8_t i;
+    int ret = 0;
+
+#ifndef CONFIG_LOADER_SHA256_HW_MODEL
+    ret = hash_dma_end();
+#endif
+    if (last_len > 0) {
+        hash_write(r_CORTEX_M_HASH_DIN, last);
+    }
+    /* number of valid bits in the last word (0 means 32) */
+    hash_write(r_CORTEX_M_HASH_STR,
+               (((uint32_t)(last_len & 0x3) * 8) << HASH_STR_NBLW_Pos) | HASH_STR_DCAL_Msk);
+    while (!(hash_read(r_CORTEX_M_HASH_SR) & HASH_SR_DCIS_Msk)) {
+    };
+    /* digest registers hold big endian words */
+    for (i = 0; i < (SOC_HASH_SHA256_DIGEST_SIZE / sizeof(uint32_t)); i++) {
+        hr = hash_read(r_CORTEX_M_HASH_HR(i));
+        digest[(4 * i)]     = (uint8_t)(hr >> 24);
+        digest[(4 * i) + 1] = (uint8_t)(hr >> 16);
+        digest[(4 * i) + 2] = (uint8_t)(hr >> 8);
+        digest[(4 * i) + 3] = (uint8_t)hr;
+    }
+    return ret;
+}
+
+void soc_hash_release(void)
+{
+#ifndef CONFIG_LOADER_SHA256_HW_MODEL
+    clear_reg_bits(r_CORTEX_M_RCC_AHB2ENR, RCC_AHB2ENR_HASHEN);
+#endif
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SOC_HASH_H
+#define SOC_HASH_H
+
+#include "autoconf.h"
+#include "types.h"
+#include "regutils.h"
+
+/*
+ * HASH processor (STM32F43x only)
+ */
+#define HASH_BASE                     ((uint32_t) 0x50060400)
+
+#define r_CORTEX_M_HASH_CR            REG_ADDR(HASH_BASE + (uint32_t) 0x00)
+#define r_CORTEX_M_HASH_DIN           REG_ADDR(HASH_BASE + (uint32_t) 0x04)
+#define r_CORTEX_M_HASH_STR           REG_ADDR(HASH_BASE + (uint32_t) 0x08)
+#define r_CORTEX_M_HASH_IMR           REG_ADDR(HASH_BASE + (uint32_t) 0x20)
+#define r_CORTEX_M_HASH_SR            REG_ADDR(HASH_BASE + (uint32_t) 0x24)
+/* digest registers, HR5 to HR7 are only mapped here (SHA-224/SHA-256) */
+#define r_CORTEX_M_HASH_HR(n)         REG_ADDR(HASH_BASE + (uint32_t) 0x310 + ((uint32_t) 4 * (n)))
+
+/* HASH control register */
+#define HASH_CR_INIT_Pos              2
+#define HASH_CR_INIT_Msk              ((uint32_t)1 << HASH_CR_INIT_Pos)
+#define HASH_CR_DMAE_Pos              3
+#define HASH_CR_DMAE_Msk              ((uint32_t)1 << HASH_CR_DMAE_Pos)
+#define HASH_CR_DATATYPE_Pos          4
+#define HASH_CR_DATATYPE_Msk          ((uint32_t)3 << HASH_CR_DATATYPE_Pos)
+#define HASH_CR_DATATYPE_8B           ((uint32_t)2 << HASH_CR_DATATYPE_Pos)
+#define HASH_CR_MODE_Pos              6
+#define HASH_CR_MODE_Msk              ((uint32_t)1 << HASH_CR_MODE_Pos)
+#define HASH_CR_ALGO0_Pos             7
+#define HASH_CR_ALGO0_Msk             ((uint32_t)1 << HASH_CR_ALGO0_Pos)
+#define HASH_CR_DINNE_Pos             12
+#define HASH_CR_DINNE_Msk             ((uint32_t)1 << HASH_CR_DINNE_Pos)
+#define HASH_CR_MDMAT_Pos             13
+#define HASH_CR_MDMAT_Msk             ((uint32_t)1 << HASH_CR_MDMAT_Pos)
+#define HASH_CR_ALGO1_Pos             18
+#define HASH_CR_ALGO1_Msk             ((uint32_t)1 << HASH_CR_ALGO1_Pos)
+#define HASH_CR_ALGO_SHA256           (HASH_CR_ALGO0_Msk | HASH_CR_ALGO1_Msk)
+
+/* HASH start register */
+#define HASH_STR_NBLW_Pos             0
+#define HASH_STR_NBLW_Msk             ((uint32_t)0x1f << HASH_STR_NBLW_Pos)
+#define HASH_STR_DCAL_Pos             8
+#define HASH_STR_DCAL_Msk             ((uint32_t)1 << HASH_STR_DCAL_Pos)
+
+/* HASH status register */
+#define HASH_SR_DINIS_Pos             0
+#define HASH_SR_DINIS_Msk             ((uint32_t)1 << HASH_SR_DINIS_Pos)
+#define HASH_SR_DCIS_Pos              1
+#define HASH_SR_DCIS_Msk              ((uint32_t)1 << HASH_SR_DCIS_Pos)
+#define HASH_SR_DMAS_Pos              2
+#define HASH_SR_DMAS_Msk              ((uint32_t)1 << HASH_SR_DMAS_Pos)
+#define HASH_SR_BUSY_Pos              3
+#define HASH_SR_BUSY_Msk              ((uint32_t)1 << HASH_SR_BUSY_Pos)
+
+/* HASH_IN DMA request: DMA2, stream 7, channel 2 */
+#define HASH_DMA                      2
+#define HASH_DMA_STREAM               7
+#define HASH_DMA_CHANNEL              2
+
+/* under this number of words, DMA setup is not worth it */
+#define HASH_DMA_MIN_WORDS            64
+
+#define SOC_HASH_SHA256_DIGEST_SIZE   32
+
+/* Initialize the HASH processor for a new SHA-256 computation */
+void soc_hash_sha256_init(void);
+
+/*
+ * Push the given (32 bits aligned) words to the HASH processor. Big enough
+ * buffers are pushed by DMA, the function returning once the transfer is
+ * started: the words must not be modified until the next update or final
+ * call, which waits for the end of the transfer. Returns -1 on DMA error
+ * (of this transfer start, or of the previous transfer).
+ */
+int soc_hash_sha256_update(const uint32_t *words, uint32_t nwords);
+
+/*
+ * Push the last, potentially incomplete, word (last_len bytes long,
+ * 0 to 4) and get back the digest. Returns -1 if the last DMA transfer
+ * failed.
+ */
+int soc_hash_sha256_final(uint32_t last, uint8_t last_len,
+                          uint8_t digest[SOC_HASH_SHA256_DIGEST_SIZE]);
+
+void soc_hash_release(void);
+
+#ifdef CONFIG_LOADER_SHA256_HW_MODEL
+/* Software model of the HASH processor registers */
+uint32_t soc_hash_model_read(volatile uint32_t *reg);
+void soc_hash_model_write(volatile uint32_t *reg, uint32_t value);
+#endif
+
+#endif /* SOC_HASH_H */
@@ -176,8 +176,8 @@ __INLINE uint32_t NVIC_GetPriorityGrouping(void)
 __INLINE void NVIC_EnableIRQ(uint32_t IRQn)
 {
     /*  NVIC->ISER[((uint32_t)(IRQn) >> 5)] = (1 << ((uint32_t)(IRQn) & 0x1F));  enable interrupt */
-    NVIC_ISER[(uint32_t) ((int32_t) IRQn) >> 5] =
-        (uint32_t) (1 << ((uint32_t) ((int32_t) IRQn) & (uint32_t) 0x1F));
+    write_reg_value(&NVIC_ISER[(uint32_t) ((int32_t) IRQn) >> 5],
+        (uint32_t) (1 << ((uint32_t) ((int32_t) IRQn) & (uint32_t) 0x1F)));
 }
 
 /* \brief  Disable External Interrupt
@@ -187,7 +187,7 @@ __INLINE void NVIC_EnableIRQ(uint32_t IRQn)
  */
 __INLINE void NVIC_DisableIRQ(uint32_t IRQn)
 {
-    NVIC_ICER[((uint32_t) (IRQn) >> 5)] = (uint32_t) (1 << ((uint32_t) (IRQn) & 0x1F)); /* disable interrupt */
+    write_reg_value(&NVIC_ICER[((uint32_t) (IRQn) >> 5)], (uint32_t) (1 << ((uint32_t) (IRQn) & 0x1F))); /* disable interrupt */
 }
 
 /* \brief  Get Pending Interrupt
@@ -246,7 +246,7 @@ __INLINE uint32_t NVIC_GetActive(uint32_t IRQn)
 __INLINE void NVIC_SystemReset(void)
 {
     __DSB();                    /* Ensure all outstanding memory accesses included buffered write are completed before reset */
-    *r_CORTEX_M_SCB_AIRCR = ((0x5FA << SCB_AIRCR_VECTKEY_Pos) | (*r_CORTEX_M_SCB_AIRCR & SCB_AIRCR_PRIGROUP_Msk) | SCB_AIRCR_SYSRESETREQ_Msk);  /* Keep priority group unchanged */
+    write_reg_value(r_CORTEX_M_SCB_AIRCR, (0x5FA << SCB_AIRCR_VECTKEY_Pos) | (read_reg_value(r_CORTEX_M_SCB_AIRCR) & SCB_AIRCR_PRIGROUP_Msk) | SCB_AIRCR_SYSRESETREQ_Msk);  /* Keep priority group unchanged */
     __DSB();                    /* Ensure completion of memory access */
     while (1)
         continue;               /* wait until reset */
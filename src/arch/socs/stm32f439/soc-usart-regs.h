@@ -196,8 +196,8 @@
 /* Bit 15 OVER8: Over sampling */
 #define USART_CR1_OVER8_Pos    	15
 #define USART_CR1_OVER8_Msk    	((uint32_t)1 << USART_CR1_OVER8_Pos)
-#define USART_CR1_OVER_S_8   	((uint32_t)0 << USART_CR1_OVER8_Pos)
-#define USART_CR1_OVER_S_16  	((uint32_t)1 << USART_CR1_OVER8_Pos)
+#define USART_CR1_OVER_S_16  	((uint32_t)0 << USART_CR1_OVER8_Pos)
+#define USART_CR1_OVER_S_8   	((uint32_t)1 << USART_CR1_OVER8_Pos)
 
 /***** Control register 2 *****/
 /* Bit 14 LINEN: LIN mode enable */
@@ -39,6 +39,9 @@
 #include "soc-interrupts.h"
 #include "soc-usart.h"
 #include "soc-usart-regs.h"
+#ifdef CONFIG_LOADER_SERIAL_TX_DMA
+#include "soc-dma.h"
+#endif
 
 /**** USART basic Read / Write ****/
 void soc_usart_putc(uint8_t usart, char c)
@@ -46,7 +49,7 @@ void soc_usart_putc(uint8_t usart, char c)
     /* Wait for TX to be ready */
     while (!get_reg(r_CORTEX_M_USART_SR(usart), USART_SR_TXE))
         continue;
-    *r_CORTEX_M_USART_DR(usart) = c;
+    write_reg_value(r_CORTEX_M_USART_DR(usart), c);
 }
 
 /* Instantiate the putc for each USART */
@@ -71,6 +74,82 @@ void soc_usart_write(uint8_t usart, char *msg, uint32_t len)
     }
 }
 
+void soc_usart_wait_tx_complete(uint8_t usart)
+{
+    /* Wait for the last data to leave the shift register */
+    while (!get_reg(r_CORTEX_M_USART_SR(usart), USART_SR_TC))
+        continue;
+}
+
+void soc_usart_tx_irq_enable(uint8_t usart)
+{
+    set_reg_bits(r_CORTEX_M_USART_CR1(usart), USART_CR1_TXEIE_Msk);
+}
+
+void soc_usart_tx_irq_disable(uint8_t usart)
+{
+    clear_reg_bits(r_CORTEX_M_USART_CR1(usart), USART_CR1_TXEIE_Msk);
+}
+
+#ifdef CONFIG_LOADER_SERIAL_TX_DMA
+/**** USART DMA transmission ****/
+
+/* USART TX DMA request mapping (dma, stream, channel). UART5 is not
+ * handled (see soc_usart_init()) */
+static const struct {
+    uint8_t dma;
+    uint8_t stream;
+    uint8_t channel;
+} usart_tx_dma[] = {
+    { 0, 0, 0 },
+    { 2, 7, 4 },    /* USART1 */
+    { 1, 6, 4 },    /* USART2 */
+    { 1, 3, 4 },    /* USART3 */
+    { 1, 4, 4 },    /* UART4 */
+    { 0, 0, 0 },    /* UART5 */
+    { 2, 6, 5 },    /* USART6 */
+};
+
+int soc_usart_dma_write(uint8_t usart, const char *buf, uint16_t len)
+{
+    soc_dma_xfer_t xfer = {
+        .dir = DMA_DIR_MEM_TO_PERIPH,
+        .size = DMA_SIZE_BYTE,
+        .pinc = false,
+        .minc = true,
+        .periph = (physaddr_t)r_CORTEX_M_USART_DR(usart),
+        .mem = (physaddr_t)buf,
+        .count = len
+    };
+
+    if ((usart < 1) || (usart > 6) || (usart_tx_dma[usart].dma == 0)) {
+        return -1;
+    }
+    xfer.dma = usart_tx_dma[usart].dma;
+    xfer.stream = usart_tx_dma[usart].stream;
+    xfer.channel = usart_tx_dma[usart].channel;
+
+    set_reg_bits(r_CORTEX_M_USART_CR3(usart), USART_CR3_DMAT_Msk);
+    return soc_dma_start(&xfer);
+}
+
+bool soc_usart_dma_busy(uint8_t usart)
+{
+    if ((usart < 1) || (usart > 6) || (usart_tx_dma[usart].dma == 0)) {
+        return false;
+    }
+    return soc_dma_busy(usart_tx_dma[usart].dma, usart_tx_dma[usart].stream);
+}
+
+void soc_usart_dma_wait(uint8_t usart)
+{
+    if ((usart < 1) || (usart > 6) || (usart_tx_dma[usart].dma == 0)) {
+        return;
+    }
+    soc_dma_wait(usart_tx_dma[usart].dma, usart_tx_dma[usart].stream);
+}
+#endif
+
 char soc_usart_getc(uint8_t usart)
 {
     while (!get_reg(r_CORTEX_M_USART_SR(usart), USART_SR_RXNE))
@@ -106,20 +185,22 @@ uint32_t soc_usart_read(uint8_t usart, char *buf, uint32_t len)
 
 void soc_usart_set_baudrate(usart_config_t * config)
 {
-    uint32_t divider = 0;
-    uint16_t mantissa = 0;
-    uint8_t fraction = 0;
-
-    /* FIXME we should check CR1 in order to get the OVER8 configuration */
+    uint32_t fck = 0;
+    uint32_t cycles = 0;
+    uint32_t brr = 0;
 
     /* Compute the divider using the baudrate and the APB bus clock
      * (APB1 or APB2) depending on the considered USART */
-    divider = soc_usart_get_bus_clock(config) / config->baudrate;
-
-    mantissa = (uint16_t) divider / 16;
-    fraction = (uint8_t) ((divider - mantissa * 16));
-    write_reg_value(r_CORTEX_M_USART_BRR(config->usart),
-                    (((mantissa & 0x0fff) << 4) | (0x0f & fraction)));
+    fck = soc_usart_get_bus_clock(config);
+    cycles = (uint32_t)USART_BAUD_CYCLES(fck, config->baudrate);
+
+    if (config->options_cr1 & USART_CR1_OVER8_Msk) {
+        /* DIV_Fraction is 3 bits long, DIV_Fraction[3] must be kept cleared */
+        brr = ((cycles & ~0x7) << 1) | (cycles & 0x7);
+    } else {
+        brr = cycles;
+    }
+    write_reg_value(r_CORTEX_M_USART_BRR(config->usart), brr & 0xffff);
 }
 
 /* USART mapping for UART mode (TX, RX), and their configuration */
@@ -268,12 +349,21 @@ static void soc_usart_clock_init(usart_config_t * config)
 /**** IRQ Handlers ****/
 
 #define USART_IRQHANDLER(num, type) \
-/* Global variable holding the callback to USART num */\
+/* Global variables holding the callbacks to USART num */\
 cb_usart_data_received_t cb_usart##num##_data_received = NULL;\
+cb_usart_tx_ready_t cb_usart##num##_tx_ready = NULL;\
 /* Register the IRQ */\
 void U##type##ART##num##_IRQ_Handler(stack_frame_t *sf __attribute__((unused)))\
 {\
-	if(cb_usart##num##_data_received != NULL){\
+	/* TX data register empty, while the TXE interrupt is enabled */\
+	if(cb_usart##num##_tx_ready != NULL &&\
+	   get_reg(r_CORTEX_M_USART_CR1(num), USART_CR1_TXEIE) &&\
+	   get_reg(r_CORTEX_M_USART_SR(num), USART_SR_TXE)){\
+		cb_usart##num##_tx_ready();\
+	}\
+	/* the TX interrupt shares the IRQ line: check for received data */\
+	if(cb_usart##num##_data_received != NULL &&\
+	   get_reg(r_CORTEX_M_USART_SR(num), USART_SR_RXNE)){\
 		cb_usart##num##_data_received();\
 	}\
 }
@@ -298,6 +388,11 @@ USART_IRQHANDLER(1, S)
 			/* Enable dedicated IRQ and register the callback */\
 			cb_usart##num##_data_received = config->callback_data_received;\
 		}\
+		if (config->callback_tx_ready != NULL){\
+			NVIC_EnableIRQ(U##type##ART##num##_IRQ - 0x10);\
+			/* TXE interrupt is enabled on demand */\
+			cb_usart##num##_tx_ready = config->callback_tx_ready;\
+		}\
 		if(config->callback_usart_getc_ptr != NULL){\
 			*(config->callback_usart_getc_ptr) = soc_usart##num##_getc;\
 		}\
@@ -63,6 +63,7 @@ static const struct {
 
 
 typedef void (*cb_usart_data_received_t) (void);
+typedef void (*cb_usart_tx_ready_t) (void);
 typedef char (*cb_usart_getc_t) (void);
 typedef void (*cb_usart_putc_t) (char);
 
@@ -124,6 +125,8 @@ typedef struct __packed {
                                      * Bits 15:8 GT[7:0]: Guard time value
                                      * Bits 7:0 PSC[7:0]: Prescaler value */
     cb_usart_data_received_t callback_data_received;
+    cb_usart_tx_ready_t callback_tx_ready;  /* called on TXE interrupt, see
+                                               soc_usart_tx_irq_enable() */
     cb_usart_getc_t *callback_usart_getc_ptr;
     cb_usart_putc_t *callback_usart_putc_ptr;
 } usart_config_t;
@@ -206,6 +209,38 @@ void soc_usart_putc(uint8_t usart, char c);
  */
 void soc_usart_write(uint8_t usart, char *msg, uint32_t len);
 
+/**
+ * usart_wait_tx_complete - Wait for the end of the current transmission,
+ * including the last character stop bit(s)
+ */
+void soc_usart_wait_tx_complete(uint8_t usart);
+
+/**
+ * usart_tx_irq_enable/disable - Enable or disable the TXE interrupt, which
+ * calls the callback_tx_ready callback each time the TX data register is
+ * empty
+ */
+void soc_usart_tx_irq_enable(uint8_t usart);
+void soc_usart_tx_irq_disable(uint8_t usart);
+
+#ifdef CONFIG_LOADER_SERIAL_TX_DMA
+/**
+ * usart_dma_write - Send a buffer using the USART TX DMA stream
+ * @buf: buffer of size @len to send. It must not be modified until the end
+ * of the transfer.
+ *
+ * The function returns as soon as the transfer is started. Returns -1 if
+ * the USART has no TX DMA stream or if the stream is in use.
+ */
+int soc_usart_dma_write(uint8_t usart, const char *buf, uint16_t len);
+
+/* Is a DMA transmission ongoing on this USART ? */
+bool soc_usart_dma_busy(uint8_t usart);
+
+/* Wait for the end of the current DMA transfer on this USART */
+void soc_usart_dma_wait(uint8_t usart);
+#endif
+
 /**
  * usart_getc - Read a character
  * Return: The character read.
@@ -223,6 +258,41 @@ uint32_t soc_usart_read(uint8_t usart, char *buf, uint32_t len);
 /* Get the clock frequency value of the APB bus driving the USART */
 uint32_t soc_usart_get_bus_clock(usart_config_t * config);
 
+/*
+ * Baudrate divider. Whatever the oversampling is, the bit duration in bus
+ * clock cycles is USARTDIV * 16 (OVER8 = 0) or USARTDIV * 8 (OVER8 = 1). It
+ * must be at least 16 cycles without OVER8, 8 cycles with OVER8 (i.e. up to
+ * fck / 8 baud), and at most 0xffff cycles.
+ * The number of cycles q = fck / baud is rounded up when fck / (q + 1) is
+ * nearer to the baudrate than fck / q, i.e. when
+ * 2 * baud * q * (q + 1) < fck * (2 * q + 1), which minimizes the baudrate
+ * error (a plain rounding of fck / baud does not, for a few cycles per bit).
+ * These macros are usable by the preprocessor, to check the console
+ * baudrate at build time.
+ */
+#define USART_BAUD_CYCLES_FLOOR(fck, baud)  ((fck) / (baud))
+#define USART_BAUD_CYCLES(fck, baud) \
+    (USART_BAUD_CYCLES_FLOOR(fck, baud) + \
+     (((2ULL * (baud) * USART_BAUD_CYCLES_FLOOR(fck, baud) * \
+        (USART_BAUD_CYCLES_FLOOR(fck, baud) + 1)) < \
+       ((fck) * (2ULL * USART_BAUD_CYCLES_FLOOR(fck, baud) + 1))) ? 1 : 0))
+
+/* OVER8 is only used when required, as it lowers the receiver tolerance */
+#define USART_BAUD_OVER8(fck, baud)     (USART_BAUD_CYCLES(fck, baud) < 16)
+
+/* baudrate error, in 1/10000 of the requested baudrate */
+#define USART_BAUD_ERROR(fck, baud) \
+    ((((fck) > (USART_BAUD_CYCLES(fck, baud) * (baud))) ? \
+      ((fck) - (USART_BAUD_CYCLES(fck, baud) * (baud))) : \
+      ((USART_BAUD_CYCLES(fck, baud) * (baud)) - (fck))) * 10000ULL / \
+     (USART_BAUD_CYCLES(fck, baud) * (baud)))
+
+/*
+ * Set the BRR register for the config->baudrate, using the OVER8 setting of
+ * config->options_cr1
+ */
+void soc_usart_set_baudrate(usart_config_t * config);
+
 void USART1_IRQ_Handler(stack_frame_t *sf);
 void USART2_IRQ_Handler(stack_frame_t *sf);
 void USART3_IRQ_Handler(stack_frame_t *sf);
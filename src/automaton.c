@@ -23,215 +23,201 @@
  */
 #include "autoconf.h"
 #include "soc-rng.h"
+#include "soc-dwt.h"
 #include "automaton.h"
 #include "hash.h"
+#include "halfsiphash.h"
 #include "main.h"
+#include "profile.h"
 
 volatile uint64_t controlflow;
 volatile uint64_t currentflow;
 
 
+/****************************************************************
+ * loader state automaton formal definition and associate utility
+ * functions
+ ***************************************************************/
+
+/*
+ * The automaton is described once, here, by the list of its states, the
+ * list of its transition requests and the list of its allowed transitions
+ * (current state, request, next state). All the automaton tables are
+ * generated from these lists at compile time, and are constified (in
+ * .rodata), keeping the hardened multi-bits state and request encodings.
+ *
+ * The cell of a state (resp. the index of a request) is its position in
+ * the corresponding list.
+ */
+#define LOADER_STATES(X) \
+    X(LOADER_START)       \
+    X(LOADER_INIT)        \
+    X(LOADER_RDPCHECK)    \
+    X(LOADER_DFUWAIT)     \
+    X(LOADER_SELECTBANK)  \
+    X(LOADER_HDRCRC)      \
+    X(LOADER_FWINTEGRITY) \
+    X(LOADER_FLASHLOCK)   \
+    X(LOADER_BOOTFW)      \
+    X(LOADER_ERROR)       \
+    X(LOADER_SECBREACH)
+
+#define LOADER_REQUESTS(X)         \
+    X(LOADER_REQ_INIT)             \
+    X(LOADER_REQ_RDPCHECK)         \
+    X(LOADER_REQ_DFUCHECK)         \
+    X(LOADER_REQ_SELECTBANK)       \
+    X(LOADER_REQ_CRCCHECK)         \
+    X(LOADER_REQ_INTEGRITYCHECK)   \
+    X(LOADER_REQ_FLASHLOCK)        \
+    X(LOADER_REQ_BOOT)             \
+    X(LOADER_REQ_ERROR)            \
+    X(LOADER_REQ_SECBREACH)
+
 /*
- * Constified (in .rodata) dereferencing structure to associate
- * a secured, discretionary automaton state for if control code
- * with an automaton cell
+ * If a request is not listed for a given state, this is not an allowed
+ * transition. LOADER_ERROR and LOADER_SECBREACH are terminal states.
  */
-static const struct automaton_state_correspondency {
-    loader_state_t state;
-    uint8_t        cell;
-} automaton_state_accessor[] = {
-    { LOADER_START,       0 },
-    { LOADER_INIT,        1 },
-    { LOADER_RDPCHECK,    2 },
-    { LOADER_DFUWAIT,     3 },
-    { LOADER_SELECTBANK,  4 },
-    { LOADER_HDRCRC,      5 },
-    { LOADER_FWINTEGRITY, 6 },
-    { LOADER_FLASHLOCK,   7 },
-    { LOADER_BOOTFW,      8 },
-    { LOADER_ERROR,       9 },
-    { LOADER_SECBREACH,   10 }
+#define LOADER_TRANSITIONS(T) \
+    T(LOADER_START,       LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_START,       LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_START,       LOADER_REQ_INIT,           LOADER_INIT)        \
+    T(LOADER_INIT,        LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_INIT,        LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_INIT,        LOADER_REQ_RDPCHECK,       LOADER_RDPCHECK)    \
+    T(LOADER_RDPCHECK,    LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_RDPCHECK,    LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_RDPCHECK,    LOADER_REQ_DFUCHECK,       LOADER_DFUWAIT)     \
+    T(LOADER_RDPCHECK,    LOADER_REQ_SELECTBANK,     LOADER_SELECTBANK)  \
+    T(LOADER_RDPCHECK,    LOADER_REQ_CRCCHECK,       LOADER_HDRCRC)      \
+    T(LOADER_RDPCHECK,    LOADER_REQ_INTEGRITYCHECK, LOADER_FWINTEGRITY) \
+    T(LOADER_RDPCHECK,    LOADER_REQ_FLASHLOCK,      LOADER_FLASHLOCK)   \
+    T(LOADER_RDPCHECK,    LOADER_REQ_BOOT,           LOADER_BOOTFW)      \
+    T(LOADER_DFUWAIT,     LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_DFUWAIT,     LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_DFUWAIT,     LOADER_REQ_RDPCHECK,       LOADER_RDPCHECK)    \
+    T(LOADER_SELECTBANK,  LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_SELECTBANK,  LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_SELECTBANK,  LOADER_REQ_RDPCHECK,       LOADER_RDPCHECK)    \
+    T(LOADER_HDRCRC,      LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_HDRCRC,      LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_HDRCRC,      LOADER_REQ_RDPCHECK,       LOADER_RDPCHECK)    \
+    T(LOADER_FWINTEGRITY, LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_FWINTEGRITY, LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_FWINTEGRITY, LOADER_REQ_RDPCHECK,       LOADER_RDPCHECK)    \
+    T(LOADER_FLASHLOCK,   LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_FLASHLOCK,   LOADER_REQ_SECBREACH,      LOADER_SECBREACH)   \
+    T(LOADER_FLASHLOCK,   LOADER_REQ_RDPCHECK,       LOADER_RDPCHECK)    \
+    T(LOADER_BOOTFW,      LOADER_REQ_ERROR,          LOADER_ERROR)       \
+    T(LOADER_BOOTFW,      LOADER_REQ_SECBREACH,      LOADER_SECBREACH)
+
+/* state cells and request indexes */
+#define LOADER_STATE_CELL(s)       s##_CELL,
+#define LOADER_REQUEST_INDEX(r)    r##_INDEX,
+
+enum {
+    LOADER_STATES(LOADER_STATE_CELL)
+    LOADER_NSTATES
 };
 
-static uint8_t automaton_get_cell(loader_state_t state)
-{
-    uint8_t cellid = 10; /* defaulting to LOADER_SECBREACH */
-    for (uint8_t i = 0; i < sizeof(automaton_state_accessor)/sizeof(struct automaton_state_correspondency); i++) {
-        /* double if protection */
-        if (automaton_state_accessor[i].state == state &&
-            !(automaton_state_accessor[i].state != state)) {
-            cellid = automaton_state_accessor[i].cell;
-            goto end;
-        }
-    }
-end:
-    return cellid;
-}
+enum {
+    LOADER_REQUESTS(LOADER_REQUEST_INDEX)
+    LOADER_NREQUESTS
+};
 
+/* cell/index to state/request value */
+#define LOADER_LIST_VALUE(v)       v,
 
-/****************************************************************
- * loader state automaton formal definition and associate utility
- * functions
- ***************************************************************/
+static const loader_state_t loader_states[LOADER_NSTATES] = {
+    LOADER_STATES(LOADER_LIST_VALUE)
+};
 
-static loader_state_t state;
+static const loader_request_t loader_requests[LOADER_NREQUESTS] = {
+    LOADER_REQUESTS(LOADER_LIST_VALUE)
+};
 
 /*
- * all allowed transitions and target states for each current state
- * empty fields are set as 0xff/0xff for request/state couple, which is
- * an inexistent state and request
- *
- * This table associate each state of the DFU automaton with up to
- * 5 potential allowed transitions/next_state couples. This permit to
- * easily detect:
- *    1) authorized transitions, based on the current state
- *    2) next state, based on the current state and current transition
- *
- * If the next_state for the current transision is keeped to 0xff, this
- * means that the current transition for the current state may lead to
- * multiple next state depending on other informations. In this case,
- * the transition handler has to handle this manually.
+ * State/request value to cell/index: the values modulo the following
+ * moduli are all different (there is no collision in the generated
+ * tables). The tables entries hold the cell/index plus one, 0 meaning no
+ * state/request. The values found are always verified against the
+ * state/request lists.
  */
+#define LOADER_STATE_MODULUS       18
+#define LOADER_REQUEST_MODULUS     39
+
+#define LOADER_STATE_MAP(s)        [(uint32_t)(s) % LOADER_STATE_MODULUS] = s##_CELL + 1,
+#define LOADER_REQUEST_MAP(r)      [(uint32_t)(r) % LOADER_REQUEST_MODULUS] = r##_INDEX + 1,
+
+static const uint8_t loader_state_map[LOADER_STATE_MODULUS] = {
+    LOADER_STATES(LOADER_STATE_MAP)
+};
 
-#define MAX_TRANSITION_STATE 8
+static const uint8_t loader_request_map[LOADER_REQUEST_MODULUS] = {
+    LOADER_REQUESTS(LOADER_REQUEST_MAP)
+};
+
+/*
+ * Compile time check of the moduli: a collision would silently override a
+ * table entry. The values modulo the moduli are all different if and only
+ * if the sum of their bits is also their union.
+ */
+#define LOADER_STATE_BIT(s)        + ((uint64_t)1 << ((uint32_t)(s) % LOADER_STATE_MODULUS))
+#define LOADER_STATE_BIT_OR(s)     | ((uint64_t)1 << ((uint32_t)(s) % LOADER_STATE_MODULUS))
+#define LOADER_REQUEST_BIT(r)      + ((uint64_t)1 << ((uint32_t)(r) % LOADER_REQUEST_MODULUS))
+#define LOADER_REQUEST_BIT_OR(r)   | ((uint64_t)1 << ((uint32_t)(r) % LOADER_REQUEST_MODULUS))
+
+_Static_assert((LOADER_STATE_MODULUS <= 64) && (LOADER_REQUEST_MODULUS <= 64),
+               "automaton moduli larger than the collision check");
+_Static_assert((0 LOADER_STATES(LOADER_STATE_BIT)) ==
+               (0 LOADER_STATES(LOADER_STATE_BIT_OR)),
+               "two states collide modulo LOADER_STATE_MODULUS");
+_Static_assert((0 LOADER_REQUESTS(LOADER_REQUEST_BIT)) ==
+               (0 LOADER_REQUESTS(LOADER_REQUEST_BIT_OR)),
+               "two requests collide modulo LOADER_REQUEST_MODULUS");
 
 /*
- * Association between a request and a transition to a next state. This couple
- * depend on the current state and is use in the following structure
+ * Dense transition table, addressed by current state cell and request
+ * index, holding the next state. A 0 entry (which is not a valid state)
+ * is a not allowed transition.
  */
-typedef struct loader_operation_code_transition {
-    loader_request_t request;
-    loader_state_t   target_state;
-} loader_operation_code_transition_t;
-
-
-static const struct {
-    loader_state_t state;
-    loader_operation_code_transition_t req_trans[MAX_TRANSITION_STATE];
-} loader_automaton[] = {
-    {LOADER_START, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_INIT, LOADER_INIT},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                  }
-    },
-    {LOADER_INIT, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_RDPCHECK, LOADER_RDPCHECK},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_RDPCHECK, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_DFUCHECK, LOADER_DFUWAIT},
-                 {LOADER_REQ_SELECTBANK, LOADER_SELECTBANK},
-                 {LOADER_REQ_CRCCHECK, LOADER_HDRCRC},
-                 {LOADER_REQ_INTEGRITYCHECK, LOADER_FWINTEGRITY},
-                 {LOADER_REQ_FLASHLOCK, LOADER_FLASHLOCK},
-                 {LOADER_REQ_BOOT, LOADER_BOOTFW},
-                 }
-     },
-    {LOADER_DFUWAIT, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_RDPCHECK, LOADER_RDPCHECK},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_SELECTBANK, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_RDPCHECK, LOADER_RDPCHECK},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_HDRCRC, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_RDPCHECK, LOADER_RDPCHECK},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_FWINTEGRITY, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_RDPCHECK, LOADER_RDPCHECK},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_FLASHLOCK, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {LOADER_REQ_RDPCHECK, LOADER_RDPCHECK},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_BOOTFW, {
-                 {LOADER_REQ_ERROR, LOADER_ERROR},
-                 {LOADER_REQ_SECBREACH, LOADER_SECBREACH},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_ERROR, {
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
-    {LOADER_SECBREACH, {
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 {0xff, 0xff},
-                 }
-     },
+#define LOADER_TRANSITION(s, r, t) [s##_CELL][r##_INDEX] = t,
+
+static const loader_state_t loader_automaton[LOADER_NSTATES][LOADER_NREQUESTS] = {
+    LOADER_TRANSITIONS(LOADER_TRANSITION)
 };
 
+static uint8_t automaton_get_cell(loader_state_t state)
+{
+    uint8_t cellid = LOADER_SECBREACH_CELL; /* defaulting to LOADER_SECBREACH */
+    uint8_t entry = loader_state_map[(uint32_t)state % LOADER_STATE_MODULUS];
+
+    /* double if protection */
+    if (entry != 0 &&
+        loader_states[entry - 1] == state &&
+        !(loader_states[entry - 1] != state)) {
+        cellid = entry - 1;
+    }
+    return cellid;
+}
+
+/* return the request index, or LOADER_NREQUESTS for unknown requests */
+static uint8_t automaton_get_request_index(loader_request_t request)
+{
+    uint8_t index = LOADER_NREQUESTS;
+    uint8_t entry = loader_request_map[(uint32_t)request % LOADER_REQUEST_MODULUS];
+
+    /* double if protection */
+    if (entry != 0 &&
+        loader_requests[entry - 1] == request &&
+        !(loader_requests[entry - 1] != request)) {
+        index = entry - 1;
+    }
+    return index;
+}
+
+static loader_state_t state;
+
 /*
  * control flow sequence that must be respected by the automaton
  */
@@ -254,6 +240,23 @@ static const uint32_t loader_controlflow[] = {
     LOADER_BOOTFW,
 };
 
+/*
+ * Control flow precomputed values, set at control flow init time:
+ * - (legacy sum only) the hash_state() value of each automaton state
+ *   (indexed by automaton cell)
+ * - the control flow value after each step of loader_controlflow[]
+ * This avoids replaying the whole control flow sequence at each transition.
+ */
+#ifdef CONFIG_LOADER_CFLOW_SUM
+static uint64_t loader_state_hash[LOADER_NSTATES];
+#endif
+static uint64_t loader_controlflow_prefix[LOADER_CONTROLFLOW_LENGTH];
+
+#ifndef CONFIG_LOADER_CFLOW_SUM
+/* control flow MAC key, set by the RNG at control flow init time */
+static uint32_t loader_controlflow_key[HALFSIPHASH_KEY_WORDS];
+#endif
+
 /**********************************************
  * loader getters and setters
  *********************************************/
@@ -264,6 +267,46 @@ loader_state_t loader_get_state(void)
 }
 
 
+#ifdef CONFIG_LOADER_CFLOW_SUM
+static uint64_t loader_get_state_hash(uint32_t value)
+{
+    uint8_t cell = automaton_get_cell(value);
+
+    /* double if protection. automaton_get_cell() defaults to LOADER_SECBREACH
+     * for unknown values: these ones are hashed on the fly */
+    if (loader_states[cell] == value &&
+        !(loader_states[cell] != value)) {
+        return loader_state_hash[cell];
+    }
+    return hash_state(value);
+}
+
+static inline void update_controlflowvar(volatile uint64_t *var, uint32_t value)
+{
+    /* atomic local update of the control flow var.
+     * FIXME: addition is problematic because it does not ensure that
+     * previous states has been executed in the correct order, but only
+     * that they **all** have been executed. Though, as each state check for
+     * the control flow, the order is checked. Althgouh, a mathematical
+     * primitive ensuring variation (successive CRC ? other ?) would be better. */
+    *var += loader_get_state_hash(value);
+
+}
+#else
+static inline void update_controlflowvar(volatile uint64_t *var, uint32_t value)
+{
+    /* MAC chain: var = MAC(var || value). Contrary to the legacy sum, the
+     * result depends on the order of the successive states, and can't be
+     * forged without the key */
+    uint32_t msg[3];
+
+    msg[0] = (uint32_t)(*var);
+    msg[1] = (uint32_t)(*var >> 32);
+    msg[2] = value;
+    *var = halfsiphash_2_4_64(loader_controlflow_key, (const uint8_t*)msg, sizeof(msg));
+}
+#endif
+
 void loader_init_controlflow(void)
 {
     union u_controlflow {
@@ -271,15 +314,24 @@ void loader_init_controlflow(void)
         volatile uint32_t *cf32;
     };
     union u_controlflow cf_init;
+    uint64_t flow;
+    uint8_t i;
+#if CONFIG_LOADER_EXTRA_DEBUG
+    uint32_t start = soc_dwt_getcycles();
+#endif
     cf_init.cf64 = &controlflow;
 
     /* set the all 64 bits of the controlflow variable */
     soc_get_random(&(cf_init.cf32[0]));
     soc_get_random(&(cf_init.cf32[1]));
+#ifndef CONFIG_LOADER_CFLOW_SUM
+    /* and the MAC key */
+    soc_get_random(&(loader_controlflow_key[0]));
+    soc_get_random(&(loader_controlflow_key[1]));
+#endif
 
 #if CONFIG_LOADER_EXTRA_DEBUG
-    dbg_log("initialize controlflow to (long long) %ll\n", controlflow);
-    dbg_flush();
+    dbg_debug("initialize controlflow to (long long) %ll\n", controlflow);
 #endif
     /* depending on the value of controlflow at start, the value of the
      * successive calculation of currentflow may generate an uint64_t overflow,
@@ -287,59 +339,82 @@ void loader_init_controlflow(void)
      * the two calculated values are the same. If FC detect the overflow, we
      * cas set the MBS bits of controlflow to 0 to avoid any overflow risk. */
     currentflow = controlflow;
-}
-
-static inline void update_controlflowvar(volatile uint64_t *var, uint32_t value)
-{
-    /* atomic local update of the control flow var.
-     * FIXME: addition is problematic because it does not ensure that
-     * previous states has been executed in the correct order, but only
-     * that they **all** have been executed. Though, as each state check for
-     * the control flow, the order is checked. Althgouh, a mathematical
-     * primitive ensuring variation (successive CRC ? other ?) would be better. */
-    *var += hash_state(value);
 
+#ifdef CONFIG_LOADER_CFLOW_SUM
+    /* hash each automaton state once */
+    for (i = 0; i < LOADER_NSTATES; ++i) {
+        loader_state_hash[i] = hash_state(loader_states[i]);
+    }
+#endif
+    /* calculate the control flow value after each step of the sequence */
+    flow = (uint64_t)controlflow;
+    for (i = 0; i < LOADER_CONTROLFLOW_LENGTH; ++i) {
+        update_controlflowvar(&flow, loader_controlflow[i]);
+        loader_controlflow_prefix[i] = flow;
+    }
+#if CONFIG_LOADER_EXTRA_DEBUG
+    dbg_debug("%s: control flow tables calculated in %d cycles\n", __func__,
+              soc_dwt_getcycles() - start);
+#endif
 }
 
-
-
 secbool loader_calculate_flowstate(loader_state_t prevstate,
                                    loader_state_t nextstate)
 {
     /*
      * Here, we recalculate from scratch, based on the prevstate/nextstate pair
      * (which **must** be unique) to current controlflow value.
-     * We use the flow control sequence set in .rodata to successively increment
-     * myflow up to the state pair we should be on.
+     * We use the flow control sequence set in .rodata to find the state pair
+     * we should be on, and the control flow value precalculated for this step
+     * of the sequence.
      * The caller function can then compare the result of this function with
      * loader_update_flowstate(). If the results are the same, the control flow is
      * keeped. If not, the control flow is corrupted.
      */
-    /* 1. init myflow to seed */
     uint8_t i = 0;
-    uint64_t myflow = (uint64_t)controlflow;
-    /* 2. starting to init state, for each state pairs different from current one, add
-     * first state of the pair to myflow */
+    uint8_t step;
+    uint64_t myflow;
+    uint64_t checkflow;
+#if CONFIG_LOADER_EXTRA_DEBUG
+    uint32_t start = soc_dwt_getcycles();
+#endif
+    /* 1. look for the state pair in the control flow sequence */
     for (i = 0; i < LOADER_CONTROLFLOW_LENGTH - 1; ++i) {
-        update_controlflowvar(&myflow, loader_controlflow[i]);
         if (loader_controlflow[i] == prevstate && loader_controlflow[i + 1] == nextstate) {
             break;
         }
     }
-    /* 3. found state pair ? add nextstate en return */
+    /* 2. get back the control flow value up to the first state of the pair
+     * (or up to the last but one state if the pair is not found) */
+    step = (i < LOADER_CONTROLFLOW_LENGTH - 1) ? i : (LOADER_CONTROLFLOW_LENGTH - 2);
+    myflow = loader_controlflow_prefix[step];
+    /* the precalculated value being in RAM, check it against the previous
+     * one and the sequence in .rodata */
+    checkflow = (step == 0) ? (uint64_t)controlflow : loader_controlflow_prefix[step - 1];
+    update_controlflowvar(&checkflow, loader_controlflow[step]);
+    if (checkflow != myflow) {
+        goto err;
+    }
+    /* 3. add nextstate en return */
     update_controlflowvar(&myflow, nextstate);
 
 #if CONFIG_LOADER_EXTRA_DEBUG
-    dbg_log("%s: result of online calculation (%d sequences) is (long long) %ll\n", __func__, i, myflow);
-    dbg_flush();
+    dbg_debug("%s: result of online calculation (%d sequences) is (long long) %ll\n", __func__, i, myflow);
+    dbg_debug("%s: calculated in %d cycles\n", __func__, soc_dwt_getcycles() - start);
 #endif
-    /* TODO: how to harden u64 comparison ? */
+    /* double if protection, on the two 32 bits halves */
     if (myflow != currentflow) {
-        /* control flow error detected */
-        dbg_log("Error in control flow ! Fault injection detected !\n");
-        return secfalse;
+        goto err;
+    }
+    if ((uint32_t)(myflow >> 32) != (uint32_t)(currentflow >> 32) ||
+        (uint32_t)myflow != (uint32_t)currentflow) {
+        goto err;
     }
     return sectrue;
+err:
+    /* control flow error detected */
+    dbg_err("Error in control flow ! Fault injection detected !\n");
+    return secfalse;
 }
 
 void loader_update_flowstate(loader_state_t nextstate)
@@ -351,8 +426,7 @@ void loader_update_flowstate(loader_state_t nextstate)
      * risk ? */
     update_controlflowvar(&currentflow, nextstate);
 #if CONFIG_LOADER_EXTRA_DEBUG
-    dbg_log("%s: update controlflow to (long long) %ll\n", __func__, currentflow);
-    dbg_flush();
+    dbg_debug("%s: update controlflow to (long long) %ll\n", __func__, currentflow);
 #endif
 
 }
@@ -367,15 +441,15 @@ void loader_set_state(const loader_state_t new_state)
     /* double if protection */
     if (new_state == 0xff &&
         !(new_state != 0xff)) {
-        dbg_log("%s: PANIC! this should never arise !", __func__);
-        dbg_flush();
+        dbg_err("%s: PANIC! this should never arise !", __func__);
         loader_set_state(LOADER_ERROR);
         return;
     }
 #if CONFIG_LOADER_EXTRA_DEBUG
-    dbg_log("%s: state: %x => %x\n", __func__, state, new_state);
-    dbg_flush();
+    dbg_debug("%s: state: %x => %x\n", __func__, state, new_state);
 #endif
+    dbg_trace_state(new_state);
+    profile_mark(new_state);
     state = new_state;
 }
 
@@ -399,12 +473,19 @@ void loader_set_state(const loader_state_t new_state)
 loader_state_t loader_next_state(const loader_state_t current_state,
                                  const loader_request_t request)
 {
-    for (uint8_t i = 0; i < MAX_TRANSITION_STATE; ++i) {
-        /* double if protection */
-        if (loader_automaton[automaton_get_cell(current_state)].req_trans[i].request == request &&
-            !(loader_automaton[automaton_get_cell(current_state)].req_trans[i].request != request)) {
-            return (loader_automaton[automaton_get_cell(current_state)].req_trans[i].target_state);
-        }
+    uint8_t cell = automaton_get_cell(current_state);
+    uint8_t index = automaton_get_request_index(request);
+    loader_state_t next_state;
+
+    if (index >= LOADER_NREQUESTS) {
+        /* unknown request */
+        return 0xff;
+    }
+    next_state = loader_automaton[cell][index];
+    /* double if protection */
+    if (next_state != 0 &&
+        !(next_state == 0)) {
+        return next_state;
     }
     /* fallback, no corresponding request found for  this state */
     return 0xff;
@@ -421,18 +502,27 @@ loader_state_t loader_next_state(const loader_state_t current_state,
 secbool loader_is_valid_transition(const loader_state_t current_state,
                                    const loader_request_t request)
 {
-    for (uint8_t i = 0; i < MAX_TRANSITION_STATE; ++i) {
-        /* double if protection */
-        if (loader_automaton[automaton_get_cell(current_state)].req_trans[i].request == request &&
-            !(loader_automaton[automaton_get_cell(current_state)].req_trans[i].request != request)) {
-            return sectrue;
-        }
+#if CONFIG_LOADER_EXTRA_DEBUG
+    uint32_t start = soc_dwt_getcycles();
+#endif
+    uint8_t cell = automaton_get_cell(current_state);
+    uint8_t index = automaton_get_request_index(request);
+
+    /* double if protection */
+    if (index < LOADER_NREQUESTS &&
+        loader_automaton[cell][index] != 0 &&
+        !(loader_automaton[cell][index] == 0)) {
+#if CONFIG_LOADER_EXTRA_DEBUG
+        dbg_debug("%s: transition checked in %d cycles\n", __func__,
+                  soc_dwt_getcycles() - start);
+#endif
+        return sectrue;
     }
     /*
      * Didn't find any request associated to current state. This is not a
      * valid transition. We should stall the request.
      */
-    dbg_log("%s: invalid transition from state %d, request %d\n", __func__,
+    dbg_err("%s: invalid transition from state %d, request %d\n", __func__,
            current_state, request);
     loader_set_state(LOADER_ERROR);
     return secfalse;
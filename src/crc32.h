@@ -49,4 +49,41 @@
 
 uint32_t crc32 (const unsigned char *buf, uint32_t len, uint32_t init);
 
+/*
+ * @brief Extend a CRC32 with constant bytes
+ *
+ * Return the CRC32 of the content whose CRC32 is crc, followed by len bytes
+ * all equal to value. This is made in O(log(len)) using GF(2) polynomial
+ * arithmetics, instead of going through the len bytes.
+ */
+uint32_t crc32_extend_constant (uint32_t crc, uint8_t value, uint32_t len);
+
+/*
+ * @brief Combine two CRC32
+ *
+ * Return the CRC32 of the concatenation of a content A, whose CRC32 is
+ * crc1, and a content B, len2 bytes long, whose CRC32 calculated with a
+ * null init value is crc2.
+ */
+uint32_t crc32_combine (uint32_t crc1, uint32_t crc2, uint32_t len2);
+
+/*
+ * A block of a CRC32 calculated content: either a buffer, or (if buf is
+ * NULL) len bytes equal to fill
+ */
+typedef struct {
+    const unsigned char *buf;
+    uint32_t             len;
+    uint8_t              fill;
+} crc32_block_t;
+
+/*
+ * @brief CRC32 of successive blocks
+ *
+ * Return the CRC32 of the concatenation of the given blocks, with the
+ * same init convention as crc32(). Constant blocks, and buffer blocks
+ * found to be constant, are handled by crc32_extend_constant().
+ */
+uint32_t crc32_blocks (const crc32_block_t *blocks, uint32_t nblocks, uint32_t init);
+
 #endif/*!CRC32_H_*/
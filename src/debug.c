@@ -39,29 +39,113 @@
 #include "soc-init.h"
 #include "soc-usart.h"
 #include "soc-nvic.h"
+#include "soc-dwt.h"
+#include "soc-dbgmcu.h"
+#include "m4-itm.h"
 
-#define BUF_MAX		512
+#ifdef CONFIG_LOADER_SERIAL_BUFSIZE
+# define BUF_MAX    CONFIG_LOADER_SERIAL_BUFSIZE
+#else
+# define BUF_MAX    512
+#endif
+
+#if (BUF_MAX & (BUF_MAX - 1)) != 0
+# error "the console ring buffer size must be a power of 2"
+#endif
+#define BUF_MASK    (BUF_MAX - 1)
+
+/* console backend */
+#if defined(CONFIG_LOADER_SERIAL) && defined(CONFIG_LOADER_CONSOLE_BACKEND_ITM)
+# define CONSOLE_ITM
+#elif defined(CONFIG_LOADER_SERIAL)
+# define CONSOLE_USART
+#endif
+
+#ifdef CONSOLE_USART
+# ifdef CONFIG_LOADER_SERIAL_BAUDRATE
+#  define CONSOLE_BAUDRATE  CONFIG_LOADER_SERIAL_BAUDRATE
+# else
+#  define CONSOLE_BAUDRATE  115200
+# endif
+# if (CONFIG_LOADER_USART == 1) || (CONFIG_LOADER_USART == 6)
+#  define CONSOLE_BUS_CLOCK PROD_CLOCK_APB2
+# else
+#  define CONSOLE_BUS_CLOCK PROD_CLOCK_APB1
+# endif
+/* the console baudrate is checked against the console USART bus clock */
+# if USART_BAUD_CYCLES(CONSOLE_BUS_CLOCK, CONSOLE_BAUDRATE) < 8
+#  error "the console baudrate is too high for the console USART bus clock"
+# endif
+# if USART_BAUD_CYCLES(CONSOLE_BUS_CLOCK, CONSOLE_BAUDRATE) > 0xffff
+#  error "the console baudrate is too low for the console USART bus clock"
+# endif
+# if USART_BAUD_ERROR(CONSOLE_BUS_CLOCK, CONSOLE_BAUDRATE) > 200
+#  error "the console baudrate error is higher than 2%"
+# endif
+# if USART_BAUD_OVER8(CONSOLE_BUS_CLOCK, CONSOLE_BAUDRATE)
+#  define CONSOLE_OVER8     USART_CR1_OVER_S_8
+# else
+#  define CONSOLE_OVER8     USART_CR1_OVER_S_16
+# endif
+#endif
+
+#ifdef CONSOLE_ITM
+# ifdef CONFIG_LOADER_ITM_SWO_BAUDRATE
+#  define ITM_SWO_BAUDRATE  CONFIG_LOADER_ITM_SWO_BAUDRATE
+# else
+#  define ITM_SWO_BAUDRATE  2000000
+# endif
+/* the TPIU clock (TRACECLKIN) is the core clock */
+# define ITM_TRACECLKIN     (PROD_CORE_FREQUENCY * 1000)
+# if (ITM_SWO_BAUDRATE <= 0) || ((ITM_TRACECLKIN % ITM_SWO_BAUDRATE) != 0)
+#  error "the SWO baudrate must be a divisor of the core clock"
+# endif
+# define ITM_SWO_PRESCALER  ((ITM_TRACECLKIN / ITM_SWO_BAUDRATE) - 1)
+# if ITM_SWO_PRESCALER > 0x1fff
+#  error "the SWO baudrate is too low for the core clock"
+# endif
+/* ITM stimulus ports */
+# define ITM_PORT_CONSOLE   0
+# define ITM_PORT_STATE     1
+# define ITM_PORT_TIMESTAMP 2
+# define ITM_PORTS          ((1 << ITM_PORT_CONSOLE) | (1 << ITM_PORT_STATE) | \
+                             (1 << ITM_PORT_TIMESTAMP))
+#endif
 
 cb_usart_getc_t console_getc = NULL;
 cb_usart_putc_t console_putc = NULL;
 
+/*
+ * Single producer (dbg_log()), single consumer (flush, or TXE interrupt)
+ * lock-free ring buffer. head and tail are free running counters: head is
+ * only written by the producer, tail only by the consumer, and the number
+ * of used bytes is (head - tail).
+ */
 static struct {
-    uint32_t start;
-    uint32_t end;
-    bool     full;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t dropped;   /* characters dropped while the buffer was full */
     char buf[BUF_MAX];
 } ring_buffer;
 
+/* the buffer content must be written before the head is moved forward */
+#define ring_buffer_barrier()   asm volatile ("" ::: "memory")
+
 static bool debug_ready = false;
 
+#if defined(CONSOLE_USART) && defined(CONFIG_LOADER_SERIAL_TX_DMA)
+/* number of ring buffer bytes being sent by DMA, starting at the tail */
+static uint32_t dma_inflight = 0;
+#endif
+
 void init_ring_buffer(void)
 {
     /* init flags */
     int     i = 0;
 
-    ring_buffer.end = 0;
-    ring_buffer.start = ring_buffer.end;
-    ring_buffer.full = false;
+    ring_buffer.head = 0;
+    ring_buffer.tail = ring_buffer.head;
+    ring_buffer.dropped = 0;
 
     /* memsetting buffer
      * NOTE: This may be useless as, in EwoK, the BSS is zeroified
@@ -72,7 +156,7 @@ void init_ring_buffer(void)
     }
 }
 
-#ifdef CONFIG_LOADER_SERIAL
+#ifdef CONSOLE_USART
 #ifdef CONFIG_LOADER_ALLOW_SERIAL_RX
 void cb_console_data_received(void)
 {
@@ -95,6 +179,20 @@ void cb_console_data_received(void)
 }
 #endif /* CONFIG_LOADER_ALLOW_SERIAL_RX */
 static usart_config_t console_config = { 0 };
+
+#ifdef CONFIG_LOADER_SERIAL_TX_IRQ
+/* TXE interrupt: the ring buffer consumer */
+static void cb_console_tx_ready(void)
+{
+    if (ring_buffer.tail != ring_buffer.head) {
+        console_putc(ring_buffer.buf[ring_buffer.tail & BUF_MASK]);
+        ring_buffer.tail++;
+    }
+    if (ring_buffer.tail == ring_buffer.head) {
+        soc_usart_tx_irq_disable(console_config.usart);
+    }
+}
+#endif
 #endif
 
 void debug_console_init(void)
@@ -104,118 +202,298 @@ void debug_console_init(void)
      * sys_ipc(LOG) syscall behave like writing in /dev/null.
      */
     init_ring_buffer();
-#ifdef CONFIG_LOADER_SERIAL
+#ifdef CONSOLE_USART
     /* Configure the USART in UART mode */
     console_config.usart = CONFIG_LOADER_USART;
-    console_config.baudrate = 115200;
+    console_config.baudrate = CONSOLE_BAUDRATE;
     console_config.word_length = USART_CR1_M_8;
     console_config.stop_bits = USART_CR2_STOP_1BIT;
     console_config.parity = USART_CR1_PCE_DIS;
 #ifdef CONFIG_LOADER_ALLOW_SERIAL_RX
     /* Enable both RX and TX */
     console_config.hw_flow_control = USART_CR3_CTSE_CTS_DIS | USART_CR3_RTSE_RTS_DIS;
-    console_config.options_cr1 = USART_CR1_TE_EN | USART_CR1_RE_EN | USART_CR1_UE_EN;
+    console_config.options_cr1 = USART_CR1_TE_EN | USART_CR1_RE_EN | USART_CR1_UE_EN |
+                                 CONSOLE_OVER8;
     console_config.callback_data_received = cb_console_data_received;
     console_config.callback_usart_getc_ptr = &console_getc;
     console_config.callback_usart_putc_ptr = &console_putc;
 #else
    /* Only enable TX, RX is not allowed */
     console_config.hw_flow_control = USART_CR3_CTSE_CTS_DIS | USART_CR3_RTSE_RTS_DIS;
-    console_config.options_cr1 = USART_CR1_TE_EN | USART_CR1_UE_EN;
+    console_config.options_cr1 = USART_CR1_TE_EN | USART_CR1_UE_EN | CONSOLE_OVER8;
     console_config.callback_data_received = NULL;
     console_config.callback_usart_getc_ptr = &console_getc;
     console_config.callback_usart_putc_ptr = &console_putc;
 #endif
 
+#ifdef CONFIG_LOADER_SERIAL_TX_IRQ
+    console_config.callback_tx_ready = cb_console_tx_ready;
+#endif
+
     /* Initialize the USART related to the console */
     soc_usart_init(&console_config);
     debug_ready = true;
-    dbg_log("[USART%d initialized for console output, baudrate=%d]\n",
-            console_config.usart, console_config.baudrate);
-    dbg_flush();
+    dbg_info("[USART%d initialized for console output, baudrate=%d]\n",
+             console_config.usart, console_config.baudrate);
+#elif defined(CONSOLE_ITM)
+    /* Configure the ITM stimulus ports and the SWO output, on the TRACESWO
+     * pin (not assigned by default, unless a debugger did it) */
+    soc_dbgmcu_trace_enable();
+    core_itm_init(ITM_SWO_PRESCALER, ITM_PORTS);
+    debug_ready = true;
+    dbg_info("[ITM initialized for console output, SWO baudrate=%d]\n",
+             ITM_SWO_BAUDRATE);
 #endif
 }
 
+static void dbg_drain(void);
+
 static void ring_buffer_reset(void)
 {
-    ring_buffer.end = 0;
-    ring_buffer.start = ring_buffer.end;
-    ring_buffer.full = false;
+#if defined(CONSOLE_USART) && defined(CONFIG_LOADER_SERIAL_TX_DMA)
+    /* the span being sent by DMA must not be overwritten */
+    if (dma_inflight != 0) {
+        soc_usart_dma_wait(console_config.usart);
+        dma_inflight = 0;
+    }
+#endif
+#if defined(CONSOLE_USART) && defined(CONFIG_LOADER_SERIAL_TX_IRQ)
+    /* stop the consumer */
+    if (debug_ready) {
+        soc_usart_tx_irq_disable(console_config.usart);
+    }
+#endif
+    ring_buffer.head = 0;
+    ring_buffer.tail = ring_buffer.head;
 
     memset(ring_buffer.buf, 0x0, BUF_MAX);
 }
 
 static inline void ring_buffer_write_char(const char c)
 {
-    /* if the ring buffer is full when we try to put char in it,
-     * the car is discared, waiting for the ring buffer to be flushed.
-     */
-    if (ring_buffer.full) {
-        goto end;
+    if ((ring_buffer.head - ring_buffer.tail) == BUF_MAX) {
+        /* full ring buffer: when the console is ready, make room by
+         * sending the buffer content synchronously, nothing is lost */
+        if (debug_ready) {
+            dbg_drain();
+        }
     }
-    ring_buffer.buf[ring_buffer.end] = c;
-    if (((ring_buffer.end + 1) % BUF_MAX) != ring_buffer.start) {
-        ring_buffer.end++;
-        ring_buffer.end %= BUF_MAX;
-    } else {
-        /* full buffer detection */
-        ring_buffer.full = true;
+    /* if the ring buffer is still full, the char is discarded */
+    if ((ring_buffer.head - ring_buffer.tail) == BUF_MAX) {
+        ring_buffer.dropped++;
+        goto end;
     }
+    ring_buffer.buf[ring_buffer.head & BUF_MASK] = c;
+    ring_buffer_barrier();
+    ring_buffer.head++;
  end:
     return;
 }
 
-/* functions implemented only when serial is activated */
-static inline void ring_buffer_write_digit(uint8_t digit)
+static inline void ring_buffer_write_string(char *str, uint32_t len)
 {
-    if (digit < 0xa) {
-        digit += '0';
-        ring_buffer_write_char(digit);
-    } else if (digit <= 0xf) {
-        digit += 'a' - 0xa;
-        ring_buffer_write_char(digit);
+    if (!str) {
+        goto end;
+    }
+    for (uint32_t i = 0; (i < len) && (str[i]); ++i) {
+        ring_buffer_write_char(str[i]);
     }
+ end:
+    return;
 }
 
-static void ring_buffer_write_number(uint64_t value, uint8_t base)
+/*
+ * Division-free numbers formatting. Cortex-M4 has no 64 bits divide
+ * instruction (libgcc software routine), so the digits are generated
+ * without any division, in one pass, backward in a local buffer:
+ * - hexadecimal and octal digits are extracted by shift and mask
+ * - decimal digits of 32 bits values use a reciprocal multiplication,
+ *   x / 10 == (x * 0xcccccccd) >> 35 for any 32 bits x (UMULL)
+ * - 64 bits values are divided by 10 (shift and add) until they fit
+ *   in 32 bits
+ */
+#define NUMBER_MAX_DIGITS   22  /* 64 bits value, in octal */
+
+typedef struct {
+    char    digits[NUMBER_MAX_DIGITS];
+    uint8_t len;
+} fs_number_t;
+
+static const char number_digits[] = "0123456789abcdef";
+
+static inline uint32_t divu10_32(uint32_t n)
+{
+    return (uint32_t)(((uint64_t)n * 0xcccccccd) >> 35);
+}
+
+static inline uint64_t divu10_64(uint64_t n, uint8_t *rem)
 {
-    /* we define a local storage to hold the digits list
-     * in any possible base up to base 2 (64 bits) */
-    uint8_t number[64] = { 0 };
-    int     index = 0;
+    uint64_t q;
+    uint64_t r;
 
-    for (; (value / base) != 0; value /= base) {
-        number[index++] = value % base;
+    /* q = n * 0.8 (shift and add), then q / 8 = n / 10, by default */
+    q = (n >> 1) + (n >> 2);
+    q += (q >> 4);
+    q += (q >> 8);
+    q += (q >> 16);
+    q += (q >> 32);
+    q >>= 3;
+    r = n - (((q << 2) + q) << 1);
+    /* correction step */
+    while (r >= 10) {
+        q++;
+        r -= 10;
     }
-    /* finishing with most significant unit */
-    number[index++] = value % base;
+    *rem = (uint8_t)r;
+    return q;
+}
+
+static uint8_t format_number(fs_number_t *num, uint64_t value, uint8_t base)
+{
+    char   *p = &num->digits[NUMBER_MAX_DIGITS];
 
-    /* Due to the last 'index++', index is targetting the first free cell.
-     * We make it points the last *used* cell instead */
-    index--;
+    if ((base == 16) || (base == 8)) {
+        uint8_t shift = (base == 16) ? 4 : 3;
 
-    /* now we can print out, starting with the most significant unit */
-    for (; index >= 0; index--) {
-        ring_buffer_write_digit(number[index]);
+        do {
+            *--p = number_digits[value & (base - 1)];
+            value >>= shift;
+        } while (value != 0);
+    } else {
+        uint32_t value32;
+        uint32_t q;
+        uint8_t rem;
+
+        while ((value >> 32) != 0) {
+            value = divu10_64(value, &rem);
+            *--p = number_digits[rem];
+        }
+        value32 = (uint32_t)value;
+        do {
+            q = divu10_32(value32);
+            *--p = number_digits[value32 - (q * 10)];
+            value32 = q;
+        } while (value32 != 0);
     }
+    num->len = &num->digits[NUMBER_MAX_DIGITS] - p;
+    return num->len;
 }
 
-static inline void ring_buffer_write_string(char *str, uint32_t len)
+static inline void ring_buffer_write_number(const fs_number_t *num)
 {
-    if (!str) {
-        goto end;
+    for (uint8_t i = NUMBER_MAX_DIGITS - num->len; i < NUMBER_MAX_DIGITS; ++i) {
+        ring_buffer_write_char(num->digits[i]);
     }
-    for (uint32_t i = 0; (i < len) && (str[i]); ++i) {
-        ring_buffer_write_char(str[i]);
+}
+
+
+
+
+#ifdef CONSOLE_USART
+/* send the ring buffer content, by polling */
+static void dbg_flush_poll(void)
+{
+    while (ring_buffer.tail != ring_buffer.head) {
+        console_putc(ring_buffer.buf[ring_buffer.tail & BUF_MASK]);
+        ring_buffer.tail++;
     }
- end:
-    return;
 }
+#endif
 
+#if defined(CONSOLE_USART) && defined(CONFIG_LOADER_SERIAL_TX_DMA)
+/*
+ * Hand the next contiguous ring buffer span to the console TX DMA stream,
+ * once the previous one is sent (waiting for it if requested). The ring
+ * buffer tail is only moved forward once a span is sent: the span being
+ * sent can't be overwritten by dbg_log().
+ */
+static void dbg_flush_dma(bool wait)
+{
+    uint32_t len;
 
+    if (soc_usart_dma_busy(console_config.usart)) {
+        if (wait == false) {
+            return;
+        }
+        soc_usart_dma_wait(console_config.usart);
+    }
+    if (dma_inflight != 0) {
+        ring_buffer.tail += dma_inflight;
+        dma_inflight = 0;
+    }
+    len = ring_buffer.head - ring_buffer.tail;
+    if (len == 0) {
+        return;
+    }
+    /* up to the end of the buffer, the remaining will be sent next */
+    if (len > (BUF_MAX - (ring_buffer.tail & BUF_MASK))) {
+        len = BUF_MAX - (ring_buffer.tail & BUF_MASK);
+    }
+    if (soc_usart_dma_write(console_config.usart,
+                            &ring_buffer.buf[ring_buffer.tail & BUF_MASK], len) == 0) {
+        dma_inflight = len;
+        return;
+    }
+    /* no DMA for this USART: fallback to polling mode */
+    dbg_flush_poll();
+}
 
+/* send all the ring buffer content, and wait for its transmission */
+static void dbg_drain(void)
+{
+    if (!debug_ready) {
+        return;
+    }
+    while ((dma_inflight != 0) || (ring_buffer.tail != ring_buffer.head)) {
+        dbg_flush_dma(true);
+    }
+    soc_usart_wait_tx_complete(console_config.usart);
+}
 
-#ifdef CONFIG_LOADER_SERIAL
+/* flush behavior with activated serial and DMA: start sending the ring
+ * buffer content, without waiting for it... */
+void dbg_flush(void)
+{
+    if (!debug_ready) {
+        return;
+    }
+    if (console_putc == NULL) {
+        panic("Error: console_putc not initialized");
+    }
+    dbg_flush_dma(false);
+}
+#elif defined(CONSOLE_USART) && defined(CONFIG_LOADER_SERIAL_TX_IRQ)
+/*
+ * send all the ring buffer content, and wait for its transmission. The
+ * TXE interrupt is disabled first: the caller becomes the ring buffer
+ * consumer (this works whatever the current execution context is, e.g.
+ * fault handlers)
+ */
+static void dbg_drain(void)
+{
+    if (!debug_ready) {
+        return;
+    }
+    soc_usart_tx_irq_disable(console_config.usart);
+    dbg_flush_poll();
+    soc_usart_wait_tx_complete(console_config.usart);
+}
+
+/* flush behavior with activated serial and TXE interrupt: the ring buffer
+ * is sent in background by the TXE interrupt... */
+void dbg_flush(void)
+{
+    if (!debug_ready) {
+        return;
+    }
+    if (console_putc == NULL) {
+        panic("Error: console_putc not initialized");
+    }
+    if (ring_buffer.tail != ring_buffer.head) {
+        soc_usart_tx_irq_enable(console_config.usart);
+    }
+}
+#elif defined(CONSOLE_USART)
 /* flush behavior with activated serial... */
 void dbg_flush(void)
 {
@@ -225,32 +503,185 @@ void dbg_flush(void)
     if (console_putc == NULL) {
         panic("Error: console_putc not initialized");
     }
-    while (ring_buffer.start != ring_buffer.end) {
-        console_putc(ring_buffer.buf[ring_buffer.start++]);
-        ring_buffer.start %= BUF_MAX;
+    dbg_flush_poll();
+}
+
+static void dbg_drain(void)
+{
+    dbg_flush();
+    if (debug_ready) {
+        soc_usart_wait_tx_complete(console_config.usart);
+    }
+}
+#elif defined(CONSOLE_ITM)
+/* flush behavior with ITM: the ring buffer content is written to the
+ * console stimulus port, 4 characters per write... */
+void dbg_flush(void)
+{
+    uint32_t word;
+
+    if (!debug_ready) {
+        return;
+    }
+    while ((ring_buffer.head - ring_buffer.tail) >= 4) {
+        word = (uint32_t)(uint8_t)ring_buffer.buf[ring_buffer.tail & BUF_MASK] |
+               ((uint32_t)(uint8_t)ring_buffer.buf[(ring_buffer.tail + 1) & BUF_MASK] << 8) |
+               ((uint32_t)(uint8_t)ring_buffer.buf[(ring_buffer.tail + 2) & BUF_MASK] << 16) |
+               ((uint32_t)(uint8_t)ring_buffer.buf[(ring_buffer.tail + 3) & BUF_MASK] << 24);
+        core_itm_write_u32(ITM_PORT_CONSOLE, word);
+        ring_buffer.tail += 4;
+    }
+    while (ring_buffer.tail != ring_buffer.head) {
+        core_itm_write_u8(ITM_PORT_CONSOLE, ring_buffer.buf[ring_buffer.tail & BUF_MASK]);
+        ring_buffer.tail++;
+    }
+}
+
+static void dbg_drain(void)
+{
+    dbg_flush();
+    if (debug_ready) {
+        core_itm_wait_idle();
     }
 }
 #else
 /* ... or in /dev/null mode */
 void dbg_flush(void)
 {
-    ring_buffer.start = ring_buffer.end;
+    ring_buffer.tail = ring_buffer.head;
+}
+
+static void dbg_drain(void)
+{
+    dbg_flush();
 }
 #endif
 
-static uint8_t get_number_len(uint64_t value, uint8_t base)
+#ifdef CONSOLE_ITM
+/*
+ * With ITM, each log is preceded by its timestamp (DWT cycle counter) on
+ * the timestamp stimulus port, and is written to the console stimulus port
+ * at once: the host sees the timestamps and the logs in order.
+ */
+static inline void dbg_log_start(void)
+{
+    core_itm_write_u32(ITM_PORT_TIMESTAMP, soc_dwt_getcycles());
+}
+
+static inline void dbg_log_end(void)
 {
-    /* at least, if value is 0, its lenght is 1 digit */
-    uint8_t len = 1;
+    dbg_flush();
+}
 
-    /* now we calculate the number of digits in the number */
-    for (; (value / base) != 0; value /= base) {
-        len++;
+void dbg_trace_state(uint32_t new_state)
+{
+    if (!debug_ready) {
+        return;
     }
-    return len;
+    core_itm_write_u32(ITM_PORT_TIMESTAMP, soc_dwt_getcycles());
+    core_itm_write_u32(ITM_PORT_STATE, new_state);
+}
+#else
+static inline void dbg_log_start(void)
+{
 }
 
+static inline void dbg_log_end(void)
+{
+}
+#endif
 
+#if LOADER_LOGLEVEL >= 6
+/*
+ * Canonical hexdump (hexdump -C format, without the repeated lines
+ * compression), e.g.:
+ *
+ * 00000000  30 31 32 33 34 35 36 37  38 39 61 62 63 64 65 66  |0123456789abcdef|
+ * 00000010  0a                                                |.|
+ * 00000011
+ *
+ * Each line is formatted in a local buffer, through the digits table, then
+ * written to the ring buffer and flushed at once.
+ */
+#define HEXDUMP_BYTES_PER_LINE  16
+/* offset, hexadecimal bytes, ascii bytes between '|', \r\n */
+#define HEXDUMP_LINE_MAX        (8 + 2 + (3 * HEXDUMP_BYTES_PER_LINE) + 1 + \
+                                 2 + HEXDUMP_BYTES_PER_LINE + 1 + 2)
+
+static inline uint32_t hexdump_put_hex(char *line, uint32_t pos, uint32_t val,
+                                       uint8_t digits)
+{
+    for (uint8_t i = digits; i > 0; --i) {
+        line[pos + i - 1] = number_digits[val & 0xf];
+        val >>= 4;
+    }
+    return pos + digits;
+}
+
+static inline uint32_t hexdump_put_eol(char *line, uint32_t pos)
+{
+    line[pos++] = '\r';
+    line[pos++] = '\n';
+    return pos;
+}
+
+static void hexdump_write_line(const char *line, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        ring_buffer_write_char(line[i]);
+    }
+    dbg_flush();
+}
+
+void dbg_hexdump(const uint8_t *bin, uint32_t len)
+{
+    char    line[HEXDUMP_LINE_MAX];
+    uint32_t offset;
+    uint32_t pos;
+    uint32_t count;
+    uint32_t i;
+
+    if (!debug_ready || (bin == NULL)) {
+        return;
+    }
+    dbg_log_start();
+    for (offset = 0; offset < len; offset += HEXDUMP_BYTES_PER_LINE) {
+        count = len - offset;
+        if (count > HEXDUMP_BYTES_PER_LINE) {
+            count = HEXDUMP_BYTES_PER_LINE;
+        }
+        pos = hexdump_put_hex(line, 0, offset, 8);
+        line[pos++] = ' ';
+        for (i = 0; i < HEXDUMP_BYTES_PER_LINE; ++i) {
+            if (i == (HEXDUMP_BYTES_PER_LINE / 2)) {
+                line[pos++] = ' ';
+            }
+            line[pos++] = ' ';
+            if (i < count) {
+                pos = hexdump_put_hex(line, pos, bin[offset + i], 2);
+            } else {
+                /* keep the ascii column aligned */
+                line[pos++] = ' ';
+                line[pos++] = ' ';
+            }
+        }
+        line[pos++] = ' ';
+        line[pos++] = ' ';
+        line[pos++] = '|';
+        for (i = 0; i < count; ++i) {
+            line[pos++] = ((bin[offset + i] >= 0x20) && (bin[offset + i] < 0x7f)) ?
+                          (char)bin[offset + i] : '.';
+        }
+        line[pos++] = '|';
+        pos = hexdump_put_eol(line, pos);
+        hexdump_write_line(line, pos);
+    }
+    /* final offset: the dump length */
+    pos = hexdump_put_hex(line, 0, len, 8);
+    pos = hexdump_put_eol(line, pos);
+    hexdump_write_line(line, pos);
+}
+#endif
 
 typedef enum {
     FS_NUM_DECIMAL,
@@ -356,7 +787,8 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                     }
                     fs_prop.numeric_mode = FS_NUM_DECIMAL;
                     int     val = va_arg(*args, int);
-                    uint8_t len = get_number_len(val, 10);
+                    fs_number_t num;
+                    uint8_t len = format_number(&num, val, 10);
 
                     if (fs_prop.attr_size && fs_prop.attr_0len) {
                         /* we have to pad with 0 the number to reach
@@ -367,7 +799,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         }
                     }
                     /* now we can print the number in argument */
-                    ring_buffer_write_number(val, 10);
+                    ring_buffer_write_number(&num);
                     fs_prop.strlen += len;
                     /* => end of format string */
                     goto end;
@@ -377,8 +809,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                     /*
                      * Handling long and long long int
                      */
-                    long    lval = 0;
-                    long long llval = 0;
+                    fs_number_t num;
                     uint8_t len;
 
                     if (fs_prop.started == false) {
@@ -391,13 +822,9 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         fs_prop.consumed++;
                     }
                     if (fs_prop.numeric_mode == FS_NUM_LONG) {
-                        lval = va_arg(*args, long);
-
-                        len = get_number_len(lval, 10);
+                        len = format_number(&num, va_arg(*args, long), 10);
                     } else {
-                        llval = va_arg(*args, long long);
-
-                        len = get_number_len(llval, 10);
+                        len = format_number(&num, va_arg(*args, long long), 10);
                     }
                     if (fs_prop.attr_size && fs_prop.attr_0len) {
                         /* we have to pad with 0 the number to reach
@@ -408,11 +835,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         }
                     }
                     /* now we can print the number in argument */
-                    if (fs_prop.numeric_mode == FS_NUM_LONG) {
-                        ring_buffer_write_number(lval, 10);
-                    } else {
-                        ring_buffer_write_number(llval, 10);
-                    }
+                    ring_buffer_write_number(&num);
                     fs_prop.strlen += len;
                     /* => end of format string */
                     goto end;
@@ -428,7 +851,8 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                     }
                     fs_prop.numeric_mode = FS_NUM_UNSIGNED;
                     uint32_t val = va_arg(*args, uint32_t);
-                    uint8_t len = get_number_len(val, 10);
+                    fs_number_t num;
+                    uint8_t len = format_number(&num, val, 10);
 
                     if (fs_prop.attr_size && fs_prop.attr_0len) {
                         /* we have to pad with 0 the number to reach
@@ -439,7 +863,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         }
                     }
                     /* now we can print the number in argument */
-                    ring_buffer_write_number(val, 10);
+                    ring_buffer_write_number(&num);
                     fs_prop.strlen += len;
                     /* => end of format string */
                     goto end;
@@ -454,7 +878,8 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         goto err;
                     }
                     uint32_t val = va_arg(*args, physaddr_t);
-                    uint8_t len = get_number_len(val, 16);
+                    fs_number_t num;
+                    uint8_t len = format_number(&num, val, 16);
 
                     ring_buffer_write_string("0x", 2);
                     for (uint32_t i = len; i < fs_prop.size; ++i) {
@@ -462,7 +887,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         fs_prop.strlen++;
                     }
                     /* now we can print the number in argument */
-                    ring_buffer_write_number(val, 16);
+                    ring_buffer_write_number(&num);
                     fs_prop.strlen += len;
                     /* => end of format string */
                     goto end;
@@ -478,7 +903,8 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                     }
                     fs_prop.numeric_mode = FS_NUM_UNSIGNED;
                     uint32_t val = va_arg(*args, uint32_t);
-                    uint8_t len = get_number_len(val, 16);
+                    fs_number_t num;
+                    uint8_t len = format_number(&num, val, 16);
 
                     if (fs_prop.attr_size && fs_prop.attr_0len) {
                         /* we have to pad with 0 the number to reach
@@ -489,7 +915,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         }
                     }
                     /* now we can print the number in argument */
-                    ring_buffer_write_number(val, 16);
+                    ring_buffer_write_number(&num);
                     fs_prop.strlen += len;
                     /* => end of format string */
                     goto end;
@@ -504,7 +930,8 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                     }
                     fs_prop.numeric_mode = FS_NUM_UNSIGNED;
                     uint32_t val = va_arg(*args, uint32_t);
-                    uint8_t len = get_number_len(val, 8);
+                    fs_number_t num;
+                    uint8_t len = format_number(&num, val, 8);
 
                     if (fs_prop.attr_size && fs_prop.attr_0len) {
                         /* we have to pad with 0 the number to reach
@@ -515,7 +942,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
                         }
                     }
                     /* now we can print the number in argument */
-                    ring_buffer_write_number(val, 8);
+                    ring_buffer_write_number(&num);
                     fs_prop.strlen += len;
 
                     /* => end of format string */
@@ -565,7 +992,7 @@ static inline uint8_t print_handle_format_string(const char *fmt, va_list * args
 }
 
 
-static int print(const char *fmt, va_list args, logsize_t *sizew)
+static int print(const char *fmt, va_list *args, logsize_t *sizew)
 {
     int     i = 0;
     uint8_t consumed = 0;
@@ -574,7 +1001,7 @@ static int print(const char *fmt, va_list args, logsize_t *sizew)
     while (fmt[i]) {
         if (fmt[i] == '%') {
             if (print_handle_format_string
-                (&(fmt[i]), &args, &consumed, &out_str_s)) {
+                (&(fmt[i]), args, &consumed, &out_str_s)) {
                 /* the string format parsing has failed ! */
                 goto err;
             }
@@ -598,6 +1025,7 @@ static int print(const char *fmt, va_list args, logsize_t *sizew)
     return -1;
 }
 
+#ifndef CONFIG_LOADER_SERIAL_TOKENIZED
 int dbg_log(const char *fmt, ...)
 {
     int     res = -1;
@@ -611,16 +1039,135 @@ int dbg_log(const char *fmt, ...)
      * if there is some asyncrhonous printf to pass to the kernel, do it
      * before execute the current printf command
      */
+    dbg_log_start();
     va_start(args, fmt);
-    res = print(fmt, args, &len);
+    res = print(fmt, &args, &len);
     va_end(args);
     if (res == -1) {
         ring_buffer_reset();
         goto err;
     }
+    dbg_log_end();
  err:
     return res;
 }
+#else
+/*
+ * Tokenized log record, decoded by tools/dbg_decode.py:
+ *
+ *   sync (0xa5) | payload length | id (16 bits) | payload
+ *
+ * all values being little endian. The payload holds the arguments, in order:
+ * 32 bits words, 64 bits words, or NUL terminated strings (truncated if
+ * needed). The sync byte can't be part of the plain text output (panic()),
+ * which may be interleaved with the records.
+ */
+#define DBG_TOKEN_SYNC          0xa5
+#define DBG_TOKEN_HDR_LEN       4
+#if BUF_MAX < (DBG_TOKEN_HDR_LEN + 255)
+# define DBG_TOKEN_MAX_PAYLOAD  (BUF_MAX - DBG_TOKEN_HDR_LEN)
+#else
+# define DBG_TOKEN_MAX_PAYLOAD  255
+#endif
+
+static inline uint32_t token_put_byte(uint8_t *record, uint32_t len, uint8_t val)
+{
+    record[len] = val;
+    return len + 1;
+}
+
+static inline uint32_t token_put_word(uint8_t *record, uint32_t len, uint32_t val)
+{
+    len = token_put_byte(record, len, val & 0xff);
+    len = token_put_byte(record, len, (val >> 8) & 0xff);
+    len = token_put_byte(record, len, (val >> 16) & 0xff);
+    len = token_put_byte(record, len, (val >> 24) & 0xff);
+    return len;
+}
+
+/* a record is written as a whole, or dropped */
+static void ring_buffer_write_record(const uint8_t *record, uint32_t len)
+{
+    if ((BUF_MAX - (ring_buffer.head - ring_buffer.tail)) < len) {
+        dbg_drain();
+    }
+    if ((BUF_MAX - (ring_buffer.head - ring_buffer.tail)) < len) {
+        ring_buffer.dropped += len;
+        goto end;
+    }
+    for (uint32_t i = 0; i < len; ++i) {
+        ring_buffer_write_char(record[i]);
+    }
+ end:
+    return;
+}
+
+int dbg_log_token(uint32_t id, uint32_t desc, ...)
+{
+    uint8_t record[DBG_TOKEN_HDR_LEN + DBG_TOKEN_MAX_PAYLOAD];
+    uint32_t len = DBG_TOKEN_HDR_LEN;
+    va_list args;
+    int     res = -1;
+
+    if (!debug_ready) {
+        return 0;
+    }
+    dbg_log_start();
+    va_start(args, desc);
+    for (; desc != DBG_ARG_NONE; desc >>= 2) {
+        switch (desc & 0x3) {
+            case DBG_ARG_U32:
+                {
+                    uint32_t val = va_arg(args, uint32_t);
+
+                    if ((len + 4) > sizeof(record)) {
+                        goto err;
+                    }
+                    len = token_put_word(record, len, val);
+                    break;
+                }
+            case DBG_ARG_U64:
+                {
+                    uint64_t val = va_arg(args, uint64_t);
+
+                    if ((len + 8) > sizeof(record)) {
+                        goto err;
+                    }
+                    len = token_put_word(record, len, (uint32_t)val);
+                    len = token_put_word(record, len, (uint32_t)(val >> 32));
+                    break;
+                }
+            case DBG_ARG_STR:
+                {
+                    const char *str = va_arg(args, const char *);
+
+                    if ((len + 1) > sizeof(record)) {
+                        goto err;
+                    }
+                    /* keep room for the NUL character */
+                    for (; (str != NULL) && (*str != '\0') &&
+                           ((len + 1) < sizeof(record)); str++) {
+                        len = token_put_byte(record, len, *str);
+                    }
+                    len = token_put_byte(record, len, '\0');
+                    break;
+                }
+            default:
+                goto err;
+        }
+    }
+    record[0] = DBG_TOKEN_SYNC;
+    record[1] = (uint8_t)(len - DBG_TOKEN_HDR_LEN);
+    record[2] = id & 0xff;
+    record[3] = (id >> 8) & 0xff;
+    ring_buffer_write_record(record, len);
+    dbg_log_end();
+    res = 0;
+ err:
+    va_end(args);
+    return res;
+}
+#endif
 
 /* WARNING: if LOADER_SERIAL is not enabled, panic doesn't printout any
  * information */
@@ -630,9 +1177,9 @@ void panic(char *fmt, ...)
     logsize_t  len;
 
     va_start(args, fmt);
-    print(fmt, args, &len);
+    print(fmt, &args, &len);
     va_end(args);
-    dbg_flush();
+    dbg_drain();
 #if CONFIG_KERNEL_PANIC_FREEZE
     while (1)
         continue;
@@ -649,8 +1196,18 @@ void panic(char *fmt, ...)
 
 void debug_release(void)
 {
-
-#ifdef CONFIG_LOADER_SERIAL
+    if (ring_buffer.dropped != 0) {
+        dbg_warn("[%d console chars dropped]\n", ring_buffer.dropped);
+    }
+    /* the pending logs are sent before releasing the console */
+    dbg_drain();
+#ifdef CONSOLE_USART
+    debug_ready = false;
     soc_usart_release(&console_config);
+#elif defined(CONSOLE_ITM)
+    /* the firmware doesn't inherit the loader trace configuration */
+    debug_ready = false;
+    core_itm_release();
+    soc_dbgmcu_trace_disable();
 #endif
 }
@@ -56,11 +56,73 @@ typedef enum {
     DBG_DEBUG = 7,
 } e_dbglevel_t;
 
+#ifdef CONFIG_LOADER_SERIAL_TOKENIZED
+/*
+ * Tokenized console: the format strings are not loaded in flash, but kept in
+ * the .dbg_fmt ELF section, their offset in this section being the message
+ * identifier. Each dbg_log() call only pushes a binary record, holding this
+ * identifier and the raw arguments, in the ring buffer. The console stream is
+ * decoded on the host side by tools/dbg_decode.py, using the loader ELF file.
+ *
+ * The argument types are described by a 2 bits per argument descriptor,
+ * calculated at build time.
+ */
+#define DBG_ARG_NONE    0
+#define DBG_ARG_U32     1
+#define DBG_ARG_U64     2
+#define DBG_ARG_STR     3
+
+#define DBG_ARG_TYPE(a) _Generic((a),                                  \
+        char *: DBG_ARG_STR,                                           \
+        const char *: DBG_ARG_STR,                                     \
+        default: ((sizeof((a) + 0) == 8) ? DBG_ARG_U64 : DBG_ARG_U32))
+
+#define DBG_DESC_0()        DBG_ARG_NONE
+#define DBG_DESC_1(a)       DBG_ARG_TYPE(a)
+#define DBG_DESC_2(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_1(__VA_ARGS__) << 2))
+#define DBG_DESC_3(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_2(__VA_ARGS__) << 2))
+#define DBG_DESC_4(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_3(__VA_ARGS__) << 2))
+#define DBG_DESC_5(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_4(__VA_ARGS__) << 2))
+#define DBG_DESC_6(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_5(__VA_ARGS__) << 2))
+#define DBG_DESC_7(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_6(__VA_ARGS__) << 2))
+#define DBG_DESC_8(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_7(__VA_ARGS__) << 2))
+#define DBG_DESC_9(a, ...)  (DBG_ARG_TYPE(a) | (DBG_DESC_8(__VA_ARGS__) << 2))
+#define DBG_DESC_10(a, ...) (DBG_ARG_TYPE(a) | (DBG_DESC_9(__VA_ARGS__) << 2))
+#define DBG_DESC_11(a, ...) (DBG_ARG_TYPE(a) | (DBG_DESC_10(__VA_ARGS__) << 2))
+#define DBG_DESC_12(a, ...) (DBG_ARG_TYPE(a) | (DBG_DESC_11(__VA_ARGS__) << 2))
+
+#define DBG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, N, ...) N
+#define DBG_NARGS(...) \
+    DBG_NARGS_(_, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DBG_CAT_(a, b)      a##b
+#define DBG_CAT(a, b)       DBG_CAT_(a, b)
+#define DBG_DESC(...) \
+    DBG_CAT(DBG_DESC_, DBG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+/**
+ * dbg_log_token - push a tokenized log record in ring buffer
+ * @id: format string offset in the .dbg_fmt section
+ * @desc: arguments types descriptor
+ */
+int dbg_log_token(uint32_t id, uint32_t desc, ...);
+
+/**
+ * dbg_log - log strings in ring buffer
+ * @fmt: format string (must be a string literal)
+ */
+#define dbg_log(fmt, ...) ({                                            \
+    static const char __dbg_fmt[]                                       \
+        __attribute__((section(".dbg_fmt"), used)) = fmt;               \
+    dbg_log_token((uint32_t)__dbg_fmt, DBG_DESC(__VA_ARGS__),           \
+                  ##__VA_ARGS__);                                       \
+})
+#else
 /**
  * dbg_log - log strings in ring buffer
  * @fmt: format string
  */
 int dbg_log(const char *fmt, ...);
+#endif
 
 /**
  * menuconfig controlled debug print
@@ -76,6 +138,79 @@ void debug_console_init(void);
  */
 void dbg_flush(void);
 
+/**
+ * dbg_trace_state - trace an automaton state transition on the ITM state
+ * stimulus port (ITM console backend only)
+ * @new_state: the new automaton state
+ */
+#if defined(CONFIG_LOADER_SERIAL) && defined(CONFIG_LOADER_CONSOLE_BACKEND_ITM)
+void dbg_trace_state(uint32_t new_state);
+#else
+# define dbg_trace_state(new_state) do { (void)(new_state); } while (0)
+#endif
+
+/*
+ * Leveled logging, filtered at build time: the logs above the
+ * CONFIG_LOADER_LOGLEVEL syslog level are removed by the preprocessor,
+ * with their format string and the evaluation of their arguments (which are
+ * only referenced in an unevaluated sizeof() to keep them type-checked and
+ * used). Without serial console, all the logs are removed.
+ * Each log is flushed.
+ */
+#ifdef CONFIG_LOADER_LOGLEVEL
+# define LOADER_LOGLEVEL CONFIG_LOADER_LOGLEVEL
+#else
+# define LOADER_LOGLEVEL -1
+#endif
+
+/* never defined, only used in unevaluated context */
+int dbg_log_removed(const char *fmt, ...);
+
+#define dbg_log_level_on(fmt, ...) \
+    do { dbg_log(fmt, ##__VA_ARGS__); dbg_flush(); } while (0)
+#define dbg_log_level_off(fmt, ...) \
+    do { (void)sizeof(dbg_log_removed(fmt, ##__VA_ARGS__)); } while (0)
+
+/* DBG_ERR */
+#if LOADER_LOGLEVEL >= 3
+# define dbg_err(fmt, ...)      dbg_log_level_on(fmt, ##__VA_ARGS__)
+#else
+# define dbg_err(fmt, ...)      dbg_log_level_off(fmt, ##__VA_ARGS__)
+#endif
+
+/* DBG_WARN */
+#if LOADER_LOGLEVEL >= 4
+# define dbg_warn(fmt, ...)     dbg_log_level_on(fmt, ##__VA_ARGS__)
+#else
+# define dbg_warn(fmt, ...)     dbg_log_level_off(fmt, ##__VA_ARGS__)
+#endif
+
+/* DBG_INFO */
+#if LOADER_LOGLEVEL >= 6
+# define dbg_info(fmt, ...)     dbg_log_level_on(fmt, ##__VA_ARGS__)
+#else
+# define dbg_info(fmt, ...)     dbg_log_level_off(fmt, ##__VA_ARGS__)
+#endif
+
+/* DBG_DEBUG */
+#if LOADER_LOGLEVEL >= 7
+# define dbg_debug(fmt, ...)    dbg_log_level_on(fmt, ##__VA_ARGS__)
+#else
+# define dbg_debug(fmt, ...)    dbg_log_level_off(fmt, ##__VA_ARGS__)
+#endif
+
+/**
+ * dbg_hexdump - canonical hexdump (hexdump -C format) of a buffer, logged at
+ * DBG_INFO level
+ * @bin: buffer to dump
+ * @len: buffer length
+ */
+#if LOADER_LOGLEVEL >= 6
+void dbg_hexdump(const uint8_t *bin, uint32_t len);
+#else
+# define dbg_hexdump(bin, len)  do { (void)(bin); (void)(len); } while (0)
+#endif
+
 /**
  * panic - output string on UART, flush ring buffer and stop
  * @fmt: format string
@@ -37,6 +37,9 @@
 #include "debug.h"
 #include "soc-scb.h"
 #include "main.h"
+#ifdef CONFIG_LOADER_FLASH_ASYNC
+#include "flash.h"
+#endif
 
 
 /*
@@ -55,25 +58,22 @@ static stack_frame_t *HardFault_Handler(stack_frame_t * frame)
     uint32_t   *p;
     int         i;
 
-    dbg_log("\nHard fault\n  scb.hfsr %x  scb.cfsr %x\n", hfsr, cfsr);
-    dbg_flush();
+    dbg_err("\nHard fault\n  scb.hfsr %x  scb.cfsr %x\n", hfsr, cfsr);
 
-    dbg_log("-- registers (frame at %x, EXC_RETURN  %x)\n", frame, frame->lr);
-    dbg_log("  r0  %x\t r1  %x\t r2  %x\t r3  %x\n",
+    dbg_err("-- registers (frame at %x, EXC_RETURN  %x)\n", frame, frame->lr);
+    dbg_err("  r0  %x\t r1  %x\t r2  %x\t r3  %x\n",
         frame->r0, frame->r1, frame->r2, frame->r3);
-    dbg_log("  r4  %x\t r5  %x\t r6  %x\t r7  %x\n",
+    dbg_err("  r4  %x\t r5  %x\t r6  %x\t r7  %x\n",
         frame->r4, frame->r5, frame->r6, frame->r7);
-    dbg_log("  r8  %x\t r9  %x\t r10 %x\t r11 %x\n",
+    dbg_err("  r8  %x\t r9  %x\t r10 %x\t r11 %x\n",
         frame->r8, frame->r9, frame->r10, frame->r11);
-    dbg_log("  r12 %x\t pc  %x\t lr %x\n",
+    dbg_err("  r12 %x\t pc  %x\t lr %x\n",
         frame->r12, frame->pc, frame->prev_lr);
-    dbg_flush();
 
     p = (uint32_t*) ((uint32_t) frame & 0xfffffff0);
-    dbg_log("-- stack trace\n");
+    dbg_err("-- stack trace\n");
     for (i=0;i<8;i++) {
-        dbg_log("  %x: %x  %x  %x  %x\n", p, p[0], p[1], p[2], p[3]);
-        dbg_flush();
+        dbg_err("  %x: %x  %x  %x  %x\n", p, p[0], p[1], p[2], p[3]);
         p = p + 4;
     }
     /* Non kernel mode (e.g. loader mode) */
@@ -125,7 +125,14 @@ __ISR_HANDLER stack_frame_t *Default_SubHandler(stack_frame_t * stack_frame)
     }
 #endif
 
-#ifdef CONFIG_LOADER_ALLOW_SERIAL_RX
+#if CONFIG_WOOKEY && defined(CONFIG_FIRMWARE_DFU)
+    /* DFU button */
+    if (int_num == EXTI4_IRQ) {
+        exti_button_handler(int_num, 0, 0);
+    }
+#endif
+
+#if defined(CONFIG_LOADER_ALLOW_SERIAL_RX) || defined(CONFIG_LOADER_SERIAL_TX_IRQ)
 #ifdef CONFIG_LOADER_CONSOLE_USART1
     if (int_num == USART1_IRQ) {
         USART1_IRQ_Handler(stack_frame);
@@ -141,6 +148,12 @@ __ISR_HANDLER stack_frame_t *Default_SubHandler(stack_frame_t * stack_frame)
         USART6_IRQ_Handler(stack_frame);
     }
 #endif
+#endif
+
+#ifdef CONFIG_LOADER_FLASH_ASYNC
+    if (int_num == FLASH_IRQ) {
+        flash_irq_handler();
+    }
 #endif
     asm volatile
        ("mov r1, #0" ::: "r1");
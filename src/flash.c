@@ -45,15 +45,41 @@
 #include "libc.h"
 #include "soc-rng.h"
 #include "debug.h"
+#ifdef CONFIG_LOADER_FLASH_ASYNC
+#include "soc-interrupts.h"
+#include "soc-nvic.h"
+#include "m4-cpu.h"
+#endif
+
+/*
+ * With bank level erase, the bank 2 sectors are replaced by a single bank
+ * erase step, right after the bank 1 keybags sectors, which are still
+ * erased first. The bank 1 holds the running loader: its sectors are still
+ * erased one by one.
+ */
+#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK) && !defined(CONFIG_LOADER_ERASE_BANK2_MASS)
+# define ERASE_BANK2_SECTORS
+#endif
+
+/*
+ * The 1MB dual bank layout has no sectors 8 to 11 and 20 to 23 (no
+ * keybags sectors): they are skipped.
+ */
 
 const physaddr_t sectors_toerase[] = {
     /* first, cleaning nominal usersapce content
      * (clear encrypted keybags) */
+#ifdef FLASH_SECTOR_8
     FLASH_SECTOR_8,
     FLASH_SECTOR_9,
     FLASH_SECTOR_10,
     FLASH_SECTOR_11,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#endif
+#if defined(CONFIG_LOADER_ERASE_BANK2_MASS)
+    /* the whole bank 2 (keybags included), with a single bank erase */
+    FLASH_BANK2_START,
+#endif
+#if defined(ERASE_BANK2_SECTORS) && defined(FLASH_SECTOR_20)
     FLASH_SECTOR_20,
     FLASH_SECTOR_21,
     FLASH_SECTOR_22,
@@ -62,20 +88,20 @@ const physaddr_t sectors_toerase[] = {
     /* now flash DFU content (clear hability to update) */
     FLASH_SECTOR_6,
     FLASH_SECTOR_7,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#if defined(ERASE_BANK2_SECTORS)
     FLASH_SECTOR_18,
     FLASH_SECTOR_19,
 #endif
     /* now erase kernels */
     FLASH_SECTOR_5,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#if defined(ERASE_BANK2_SECTORS)
     FLASH_SECTOR_17,
 #endif
     /* and bootinfo (bootloader will fail forever) */
     FLASH_SECTOR_2,
     FLASH_SECTOR_3,
     FLASH_SECTOR_4,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#if defined(ERASE_BANK2_SECTORS)
     FLASH_SECTOR_14,
     FLASH_SECTOR_15,
     FLASH_SECTOR_16,
@@ -83,11 +109,16 @@ const physaddr_t sectors_toerase[] = {
 };
 
 const physaddr_t sectors_toerase_end[] = {
+#ifdef FLASH_SECTOR_8
     FLASH_SECTOR_8_END,
     FLASH_SECTOR_9_END,
     FLASH_SECTOR_10_END,
     FLASH_SECTOR_11_END,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#endif
+#if defined(CONFIG_LOADER_ERASE_BANK2_MASS)
+    FLASH_BANK2_END,
+#endif
+#if defined(ERASE_BANK2_SECTORS) && defined(FLASH_SECTOR_20)
     FLASH_SECTOR_20_END,
     FLASH_SECTOR_21_END,
     FLASH_SECTOR_22_END,
@@ -96,20 +127,20 @@ const physaddr_t sectors_toerase_end[] = {
     /* now flash DFU content (clear hability to update) */
     FLASH_SECTOR_6_END,
     FLASH_SECTOR_7_END,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#if defined(ERASE_BANK2_SECTORS)
     FLASH_SECTOR_18_END,
     FLASH_SECTOR_19_END,
 #endif
     /* now erase kernels */
     FLASH_SECTOR_5_END,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#if defined(ERASE_BANK2_SECTORS)
     FLASH_SECTOR_17_END,
 #endif
     /* and bootinfo (bootloader will fail forever) */
     FLASH_SECTOR_2_END,
     FLASH_SECTOR_3_END,
     FLASH_SECTOR_4_END,
-#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+#if defined(ERASE_BANK2_SECTORS)
     FLASH_SECTOR_14_END,
     FLASH_SECTOR_15_END,
     FLASH_SECTOR_16_END,
@@ -136,13 +167,36 @@ static uint8_t otp_lock_default_value = 0xff;
 
 #define FLASH_DEBUG 0
 
-/* Primitive for debug output */
+/* Primitive for flash driver traces (errors are always logged) */
 #if FLASH_DEBUG
-#define log_printf(...) do { dbg_log(__VA_ARGS__); dbg_flush(); } while(0);
+#define log_printf(...) dbg_debug(__VA_ARGS__)
 #else
 #define log_printf(...)
 #endif
 
+/*
+ * Programming parallelism (PSIZE) allowed by the supply voltage range,
+ * used by the erase and the buffered programming
+ */
+#if defined(CONFIG_LOADER_FLASH_VRANGE_1V8)
+# define FLASH_PSIZE_MAX    0   /* x8 */
+#elif defined(CONFIG_LOADER_FLASH_VRANGE_2V1)
+# define FLASH_PSIZE_MAX    1   /* x16 */
+#elif defined(CONFIG_LOADER_FLASH_VRANGE_VPP)
+# define FLASH_PSIZE_MAX    3   /* x64 */
+#else
+# define FLASH_PSIZE_MAX    2   /* x32 */
+#endif
+
+#ifdef CONFIG_LOADER_FLASH_ASYNC
+/* asynchronous programming parallelism: words, or narrower */
+# if FLASH_PSIZE_MAX < 2
+#  define FLASH_ASYNC_PSIZE FLASH_PSIZE_MAX
+# else
+#  define FLASH_ASYNC_PSIZE 2
+# endif
+#endif
+
 #ifndef assert
 #define assert(val) if (!(val)) { log_printf("bkpt"); while(1){}; };
 #endif
@@ -195,7 +249,7 @@ int flash_unlock(void)
 
     /* checking that flash CR unlock worked */
     if (get_reg(r_CORTEX_M_FLASH_CR, FLASH_CR_LOCK) == 1) {
-	   log_printf("flash unlocking failed !\n");
+	   dbg_err("flash unlocking failed !\n");
        return 1;
     }
     return 0;
@@ -235,56 +289,59 @@ void flash_lock_opt(void)
 	set_reg(r_CORTEX_M_FLASH_OPTCR, 1, FLASH_OPTCR_OPTLOCK); /* Same as previously */
 }
 
-static bool is_sector_start(physaddr_t addr)
+/*
+ * Flash geometry, generated from the sectors list of the configured flash
+ * device (see flash.h), sorted by address
+ */
+typedef struct {
+    physaddr_t base;
+    uint32_t   size;
+    uint8_t    num;
+    uint8_t    snb;
+} flash_sector_t;
+
+#define FLASH_SECTOR_DESC(n, snb) \
+    { FLASH_SECTOR_##n, FLASH_SECTOR_SIZE(n), n, snb },
+
+static const flash_sector_t flash_geometry[] = {
+    FLASH_SECTORS(FLASH_SECTOR_DESC)
+};
+
+#define FLASH_SECTORS_NUM   (sizeof(flash_geometry) / sizeof(flash_geometry[0]))
+
+/* sector holding addr (binary search), NULL if not in flash */
+static const flash_sector_t *flash_sector_lookup(physaddr_t addr)
 {
-    switch (addr) {
-
-        case FLASH_SECTOR_0:
-        case FLASH_SECTOR_1:
-        case FLASH_SECTOR_2:
-        case FLASH_SECTOR_3:
-        case FLASH_SECTOR_4:
-        case FLASH_SECTOR_5:
-        case FLASH_SECTOR_6:
-        case FLASH_SECTOR_7:
-# if (CONFIG_USR_DRV_FLASH_1M && !CONFIG_USR_DRV_FLASH_DUAL_BANK) || CONFIG_USR_DRV_FLASH_2M
-    /* 1MB flash in dual banking doesn't have these 4 sectors */
-        case FLASH_SECTOR_8:
-        case FLASH_SECTOR_9:
-        case FLASH_SECTOR_10:
-        case FLASH_SECTOR_11:
-    /* 1MB flash in single banking finishes here */
-#endif
-# if (CONFIG_USR_DRV_FLASH_1M && CONFIG_USR_DRV_FLASH_DUAL_BANK) || CONFIG_USR_DRV_FLASH_2M
-        case FLASH_SECTOR_12:
-        case FLASH_SECTOR_13:
-        case FLASH_SECTOR_14:
-        case FLASH_SECTOR_15:
-        case FLASH_SECTOR_16:
-        case FLASH_SECTOR_17:
-        case FLASH_SECTOR_18:
-        case FLASH_SECTOR_19:
-    /* 1MB flash in dual banking finishes here */
-#endif
-# if CONFIG_USR_DRV_FLASH_2M
-        case FLASH_SECTOR_20:
-        case FLASH_SECTOR_21:
-        case FLASH_SECTOR_22:
-        case FLASH_SECTOR_23:
-    /* 2MB flash in dual banking finishes here */
-#endif
-            return true;
-        default:
-            return false;
+    uint32_t lo = 0, hi = FLASH_SECTORS_NUM;
+    uint32_t mid;
+
+    if (!IS_IN_FLASH(addr)) {
+        return NULL;
+    }
+    /* last sector whose base is lower or equal to addr */
+    while ((hi - lo) > 1) {
+        mid = (lo + hi) / 2;
+        if (flash_geometry[mid].base <= addr) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
     }
-	return false;
+    return &flash_geometry[lo];
+}
+
+static bool is_sector_start(physaddr_t addr)
+{
+    const flash_sector_t *sector = flash_sector_lookup(addr);
+
+    return (sector != NULL) && (sector->base == addr);
 }
 
 /**
  * \brief Select the sector to erase
  *
  * Sector address and size size depends on the configured flash device.
- * See flash_regs.h for more information about how these macros are defined.
+ * See flash.h for more information about how the sectors are defined.
  *
  * \param   addr Address pointing to sector
  *
@@ -292,96 +349,13 @@ static bool is_sector_start(physaddr_t addr)
  */
 uint8_t flash_select_sector(physaddr_t addr)
 {
-	uint8_t sector = 255;
-	/* First 8 sectors are the same in single/dual mem config */
-	if (addr <= FLASH_SECTOR_0_END) {
-		sector = 0;
-	}
-	else if (addr <= FLASH_SECTOR_1_END) {
-		sector = 1;
-	}
-	else if (addr <= FLASH_SECTOR_2_END) {
-		sector = 2;
-	}
-	else if (addr <= FLASH_SECTOR_3_END) {
-		sector = 3;
-	}
-	else if (addr <= FLASH_SECTOR_4_END) {
-		sector = 4;
-	}
-	else if (addr <= FLASH_SECTOR_5_END) {
-		sector = 5;
-	}
-	else if (addr <= FLASH_SECTOR_6_END) {
-		sector = 6;
-	}
-	else if (addr <= FLASH_SECTOR_7_END) {
-		sector = 7;
-	}
-# if (CONFIG_USR_DRV_FLASH_1M && !CONFIG_USR_DRV_FLASH_DUAL_BANK) || CONFIG_USR_DRV_FLASH_2M
-    /* 1MB flash in dual banking doesn't have these 4 sectors */
-	else if (addr <= FLASH_SECTOR_8_END) {
-		sector = 8;
-	}
-	else if (addr <= FLASH_SECTOR_9_END) {
-		sector = 9;
-	}
-	else if (addr <= FLASH_SECTOR_10_END) {
-		sector = 10;
-	}
-	else if (addr <= FLASH_SECTOR_11_END) {
-		sector = 11;
-	}
-    /* 1MB flash in single banking finishes here */
-#endif
-    /* from now on (sector starting with sector 12, are encoded starting with 0b10000 */
-# if (CONFIG_USR_DRV_FLASH_1M && CONFIG_USR_DRV_FLASH_DUAL_BANK) || CONFIG_USR_DRV_FLASH_2M
-	else if (addr <= FLASH_SECTOR_12_END) {
-		sector = 0x10;
-	}
-	else if (addr <= FLASH_SECTOR_13_END) {
-		sector = 0x11;
-	}
-	else if (addr <= FLASH_SECTOR_14_END) {
-		sector = 0x12;
-	}
-	else if (addr <= FLASH_SECTOR_15_END) {
-		sector = 0x13;
-	}
-	else if (addr <= FLASH_SECTOR_16_END) {
-		sector = 0x14;
-	}
-	else if (addr <= FLASH_SECTOR_17_END) {
-		sector = 0x15;
-	}
-	else if (addr <= FLASH_SECTOR_18_END) {
-		sector = 0x16;
-	}
-	else if (addr <= FLASH_SECTOR_19_END) {
-		sector = 0x17;
-	}
-    /* 1MB flash in dual banking finishes here */
-#endif
-# if CONFIG_USR_DRV_FLASH_2M
-	else if (addr <= FLASH_SECTOR_20_END) {
-		sector = 0x18;
-	}
-	else if (addr <= FLASH_SECTOR_21_END) {
-		sector = 0x19;
-	}
-	else if (addr <= FLASH_SECTOR_22_END) {
-		sector = 0x1a;
-	}
-	else if (addr <= FLASH_SECTOR_23_END) {
-		sector = 0x1b;
-	}
-    /* 2MB flash in dual banking finishes here */
-#endif
-	else {
-		log_printf("Error: %x Wrong address case, can't happen.\n", addr);
-		while(1){};
-	}
-	return sector;
+    const flash_sector_t *sector = flash_sector_lookup(addr);
+
+    if (sector == NULL) {
+        dbg_err("Error: %x Wrong address case, can't happen.\n", addr);
+        while(1){};
+    }
+    return sector->snb;
 }
 
 
@@ -399,33 +373,33 @@ static inline bool flash_has_programming_errors(void)
 #endif
     if (reg & err_mask) {
         if (reg & FLASH_SR_OPERR_Msk) {
-            log_printf("flash operation error: OPERR\n");
+            dbg_err("flash operation error: OPERR\n");
             set_reg(r_CORTEX_M_FLASH_SR, 1, FLASH_SR_OPERR);
             goto err;
         }
         if (reg & FLASH_SR_WRPERR_Msk) {
-            log_printf("flash write protection error: WRPERR\n");
+            dbg_err("flash write protection error: WRPERR\n");
             set_reg(r_CORTEX_M_FLASH_SR, 1, FLASH_SR_WRPERR);
             goto err;
         }
         if (reg & FLASH_SR_PGAERR_Msk) {
-            log_printf("flash write error: PGAERR\n");
+            dbg_err("flash write error: PGAERR\n");
             set_reg(r_CORTEX_M_FLASH_SR, 1, FLASH_SR_PGAERR);
             goto err;
         }
         if (reg & FLASH_SR_PGPERR_Msk) {
-            log_printf("flash write error: PGPERR\n");
+            dbg_err("flash write error: PGPERR\n");
             set_reg(r_CORTEX_M_FLASH_SR, 1, FLASH_SR_PGPERR);
             goto err;
         }
         if (reg & FLASH_SR_PGSERR_Msk) {
-            log_printf("flash write error: PGSERR\n");
+            dbg_err("flash write error: PGSERR\n");
             set_reg(r_CORTEX_M_FLASH_SR, 1, FLASH_SR_PGSERR);
             goto err;
         }
 #if defined(CONFIG_STM32F439) || defined(CONFIG_STM32F429)			/* RDERR (only on f42xxx/43xxx) */
         if (reg & FLASH_SR_RDERR_Msk) {
-            log_printf("flash write error: RDERR\n");
+            dbg_err("flash write error: RDERR\n");
             set_reg(r_CORTEX_M_FLASH_SR, 1, FLASH_SR_RDERR);
             goto err;
         }
@@ -436,6 +410,28 @@ err:
     return true;
 }
 
+#ifdef CONFIG_LOADER_FLASH_ASYNC
+/*
+ * Read and clear the error flags of the status register, without logging
+ * them: dbg_log() must not be called from the flash interrupt
+ */
+static inline uint32_t flash_clear_programming_errors(void)
+{
+    uint32_t reg;
+#if defined(CONFIG_STM32F439) || defined(CONFIG_STM32F429)      /*  Dual blank only on f42xxx/43xxx */
+    uint32_t err_mask = 0x1f2;
+#else
+    uint32_t err_mask = 0xf2;
+#endif
+    reg = read_reg_value(r_CORTEX_M_FLASH_SR) & err_mask;
+    if (reg) {
+        /* the error flags are cleared by writing 1 */
+        write_reg_value(r_CORTEX_M_FLASH_SR, reg);
+    }
+    return reg;
+}
+#endif
+
 
 
 
@@ -464,11 +460,12 @@ uint8_t flash_sector_erase(physaddr_t addr)
 
     /* check if flash is unlock, and unlock it if needed */
     if (flash_unlock() != 0) {
-        log_printf("unable to unlock flash!\n");
+        dbg_err("unable to unlock flash!\n");
     }
 
-	/* Set PSIZE to 0b10 (see STM-RM00090 chap. 3.6.2, PSIZE must be set) */
-	set_reg(r_CORTEX_M_FLASH_CR, 2, FLASH_CR_PSIZE);
+	/* Set PSIZE (see STM-RM00090 chap. 3.6.2, PSIZE must be set), allowed by
+	 * the supply voltage range */
+	set_reg(r_CORTEX_M_FLASH_CR, FLASH_PSIZE_MAX, FLASH_CR_PSIZE);
 
 	/* Set SER bit */
 	set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_SER);
@@ -493,7 +490,7 @@ uint8_t flash_sector_erase(physaddr_t addr)
     }
 	return sector;
 err:
-    log_printf("error while erasing sector at addr %x\n", addr);
+    dbg_err("error while erasing sector at addr %x\n", addr);
     return 0xff;
 }
 
@@ -501,25 +498,41 @@ err:
  * \brief Erase a whole bank
  *
  * @param bank Bank to erase (0 bank 1, 1 bank 2)
+ * @return Erased bank number, 0xff on error
  */
-void flash_bank_erase(uint8_t bank)
+uint8_t flash_bank_erase(uint8_t bank)
 {
-	/* Check that the BSY bit in the FLASH_SR reg is not set */
-	if(flash_is_busy()){
-		log_printf("Flash busy. Should not happen\n");
-		while(1){};
+#if !(defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)) /*  Dual blank only on f42xxx/43xxx */
+	if (bank) {
+		dbg_err("Can't acess bank 2 on a single bank memory!\n");
+		goto err;
 	}
+#endif
+
+	log_printf("Erasing flash bank %d\n", bank + 1);
+
+	/* Check that the BSY bit in the FLASH_SR reg is not set */
+	if(flash_is_busy()) {
+        flash_busy_wait();
+    }
+
+    /* check if flash is unlock, and unlock it if needed */
+    if (flash_unlock() != 0) {
+        dbg_err("unable to unlock flash!\n");
+        goto err;
+    }
+
+	/* Set PSIZE: the erase parallelism, allowed by the supply voltage range,
+	 * sets the erase time */
+	set_reg(r_CORTEX_M_FLASH_CR, FLASH_PSIZE_MAX, FLASH_CR_PSIZE);
 
 	/* Set MER or MER1 bit accordingly */
+#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
 	if (bank) {
-#if !(defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)) /*  Dual blank only on f42xxx/43xxx */
-		log_printf("Can't acess bank 2 on a single bank memory!\n");
-		while(1){};
-#else
 		set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_MER1);
-#endif
 	}
 	else
+#endif
 		set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_MER);
 
 	/* Set STRT bit in FLASH_CR reg */
@@ -528,15 +541,326 @@ void flash_bank_erase(uint8_t bank)
 	/* Wait for BSY bit to be cleared */
 	flash_busy_wait();
 
+	/* Unset MER and MER1 bits */
+	set_reg(r_CORTEX_M_FLASH_CR, 0, FLASH_CR_MER);
+#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+	set_reg(r_CORTEX_M_FLASH_CR, 0, FLASH_CR_MER1);
+#endif
+
     if (flash_has_programming_errors()) {
         goto err;
     }
-	return;
+	return bank;
 err:
-    log_printf("error while erasing bank\n");
-    return;
+    dbg_err("error while erasing bank %d\n", bank + 1);
+    return 0xff;
+}
+
+
+#ifdef CONFIG_LOADER_FLASH_ASYNC
+/*
+ * Asynchronous flash operations: the operations are queued, and the queue
+ * is consumed by the flash interrupt (EOP: end of operation, ERR: operation
+ * error). The operation at the queue tail is the running one.
+ * The queue is only modified with the flash interrupt masked in the NVIC.
+ */
+#define FLASH_ASYNC_QUEUE_LEN   4   /* power of 2 */
+#define FLASH_ASYNC_QUEUE_MASK  (FLASH_ASYNC_QUEUE_LEN - 1)
+
+static struct {
+    flash_op_t queue[FLASH_ASYNC_QUEUE_LEN];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t done;          /* programmed elements of the running operation */
+    volatile uint32_t failed;
+    /* last failed operation, logged by flash_async_wait() */
+    flash_op_type_t failed_type;
+    physaddr_t failed_addr;
+    uint32_t failed_errors;  /* status register error flags */
+} flash_async;
+
+static void flash_async_irq_mask(void)
+{
+    NVIC_DisableIRQ(FLASH_IRQ - 0x10);
+    full_memory_barrier();
+}
+
+static void flash_async_irq_unmask(void)
+{
+    NVIC_EnableIRQ(FLASH_IRQ - 0x10);
+}
+
+/* clear the operation bits of the control register */
+static void flash_async_clear_op(void)
+{
+    clear_reg_bits(r_CORTEX_M_FLASH_CR, FLASH_CR_PG_Msk | FLASH_CR_SER_Msk |
+                   FLASH_CR_MER_Msk | FLASH_CR_SNB_Msk
+#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+                   | FLASH_CR_MER1_Msk
+#endif
+                   );
+}
+
+/* number of (1 << FLASH_ASYNC_PSIZE) bytes elements of a program operation */
+static inline uint32_t flash_async_elements(const flash_op_t *op)
+{
+    return op->len << (2 - FLASH_ASYNC_PSIZE);
+}
+
+/* program the next element of the running program operation */
+static void flash_async_program_next(const flash_op_t *op)
+{
+    uint32_t offset = flash_async.done << FLASH_ASYNC_PSIZE;
+
+#if FLASH_ASYNC_PSIZE == 0
+    *(volatile uint8_t *)(op->addr + offset) = ((const uint8_t *)op->data)[offset];
+#elif FLASH_ASYNC_PSIZE == 1
+    *(volatile uint16_t *)(op->addr + offset) = ((const uint16_t *)op->data)[flash_async.done];
+#else
+    write_reg_value((uint32_t *)(op->addr + offset), op->data[flash_async.done]);
+#endif
 }
 
+/*
+ * start the operation: returns 0 when started (its end being notified by
+ * the flash interrupt), otherwise the status register error flags refusing
+ * it, or 0xffffffff when it can't be started at all
+ */
+static uint32_t flash_async_issue(const flash_op_t *op)
+{
+    uint32_t errors = 0xffffffff;
+
+    /* unlocked by flash_async_submit(), flash_unlock() logging its errors */
+    if (get_reg(r_CORTEX_M_FLASH_CR, FLASH_CR_LOCK) != 0) {
+        goto err;
+    }
+    /* no end of operation left by a refused one, then enable the
+     * interrupts, PSIZE being set according to the operation */
+    write_reg_value(r_CORTEX_M_FLASH_SR, FLASH_SR_EOP_Msk);
+    set_reg_bits(r_CORTEX_M_FLASH_CR, FLASH_CR_EOPIE_Msk | FLASH_CR_ERRIE_Msk);
+    switch (op->type) {
+        case FLASH_OP_SECTOR_ERASE:
+            set_reg(r_CORTEX_M_FLASH_CR, FLASH_PSIZE_MAX, FLASH_CR_PSIZE);
+            set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_SER);
+            set_reg(r_CORTEX_M_FLASH_CR, flash_select_sector(op->addr), FLASH_CR_SNB);
+            set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_STRT);
+            break;
+        case FLASH_OP_BANK_ERASE:
+            set_reg(r_CORTEX_M_FLASH_CR, FLASH_PSIZE_MAX, FLASH_CR_PSIZE);
+#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+            if (op->addr) {
+                set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_MER1);
+            } else
+#endif
+            set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_MER);
+            set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_STRT);
+            break;
+        case FLASH_OP_PROGRAM:
+            set_reg(r_CORTEX_M_FLASH_CR, FLASH_ASYNC_PSIZE, FLASH_CR_PSIZE);
+            set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_PG);
+            flash_async_program_next(op);
+            break;
+        default:
+            goto err;
+    }
+    /* sequence, alignment and write protection errors prevent the start */
+    errors = flash_clear_programming_errors();
+    if (errors != 0) {
+        goto err;
+    }
+    return 0;
+err:
+    flash_async_clear_op();
+    return errors;
+}
+
+/*
+ * record a failed operation (from interrupt context, without logging it)
+ * and notify it
+ */
+static void flash_async_fail(const flash_op_t *op, uint32_t errors)
+{
+    flash_async.failed++;
+    flash_async.failed_type = op->type;
+    flash_async.failed_addr = op->addr;
+    flash_async.failed_errors = errors;
+    if (op->cb != NULL) {
+        op->cb(op->addr, 1);
+    }
+}
+
+/* end of the running operation: notify it and start the next one */
+static void flash_async_complete(uint32_t errors)
+{
+    flash_op_t *op = &flash_async.queue[flash_async.tail & FLASH_ASYNC_QUEUE_MASK];
+
+    flash_async_clear_op();
+    if (errors != 0) {
+        flash_async_fail(op, errors);
+    } else if (op->cb != NULL) {
+        op->cb(op->addr, 0);
+    }
+    flash_async.tail++;
+    flash_async.done = 0;
+    while (flash_async.tail != flash_async.head) {
+        op = &flash_async.queue[flash_async.tail & FLASH_ASYNC_QUEUE_MASK];
+        errors = flash_async_issue(op);
+        if (errors == 0) {
+            return;
+        }
+        flash_async_fail(op, errors);
+        flash_async.tail++;
+    }
+    /* queue empty: the controller is idle */
+    clear_reg_bits(r_CORTEX_M_FLASH_CR, FLASH_CR_EOPIE_Msk | FLASH_CR_ERRIE_Msk);
+}
+
+/**
+ * \brief Flash interrupt handler (EOP and ERR)
+ */
+void flash_irq_handler(void)
+{
+    uint32_t errors = flash_clear_programming_errors();
+
+    /* clear EOP (write 1 only: the error flags are cleared above) */
+    write_reg_value(r_CORTEX_M_FLASH_SR, FLASH_SR_EOP_Msk);
+    if (flash_async.tail == flash_async.head) {
+        /* spurious */
+        return;
+    }
+    flash_op_t *op = &flash_async.queue[flash_async.tail & FLASH_ASYNC_QUEUE_MASK];
+    if ((op->type == FLASH_OP_PROGRAM) && (errors == 0) &&
+        (++flash_async.done < flash_async_elements(op))) {
+        /* next element, the PG bit is kept. A refused element (WRPERR,
+         * PGAERR, PGSERR) raises no interrupt: it fails the operation */
+        flash_async_program_next(op);
+        errors = flash_clear_programming_errors();
+        if (errors == 0) {
+            return;
+        }
+    }
+    flash_async_complete(errors);
+}
+
+/**
+ * \brief Queue an asynchronous flash operation
+ *
+ * The operation is started at once if the controller is idle. Its
+ * callback is called from the flash interrupt handler (or from this
+ * function, if the controller refuses to start it).
+ * The synchronous flash operations must not be used while asynchronous
+ * operations are pending.
+ *
+ * @param op Operation, copied in the queue
+ * @return 0 if queued, 1 if the queue is full, 2 if the operation is invalid
+ *         (including any address out of the flash memory)
+ */
+int flash_async_submit(const flash_op_t *op)
+{
+    int ret = 0;
+    uint32_t errors;
+
+    if (op == NULL) {
+        return 2;
+    }
+    switch (op->type) {
+        case FLASH_OP_SECTOR_ERASE:
+            if (!IS_IN_FLASH(op->addr)) {
+                goto invalid;
+            }
+            break;
+        case FLASH_OP_BANK_ERASE:
+#if defined(CONFIG_USR_DRV_FLASH_DUAL_BANK)
+            if (op->addr > 1) {
+#else
+            if (op->addr != 0) {
+#endif
+                goto invalid;
+            }
+            break;
+        case FLASH_OP_PROGRAM:
+            if ((op->data == NULL) || (op->len == 0) || (op->addr & 0x3)) {
+                goto invalid;
+            }
+            /* the whole destination is in flash (without wrapping around) */
+            if (!IS_IN_FLASH(op->addr) ||
+                (op->len > ((0xffffffff - op->addr) >> 2)) ||
+                !IS_IN_FLASH(op->addr + 4 * op->len - 1)) {
+                goto invalid;
+            }
+            break;
+        default:
+            goto invalid;
+    }
+    /* on failure, the operation is refused when issued */
+    flash_unlock();
+    flash_async_irq_mask();
+    if ((flash_async.head - flash_async.tail) == FLASH_ASYNC_QUEUE_LEN) {
+        ret = 1;
+        goto end;
+    }
+    flash_async.queue[flash_async.head & FLASH_ASYNC_QUEUE_MASK] = *op;
+    flash_async.head++;
+    if ((flash_async.head - flash_async.tail) == 1) {
+        /* the controller is idle */
+        flash_busy_wait();
+        flash_async.done = 0;
+        errors = flash_async_issue(op);
+        if (errors != 0) {
+            /* completes it, and clears the queue */
+            flash_async.head--;
+            clear_reg_bits(r_CORTEX_M_FLASH_CR, FLASH_CR_EOPIE_Msk | FLASH_CR_ERRIE_Msk);
+            flash_async_fail(op, errors);
+        }
+    }
+end:
+    flash_async_irq_unmask();
+    return ret;
+invalid:
+    dbg_err("invalid flash operation %d at %x\n", op->type, op->addr);
+    return 2;
+}
+
+/**
+ * \brief Number of queued asynchronous operations (running one included)
+ */
+uint32_t flash_async_pending(void)
+{
+    return flash_async.head - flash_async.tail;
+}
+
+/**
+ * \brief Wait for the end of all the queued asynchronous operations
+ *
+ * Must be called with the interrupts enabled. The failed operations are
+ * logged here, in thread context, the last one with its status register
+ * error flags (0xffffffff: not started).
+ *
+ * @return number of operations failed since the previous call
+ */
+uint32_t flash_async_wait(void)
+{
+    uint32_t failed;
+
+    while (flash_async_pending() != 0) {
+        disable_irq();
+        if (flash_async_pending() != 0) {
+            /* the interrupt wakes the core up even when masked */
+            wait_for_interrupt();
+        }
+        enable_irq();
+    }
+    failed = flash_async.failed;
+    flash_async.failed = 0;
+    if (failed != 0) {
+        dbg_err("%d flash operations failed, last: operation %d at %x (SR errors %x)\n",
+                failed, flash_async.failed_type, flash_async.failed_addr,
+                flash_async.failed_errors);
+    }
+    return failed;
+}
+#endif
+
 
 #ifdef CONFIG_LOADER_ERASE_WITH_RECOVERY
 /**
@@ -654,6 +978,11 @@ void flash_mass_erase(void)
         /*effective sector erase, with retry (max 3) */
         uint8_t retry = 3;
         do {
+#if defined(CONFIG_LOADER_ERASE_BANK2_MASS)
+            if (sectors_toerase[i] == FLASH_BANK2_START) {
+                ret = flash_bank_erase(1);
+            } else
+#endif
             ret = flash_sector_erase(sectors_toerase[i]);
             retry--;
         } while (ret == 0xff && retry > 0);
@@ -672,7 +1001,7 @@ void flash_mass_erase(void)
                         (check[1] != data[1]) ||
                         (check[2] != data[2]) ||
                         (check[3] != data[3])) {
-                    log_printf("corruption while setting flash OTP sector!!! FIA?\n");
+                    dbg_err("corruption while setting flash OTP sector!!! FIA?\n");
                     otp_done = secfalse;
                 }
             } while (otp_done == secfalse);
@@ -691,7 +1020,7 @@ void flash_mass_erase(void)
 #define flash_program(addr, elem, elem_cfg) do {\
 	/* Check that the BSY bit in the FLASH_SR reg is not set */\
 	if (flash_is_busy()) {\
-		log_printf("Flash busy. Should not happen\n");\
+		dbg_err("Flash busy. Should not happen\n");\
         flash_busy_wait();\
 	}\
 	/* Set PSIZE for 64 bits writing */\
@@ -725,7 +1054,7 @@ void flash_program_dword(uint64_t *addr, uint64_t value)
     }
     return;
 err:
-    log_printf("error while programming sector at addr %x\n", addr);
+    dbg_err("error while programming sector at addr %x\n", addr);
     return;
 }
 
@@ -751,7 +1080,7 @@ void flash_program_word(uint32_t *addr, uint32_t value)
     }
     return;
 err:
-    log_printf("error while programming sector at addr %x\n", addr);
+    dbg_err("error while programming sector at addr %x\n", addr);
     return;
 
 }
@@ -777,7 +1106,7 @@ void flash_program_hword(uint16_t *addr, uint16_t value)
     }
     return;
 err:
-    log_printf("error while programming sector at addr %x\n", addr);
+    dbg_err("error while programming sector at addr %x\n", addr);
     return;
 }
 
@@ -802,11 +1131,109 @@ void flash_program_byte(uint8_t *addr, uint8_t value)
     }
     return;
 err:
-    log_printf("error while programming sector at addr %x\n", addr);
+    dbg_err("error while programming sector at addr %x\n", addr);
     return;
 }
 
 
+/*
+ * program count elements of (1 << psize) bytes, the PG bit being set. The
+ * source may be unaligned.
+ */
+static void flash_program_run(physaddr_t *dst, const uint8_t **src,
+                              uint32_t count, uint8_t psize)
+{
+    uint32_t i;
+
+    if (count == 0) {
+        return;
+    }
+    set_reg(r_CORTEX_M_FLASH_CR, psize, FLASH_CR_PSIZE);
+    for (i = 0; i < count; i++) {
+        switch (psize) {
+            case 0:
+                *(volatile uint8_t *)*dst = **src;
+                break;
+            case 1: {
+                uint16_t hword;
+                memcpy(&hword, *src, sizeof(hword));
+                *(volatile uint16_t *)*dst = hword;
+                break;
+            }
+            case 2: {
+                uint32_t word;
+                memcpy(&word, *src, sizeof(word));
+                write_reg_value((uint32_t *)*dst, word);
+                break;
+            }
+            default: {
+                uint64_t dword;
+                memcpy(&dword, *src, sizeof(dword));
+                *(volatile uint64_t *)*dst = dword;
+                break;
+            }
+        }
+        *dst += (1 << psize);
+        *src += (1 << psize);
+        flash_busy_wait();
+    }
+}
+
+/**
+ * \brief Program a buffer in flash
+ *
+ * The buffer is programmed with the widest parallelism allowed by the
+ * supply voltage range, the unaligned head and tail being programmed with
+ * narrower ones. The programming errors are checked once, at the end.
+ * Unlike the flash_program_*() functions, the sectors are not erased: the
+ * destination must have been erased by the caller.
+ *
+ * @param dst Destination address
+ * @param src Source buffer
+ * @param len Length, in bytes
+ * @return 0 on success, 1 on invalid parameters, 2 on programming error
+ */
+int flash_program_buffer(physaddr_t dst, const uint8_t *src, uint32_t len)
+{
+    physaddr_t end;
+    int psize;
+    int ret = 0;
+
+    if (len == 0) {
+        return 0;
+    }
+    /* the whole destination is in flash (without wrapping around) */
+    if ((src == NULL) || !IS_IN_FLASH(dst) || (len > (0xffffffff - dst)) ||
+        !IS_IN_FLASH(dst + len - 1)) {
+        dbg_err("programming not authorized (not in flash memory)\n");
+        return 1;
+    }
+    end = dst + len;
+    flash_busy_wait();
+    if (flash_unlock()) {
+        return 2;
+    }
+    set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_PG);
+    /* head: up to the widest parallelism alignment */
+    for (psize = 0; psize < FLASH_PSIZE_MAX; psize++) {
+        if ((dst & (1 << psize)) && ((end - dst) >= (1U << psize))) {
+            flash_program_run(&dst, &src, 1, psize);
+        }
+    }
+    /* body */
+    flash_program_run(&dst, &src, (end - dst) >> FLASH_PSIZE_MAX, FLASH_PSIZE_MAX);
+    /* tail */
+    for (psize = FLASH_PSIZE_MAX; psize-- > 0; ) {
+        flash_program_run(&dst, &src, (end - dst) >> psize, psize);
+    }
+    if (flash_has_programming_errors()) {
+        dbg_err("error while programming buffer at addr %x\n", end - len);
+        ret = 2;
+    }
+    set_reg(r_CORTEX_M_FLASH_CR, 0, FLASH_CR_PG);
+    return ret;
+}
+
 /**
  * \brief Read from flash memory
  *
@@ -817,7 +1244,7 @@ err:
 void flash_read(uint8_t *buffer, physaddr_t addr, uint32_t size)
 {
 	if (!IS_IN_FLASH(addr)) {
-		log_printf("Read not authorized (not in flash memory)\n");
+		dbg_err("Read not authorized (not in flash memory)\n");
 		while(1){};
 	}
 	/* Copy data into buffer */
@@ -865,122 +1292,78 @@ void flash_set_bank_conf(uint8_t conf __attribute__((unused)))
 /**
  * \brief Return sector size in bytes
  *
- * FIXME
- *
- * @return Sector size
+ * @param sector Sector number (0 to 23)
+ * @return Sector size, 0 if the sector doesn't exist
  */
 uint32_t flash_sector_size(uint8_t sector)
 {
-	switch(sector){
-		case 0:
-			return FLASH_SECTOR_SIZE(0);
-		case 1:
-			return FLASH_SECTOR_SIZE(1);
-		case 2:
-			return FLASH_SECTOR_SIZE(2);
-		case 3:
-			return FLASH_SECTOR_SIZE(3);
-		case 4:
-			return FLASH_SECTOR_SIZE(4);
-		case 5:
-			return FLASH_SECTOR_SIZE(5);
-		case 6:
-			return FLASH_SECTOR_SIZE(6);
-		case 7:
-			return FLASH_SECTOR_SIZE(7);
-# if (CONFIG_USR_DRV_FLASH_1M && !CONFIG_USR_DRV_FLASH_DUAL_BANK) || CONFIG_USR_DRV_FLASH_2M
-    /* 1MB flash in dual banking doesn't have these 4 sectors */
-		case 8:
-			return FLASH_SECTOR_SIZE(8);
-		case 9:
-			return FLASH_SECTOR_SIZE(9);
-		case 10:
-			return FLASH_SECTOR_SIZE(10);
-		case 11:
-			return FLASH_SECTOR_SIZE(11);
-#endif
-#if (CONFIG_USR_DRV_FLASH_1M && CONFIG_USR_DRV_FLASH_DUAL_BANK) || CONFIG_USR_DRV_FLASH_2M
-		case 12:
-			return FLASH_SECTOR_SIZE(12);
-		case 13:
-			return FLASH_SECTOR_SIZE(13);
-		case 14:
-			return FLASH_SECTOR_SIZE(14);
-		case 15:
-			return FLASH_SECTOR_SIZE(15);
-		case 16:
-			return FLASH_SECTOR_SIZE(16);
-		case 17:
-			return FLASH_SECTOR_SIZE(17);
-		case 18:
-			return FLASH_SECTOR_SIZE(18);
-		case 19:
-			return FLASH_SECTOR_SIZE(19);
-    /* 1MB flash in dual banking finishes here */
-#endif
-# if CONFIG_USR_DRV_FLASH_2M
-		case 20:
-			return FLASH_SECTOR_SIZE(20);
-		case 21:
-			return FLASH_SECTOR_SIZE(21);
-		case 22:
-			return FLASH_SECTOR_SIZE(22);
-		case 23:
-			return FLASH_SECTOR_SIZE(23);
-    /*2MB flash in dual banking finishes here */
-#endif
-		default:
-			log_printf("[Flash] Error: bad sector %d\n", sector);
-			return 0;
-	}
+    uint32_t i;
+
+    /* the bank 2 sectors numbering starts with 12 */
+    i = (sector >= 12) ? (FLASH_BANK1_SECTORS + sector - 12) : sector;
+    if ((i >= FLASH_SECTORS_NUM) || (flash_geometry[i].num != sector)) {
+        dbg_err("[Flash] Error: bad sector %d\n", sector);
+        return 0;
+    }
+    return flash_geometry[i].size;
 }
 
+/* copy block: programmed, then verified, at once */
+#define FLASH_COPY_BLOCK_SIZE   1024
 
-/* [RB] FIXME: do we really need such a complex function here?? */
 /**
  * \brief Copy one flash sector into another
  *
- * FIXME Verify size of both sectors accessed !
+ * Both addresses must be sectors start, of sectors of the same size. The
+ * destination sector is erased, then programmed and verified block by
+ * block.
  *
- * @param dest Destination address
- * @param src Sourcr address
+ * @param dest Destination sector address
+ * @param src Source sector address
+ * @param progress Progress callback (may be NULL), called after each block
+ * @return 0 on success, 1 on invalid sectors, 2 on erase error,
+ *         3 on programming error, 4 on verification error
  */
-void flash_copy_sector(physaddr_t dest, physaddr_t src)
+int flash_copy_sector(physaddr_t dest, physaddr_t src,
+                      flash_progress_cb_t progress)
 {
-	/* Set up variables */
-	uint8_t sector = 20;
-	uint8_t buffer[64];
-	uint32_t i = 0, j = 0, k = 0, sector_size = 0;
-	if ((!IS_IN_FLASH(dest)) || (!IS_IN_FLASH(src))) {
-		log_printf("Read not authorized (not in flash memory)\n");
-		while(1){};
-	}
-	memset(buffer, 0, 64);
-	/* Erase sector */
-	sector = flash_sector_erase((physaddr_t)dest);
-	/* Get sector size */
-	sector_size = flash_sector_size(sector);
-	/* Perform copy */
-	for (i = 0; i < sector_size; i++) { /* Go through each kB of the sector */
-		log_printf("#%d ", i);
-		for (j = 0; j < 16; j++) { /* Go through each 64B packet of each kB */
-			/* Read packet to copy */
-			flash_read(buffer, (src+(i<<8)+(j<<4)), 64); /* !!  sigh 32 bit addr, >>2  */
-			log_printf("Buffer #%d:\n", j+i*2);
-			for (k = 0; k < 64; k++)
-				log_printf("%x ", buffer[k]);
-			log_printf("\n");
-			/* Write packet by 1B */
-			for (k = 0; k < 64; k++)
-				flash_program_byte((uint8_t *)(dest)+(i<<10)+(j<<6)+k, buffer[k]);
-			flash_read(buffer,(dest+(i<<8)+(j<<4)), 64);
-			log_printf("Dest:\n");
-			for (k = 0; k < 64; k++)
-				log_printf("%x ", buffer[k]);
-			log_printf("\n");
-		} /* j loop */
-	} /* i loop */
-	log_printf("End of copy\n");
+    const flash_sector_t *src_sector = flash_sector_lookup(src);
+    const flash_sector_t *dest_sector = flash_sector_lookup(dest);
+    const uint32_t *s, *d;
+    uint32_t sector_size;
+    uint32_t off, i;
+
+    if ((src_sector == NULL) || (dest_sector == NULL) || (dest == src) ||
+        (src_sector->base != src) || (dest_sector->base != dest)) {
+        dbg_err("copy not authorized (not flash sectors)\n");
+        return 1;
+    }
+    sector_size = src_sector->size;
+    if (dest_sector->size != sector_size) {
+        dbg_err("copy not authorized (sectors sizes differ)\n");
+        return 1;
+    }
+    if (flash_sector_erase(dest) == 0xff) {
+        return 2;
+    }
+    for (off = 0; off < sector_size; off += FLASH_COPY_BLOCK_SIZE) {
+        if (flash_program_buffer(dest + off, (const uint8_t *)(src + off),
+                                 FLASH_COPY_BLOCK_SIZE) != 0) {
+            return 3;
+        }
+        s = (const uint32_t *)(src + off);
+        d = (const uint32_t *)(dest + off);
+        for (i = 0; i < (FLASH_COPY_BLOCK_SIZE / sizeof(uint32_t)); i++) {
+            if (d[i] != s[i]) {
+                dbg_err("copy verification failed at %x\n", (uint32_t)&d[i]);
+                return 4;
+            }
+        }
+        if (progress != NULL) {
+            progress(off + FLASH_COPY_BLOCK_SIZE, sector_size);
+        }
+    }
+    return 0;
 }
 
 void flash_writelock_bank1(void)
@@ -989,7 +1372,7 @@ void flash_writelock_bank1(void)
 # if CONFIG_USR_DRV_FLASH_2M
     set_reg(r_CORTEX_M_FLASH_OPTCR, 0x000, FLASH_OPTCR_nWRP);
 # else
-    log_printf("not yet implemented");
+    dbg_warn("not yet implemented");
 # endif
 #endif
 }
@@ -1009,7 +1392,7 @@ void flash_writeunlock_bank1(void)
 # if CONFIG_USR_DRV_FLASH_2M
     set_reg(r_CORTEX_M_FLASH_OPTCR, 0xFFF, FLASH_OPTCR_nWRP);
 # else
-    log_printf("not yet implemented");
+    dbg_warn("not yet implemented");
 # endif
 #endif
 }
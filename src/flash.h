@@ -91,6 +91,17 @@
 #define FLASH_SECTOR_19			((uint32_t) 0x080E0000) /* 128 kB */
 #define FLASH_SECTOR_19_END		((uint32_t) 0x080FFFFF)
 
+#define FLASH_BANK2_START		FLASH_SECTOR_12
+#define FLASH_BANK2_END			FLASH_SECTOR_19_END
+
+/* sectors list, X(sector number, SNB encoding) */
+#define FLASH_SECTORS(X) \
+    X(0, 0x00)  X(1, 0x01)  X(2, 0x02)  X(3, 0x03) \
+    X(4, 0x04)  X(5, 0x05)  X(6, 0x06)  X(7, 0x07) \
+    X(12, 0x10) X(13, 0x11) X(14, 0x12) X(15, 0x13) \
+    X(16, 0x14) X(17, 0x15) X(18, 0x16) X(19, 0x17)
+#define FLASH_BANK1_SECTORS		8
+
 #  else /* signe bank, continuing with 128kB sectors */
 
 #define FLASH_SECTOR_8			((uint32_t) 0x08080000) /* 128 kB */
@@ -102,6 +113,13 @@
 #define FLASH_SECTOR_11			((uint32_t) 0x080E0000) /* 128 kB */
 #define FLASH_SECTOR_11_END		((uint32_t) 0x080FFFFF)
 
+/* sectors list, X(sector number, SNB encoding) */
+#define FLASH_SECTORS(X) \
+    X(0, 0x00)  X(1, 0x01)  X(2, 0x02)  X(3, 0x03) \
+    X(4, 0x04)  X(5, 0x05)  X(6, 0x06)  X(7, 0x07) \
+    X(8, 0x08)  X(9, 0x09)  X(10, 0x0a) X(11, 0x0b)
+#define FLASH_BANK1_SECTORS		12
+
 #  endif /*!banking */
 
 # else /* USR_DRV_FLASH_2M */
@@ -163,6 +181,19 @@
 #define FLASH_SECTOR_23			((uint32_t) 0x081E0000) /* 128 kB */
 #define FLASH_SECTOR_23_END		((uint32_t) 0x081FFFFF)
 
+#define FLASH_BANK2_START		FLASH_SECTOR_12
+#define FLASH_BANK2_END			FLASH_SECTOR_23_END
+
+/* sectors list, X(sector number, SNB encoding) */
+#define FLASH_SECTORS(X) \
+    X(0, 0x00)  X(1, 0x01)  X(2, 0x02)  X(3, 0x03) \
+    X(4, 0x04)  X(5, 0x05)  X(6, 0x06)  X(7, 0x07) \
+    X(8, 0x08)  X(9, 0x09)  X(10, 0x0a) X(11, 0x0b) \
+    X(12, 0x10) X(13, 0x11) X(14, 0x12) X(15, 0x13) \
+    X(16, 0x14) X(17, 0x15) X(18, 0x16) X(19, 0x17) \
+    X(20, 0x18) X(21, 0x19) X(22, 0x1a) X(23, 0x1b)
+#define FLASH_BANK1_SECTORS		12
+
 # endif
 
 /*
@@ -248,10 +279,40 @@ uint8_t flash_select_sector(physaddr_t addr);
 
 uint8_t flash_sector_erase(physaddr_t addr);
 
+uint8_t flash_bank_erase(uint8_t bank);
+
 #ifdef CONFIG_LOADER_ERASE_WITH_RECOVERY
 secbool flash_mass_erase_ongoing(void);
 #endif
 
+#ifdef CONFIG_LOADER_FLASH_ASYNC
+/******* Asynchronous flash operations **********/
+typedef enum {
+    FLASH_OP_SECTOR_ERASE = 0,  /* sector holding addr */
+    FLASH_OP_BANK_ERASE,        /* bank addr (0 or 1) */
+    FLASH_OP_PROGRAM,           /* len words of data at addr */
+} flash_op_type_t;
+
+/* completion callback, called in interrupt context (status 0: success) */
+typedef void (*flash_op_cb_t)(physaddr_t addr, int status);
+
+typedef struct {
+    flash_op_type_t  type;
+    physaddr_t       addr;
+    const uint32_t  *data;
+    uint32_t         len;
+    flash_op_cb_t    cb;
+} flash_op_t;
+
+int flash_async_submit(const flash_op_t *op);
+
+uint32_t flash_async_pending(void);
+
+uint32_t flash_async_wait(void);
+
+void flash_irq_handler(void);
+#endif
+
 void flash_mass_erase(void);
 
 void flash_program_dword(uint64_t *addr, uint64_t value);
@@ -260,6 +321,8 @@ void flash_program_word(uint32_t *addr, uint32_t word);
 
 void flash_program_byte(uint8_t *addr, uint8_t value);
 
+int flash_program_buffer(physaddr_t dst, const uint8_t *src, uint32_t len);
+
 void flash_read(uint8_t *buffer, physaddr_t addr, uint32_t size);
 
 #if defined(USR_DRV_FLASH_DUAL_BANK)	/*  Only on f42xxx/43xxx */
@@ -268,7 +331,11 @@ uint8_t flash_get_bank_conf(void);
 void flash_set_bank_conf(uint8_t conf);
 #endif
 
-void flash_copy_sector(physaddr_t dest, physaddr_t src);
+/* copy progress callback: done bytes on total bytes */
+typedef void (*flash_progress_cb_t)(uint32_t done, uint32_t total);
+
+int flash_copy_sector(physaddr_t dest, physaddr_t src,
+                      flash_progress_cb_t progress);
 
 uint32_t flash_sector_size(uint8_t sector);
 
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "autoconf.h"
+#include "halfsiphash.h"
+
+#define HALFSIPHASH_CROUNDS 2
+#define HALFSIPHASH_DROUNDS 4
+
+#define ROTL32(x, b) (uint32_t)(((x) << (b)) | ((x) >> (32 - (b))))
+
+typedef struct {
+    uint32_t v0;
+    uint32_t v1;
+    uint32_t v2;
+    uint32_t v3;
+} halfsiphash_state_t;
+
+static void halfsiphash_rounds(halfsiphash_state_t *s, uint8_t rounds)
+{
+    while (rounds > 0) {
+        s->v0 += s->v1;
+        s->v1 = ROTL32(s->v1, 5);
+        s->v1 ^= s->v0;
+        s->v0 = ROTL32(s->v0, 16);
+        s->v2 += s->v3;
+        s->v3 = ROTL32(s->v3, 8);
+        s->v3 ^= s->v2;
+        s->v0 += s->v3;
+        s->v3 = ROTL32(s->v3, 7);
+        s->v3 ^= s->v0;
+        s->v2 += s->v1;
+        s->v1 = ROTL32(s->v1, 13);
+        s->v1 ^= s->v2;
+        s->v2 = ROTL32(s->v2, 16);
+        rounds--;
+    }
+}
+
+uint64_t halfsiphash_2_4_64(const uint32_t key[HALFSIPHASH_KEY_WORDS],
+                            const uint8_t *in, uint32_t inlen)
+{
+    halfsiphash_state_t s;
+    uint32_t m;
+    uint32_t b = inlen << 24;
+    uint32_t out0;
+    uint32_t left = inlen & 0x3;
+    const uint8_t *end = in + (inlen - left);
+
+    s.v0 = key[0];
+    s.v1 = key[1] ^ 0xee; /* 64 bits output */
+    s.v2 = key[0] ^ 0x6c796765;
+    s.v3 = key[1] ^ 0x74656462;
+
+    /* compression of the complete (little endian) words */
+    for (; in != end; in += 4) {
+        m = (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+            ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+        s.v3 ^= m;
+        halfsiphash_rounds(&s, HALFSIPHASH_CROUNDS);
+        s.v0 ^= m;
+    }
+    /* last word: remaining bytes and input length */
+    switch (left) {
+        case 3:
+            b |= (uint32_t)in[2] << 16;
+            /* fallthrough */
+        case 2:
+            b |= (uint32_t)in[1] << 8;
+            /* fallthrough */
+        case 1:
+            b |= (uint32_t)in[0];
+            break;
+        default:
+            break;
+    }
+    s.v3 ^= b;
+    halfsiphash_rounds(&s, HALFSIPHASH_CROUNDS);
+    s.v0 ^= b;
+
+    /* finalization */
+    s.v2 ^= 0xee;
+    halfsiphash_rounds(&s, HALFSIPHASH_DROUNDS);
+    out0 = s.v1 ^ s.v3;
+    s.v1 ^= 0xdd;
+    halfsiphash_rounds(&s, HALFSIPHASH_DROUNDS);
+
+    return ((uint64_t)(s.v1 ^ s.v3) << 32) | out0;
+}
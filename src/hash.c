@@ -35,7 +35,13 @@
 #include "regutils.h"
 #include "debug.h"
 #include "main.h"
+#include "loader_sha256.h"
 
+/*
+ * INFO: control flow values are always hashed using the software SHA-256
+ * implementation, as the HASH processor may be in use for the firmware
+ * check.
+ */
 uint64_t hash_state(uint64_t val)
 {
     sha256_context sha256_ctx;
@@ -76,39 +82,271 @@ uint64_t hash_state(uint64_t val)
 #endif
 #endif
 
-secbool check_fw_hash(const t_firmware_state *fw, uint32_t partition_base_addr, uint32_t partition_size)
+# if defined(CONFIG_LOADER_FW_HASH_FW_LEN) || defined(CONFIG_LOADER_FW_HASH_CHUNKED)
+/*
+ * Check that the given flash area is erased (i.e. full of 0xff). This is
+ * done word by word (only the unaligned head and tail are checked byte per
+ * byte), which is a lot cheaper than hashing the same area.
+ */
+static secbool check_erased_area(uint32_t addr, uint32_t size)
 {
-    sha256_context sha256_ctx;
-    uint8_t digest[SHA256_DIGEST_SIZE];
-    uint32_t tmp;
+    const uint8_t *byte = (const uint8_t*)addr;
+    const uint32_t *word;
+    uint32_t end = addr + size;
 
-    /* Double sanity check (for faults) */
-    if(fw->fw_sig.len > partition_size){
+    /* Overflow sanity check */
+    if (end < addr) {
         goto err;
     }
-    if(fw->fw_sig.len > partition_size){
+    /* unaligned head */
+    while ((((physaddr_t)byte & 0x3) != 0) && ((physaddr_t)byte < end)) {
+        if (*byte != 0xff) {
+            goto err;
+        }
+        byte++;
+    }
+    /* word-aligned body */
+    word = (const uint32_t*)byte;
+    while (((physaddr_t)word + sizeof(uint32_t)) <= end) {
+        if (*word != ERASE_VALUE) {
+            goto err;
+        }
+        word++;
+    }
+    /* unaligned tail */
+    byte = (const uint8_t*)word;
+    while ((physaddr_t)byte < end) {
+        if (*byte != 0xff) {
+            goto err;
+        }
+        byte++;
+    }
+    /* Double check (for faults) that the whole area has been walked */
+    if ((physaddr_t)byte != end) {
+        goto err;
+    }
+    if ((physaddr_t)byte != end) {
         goto err;
     }
 
-    sha256_init(&sha256_ctx);
-    /* Begin to hash the header */
+    return sectrue;
+
+err:
+    return secfalse;
+}
+# endif
+
+/*
+ * Hash the firmware header fields, in big endian
+ */
+static void hash_fw_header(loader_sha256_context *sha256_ctx, const t_firmware_state *fw)
+{
+    uint32_t tmp;
+
     tmp = to_big32(fw->fw_sig.magic);
-    sha256_update(&sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
+    loader_sha256_update(sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
     tmp = to_big32(fw->fw_sig.type);
-    sha256_update(&sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
+    loader_sha256_update(sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
     tmp = to_big32(fw->fw_sig.version);
-    sha256_update(&sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
+    loader_sha256_update(sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
     tmp = to_big32(fw->fw_sig.len);
-    sha256_update(&sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
+    loader_sha256_update(sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
     tmp = to_big32(fw->fw_sig.siglen);
-    sha256_update(&sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
+    loader_sha256_update(sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
     tmp = to_big32(fw->fw_sig.chunksize);
-    sha256_update(&sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
+    loader_sha256_update(sha256_ctx, (uint8_t*)&tmp, sizeof(tmp));
+}
+
+# ifdef CONFIG_LOADER_FW_HASH_CHUNKED
+
+uint32_t fw_chunk_count(const t_firmware_state *fw)
+{
+    uint32_t len = fw->fw_sig.len;
+    uint32_t chunksize = fw->fw_sig.chunksize;
+
+    if (chunksize == 0) {
+        return 0;
+    }
+    return (len / chunksize) + (((len % chunksize) != 0) ? 1 : 0);
+}
+
+secbool check_fw_chunk_table(const t_firmware_state *fw, uint32_t partition_size)
+{
+    loader_sha256_context sha256_ctx;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint32_t nchunks;
+
+    /* Double sanity checks (for faults) */
+    if(fw->fw_sig.len > partition_size){
+        goto err;
+    }
+    if(fw->fw_sig.len > partition_size){
+        goto err;
+    }
+    if(fw->fw_sig.chunksize == 0){
+        goto err;
+    }
+    if(fw->fw_sig.chunksize == 0){
+        goto err;
+    }
+    nchunks = fw_chunk_count(fw);
+    if(nchunks > FW_CHUNK_TABLE_MAX_ENTRIES){
+        goto err;
+    }
+    if(nchunks > FW_CHUNK_TABLE_MAX_ENTRIES){
+        goto err;
+    }
+
+    loader_sha256_init(&sha256_ctx);
+    hash_fw_header(&sha256_ctx, fw);
+    /* Then hash the chunk digest table */
+    loader_sha256_update(&sha256_ctx, fw->fill, nchunks * SHA256_DIGEST_SIZE);
+    if(loader_sha256_final(&sha256_ctx, digest)){
+        goto err;
+    }
 
+    /* Multiple checks for faults */
+    if(!are_equal(digest, fw->fw_sig.hash, SHA256_DIGEST_SIZE)){
+        goto err;
+    }
+    if(!are_equal(fw->fw_sig.hash, digest, SHA256_DIGEST_SIZE)){
+        goto err;
+    }
+    if(!are_equal(digest, fw->fw_sig.hash, SHA256_DIGEST_SIZE)){
+        goto err;
+    }
+
+    return sectrue;
+
+err:
+    return secfalse;
+}
+
+secbool check_fw_chunk(const t_firmware_state *fw, uint32_t partition_base_addr, uint32_t chunk)
+{
+    loader_sha256_context sha256_ctx;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint32_t offset;
+    uint32_t chunk_len;
+    const uint8_t *chunk_digest;
+
+    /* Double sanity check (for faults) */
+    if(chunk >= fw_chunk_count(fw)){
+        goto err;
+    }
+    if(chunk >= fw_chunk_count(fw)){
+        goto err;
+    }
+
+    offset = chunk * fw->fw_sig.chunksize;
+    chunk_len = fw->fw_sig.len - offset;
+    if(chunk_len > fw->fw_sig.chunksize){
+        chunk_len = fw->fw_sig.chunksize;
+    }
+    chunk_digest = &fw->fill[chunk * SHA256_DIGEST_SIZE];
+
+    loader_sha256_init(&sha256_ctx);
+    loader_sha256_update(&sha256_ctx, (uint8_t*)(partition_base_addr + offset), chunk_len);
+    if(loader_sha256_final(&sha256_ctx, digest)){
+        goto err;
+    }
+
+    /* Multiple checks for faults */
+    if(!are_equal(digest, chunk_digest, SHA256_DIGEST_SIZE)){
+        goto err;
+    }
+    if(!are_equal(chunk_digest, digest, SHA256_DIGEST_SIZE)){
+        goto err;
+    }
+    if(!are_equal(digest, chunk_digest, SHA256_DIGEST_SIZE)){
+        goto err;
+    }
+
+    return sectrue;
+
+err:
+    return secfalse;
+}
+
+secbool check_fw_hash(const t_firmware_state *fw, uint32_t partition_base_addr, uint32_t partition_size)
+{
+    uint32_t nchunks;
+    uint32_t i;
+    secbool erased = secfalse;
+
+    /* The table is checked first, each chunk digest can then be trusted */
+    if(check_fw_chunk_table(fw, partition_size) != sectrue){
+        goto err;
+    }
+    nchunks = fw_chunk_count(fw);
+    /* stop at the first corrupted chunk */
+    for(i = 0; i < nchunks; i++){
+        if(check_fw_chunk(fw, partition_base_addr, i) != sectrue){
+            goto err;
+        }
+    }
+    /* Double check (for faults) that all the chunks have been checked */
+    if(i != nchunks){
+        goto err;
+    }
+    if(i != nchunks){
+        goto err;
+    }
+    /* the remaining of the partition must be erased */
+    erased = check_erased_area(partition_base_addr + fw->fw_sig.len, partition_size - fw->fw_sig.len);
+    if(erased != sectrue){
+        goto err;
+    }
+    if(erased != sectrue){
+        goto err;
+    }
+
+    return sectrue;
+
+err:
+    return secfalse;
+}
+
+# else
+
+secbool check_fw_hash(const t_firmware_state *fw, uint32_t partition_base_addr, uint32_t partition_size)
+{
+    loader_sha256_context sha256_ctx;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+#  ifdef CONFIG_LOADER_FW_HASH_FW_LEN
+    /* local copy: the hashed and the blank checked areas must match */
+    uint32_t fw_len = fw->fw_sig.len;
+    secbool erased = secfalse;
+#  endif
+
+    /* Double sanity check (for faults) */
+    if(fw->fw_sig.len > partition_size){
+        goto err;
+    }
+    if(fw->fw_sig.len > partition_size){
+        goto err;
+    }
+
+    loader_sha256_init(&sha256_ctx);
+    /* Begin to hash the header */
+    hash_fw_header(&sha256_ctx, fw);
+
+#  ifdef CONFIG_LOADER_FW_HASH_FW_LEN
+    if(fw_len > partition_size){
+        goto err;
+    }
+    /* Then hash the firmware content only ... */
+    loader_sha256_update(&sha256_ctx, (uint8_t*)partition_base_addr, fw_len);
+    /* ... the remaining of the partition must be erased */
+    erased = check_erased_area(partition_base_addr + fw_len, partition_size - fw_len);
+#  else
     /* Then hash the flash content */
-    sha256_update(&sha256_ctx, (uint8_t*)partition_base_addr, partition_size);
+    loader_sha256_update(&sha256_ctx, (uint8_t*)partition_base_addr, partition_size);
+#  endif
 
-    sha256_final(&sha256_ctx, digest);
+    if(loader_sha256_final(&sha256_ctx, digest)){
+        goto err;
+    }
 
     /* Multiple checks for faults */
     if(!are_equal(digest, fw->fw_sig.hash, SHA256_DIGEST_SIZE)){
@@ -120,12 +358,23 @@ secbool check_fw_hash(const t_firmware_state *fw, uint32_t partition_base_addr,
     if(!are_equal(digest, fw->fw_sig.hash, SHA256_DIGEST_SIZE)){
         goto err;
     }
+#  ifdef CONFIG_LOADER_FW_HASH_FW_LEN
+    if(erased != sectrue){
+        goto err;
+    }
+    if(erased != sectrue){
+        goto err;
+    }
+#  endif
 
     return sectrue;
 
 err:
     return secfalse;
 }
+
+# endif
+
 #ifdef __GNUC__
 #ifdef __clang__
 # pragma clang optimize on
@@ -43,6 +43,20 @@ uint64_t hash_state(uint64_t val);
 # ifdef CONFIG_LOADER_FW_HASH_CHECK
 secbool check_fw_hash(const t_firmware_state *fw, uint32_t partition_base_addr, uint32_t partition_size);
 
+#  ifdef CONFIG_LOADER_FW_HASH_CHUNKED
+/* number of fw_sig.chunksize long chunks of the firmware */
+uint32_t fw_chunk_count(const t_firmware_state *fw);
+
+/* check the chunk digest table against the header hash */
+secbool check_fw_chunk_table(const t_firmware_state *fw, uint32_t partition_size);
+
+/*
+ * check a single firmware chunk against its digest. The chunk digest table
+ * must have been checked before using check_fw_chunk_table()
+ */
+secbool check_fw_chunk(const t_firmware_state *fw, uint32_t partition_base_addr, uint32_t chunk);
+#  endif
+
 # endif
 
 #endif
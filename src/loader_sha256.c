@@ -0,0 +1,135 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "loader_sha256.h"
+#if defined(CONFIG_LOADER_SHA256_HW) || defined(CONFIG_LOADER_SHA256_HW_MODEL)
+#include "soc-hash.h"
+#endif
+
+#if defined(CONFIG_LOADER_SHA256_HW) || defined(CONFIG_LOADER_SHA256_HW_MODEL)
+
+void loader_sha256_init(loader_sha256_context *ctx)
+{
+    ctx->last = 0;
+    ctx->last_len = 0;
+    ctx->error = 0;
+    soc_hash_sha256_init();
+}
+
+/* words are built byte per byte, in memory order */
+static void loader_sha256_push_byte(loader_sha256_context *ctx, uint8_t byte)
+{
+    ctx->last |= (uint32_t)byte << (8 * ctx->last_len);
+    ctx->last_len++;
+    if (ctx->last_len == sizeof(uint32_t)) {
+        if (soc_hash_sha256_update(&ctx->last, 1)) {
+            ctx->error = -1;
+        }
+        ctx->last = 0;
+        ctx->last_len = 0;
+    }
+}
+
+void loader_sha256_update(loader_sha256_context *ctx, const uint8_t *input, uint32_t ilen)
+{
+    const uint32_t *words;
+    uint32_t nwords;
+    uint32_t word;
+    uint8_t shift;
+
+    /* unaligned head, byte per byte */
+    while ((ilen > 0) && (((physaddr_t)input & 0x3) != 0)) {
+        loader_sha256_push_byte(ctx, *input);
+        input++;
+        ilen--;
+    }
+    words = (const uint32_t*)input;
+    nwords = ilen / sizeof(uint32_t);
+    if (nwords > 0) {
+        if (ctx->last_len == 0) {
+            /* words are pushed directly (and by DMA for big enough buffers) */
+            if (soc_hash_sha256_update(words, nwords)) {
+                ctx->error = -1;
+            }
+        } else {
+            /* the pending bytes shift the input: each pushed word is made
+             * of them and of the first bytes of the next aligned word,
+             * the remaining bytes being the next pending ones */
+            shift = 8 * ctx->last_len;
+            for (uint32_t i = 0; i < nwords; i++) {
+                word = ctx->last | (words[i] << shift);
+                ctx->last = words[i] >> (32 - shift);
+                if (soc_hash_sha256_update(&word, 1)) {
+                    ctx->error = -1;
+                }
+            }
+        }
+        input += nwords * sizeof(uint32_t);
+        ilen -= nwords * sizeof(uint32_t);
+    }
+    /* tail, byte per byte */
+    while (ilen > 0) {
+        loader_sha256_push_byte(ctx, *input);
+        input++;
+        ilen--;
+    }
+}
+
+int loader_sha256_final(loader_sha256_context *ctx, uint8_t output[SHA256_DIGEST_SIZE])
+{
+    if (soc_hash_sha256_final(ctx->last, ctx->last_len, output)) {
+        ctx->error = -1;
+    }
+    soc_hash_release();
+    return ctx->error;
+}
+
+#else
+
+void loader_sha256_init(loader_sha256_context *ctx)
+{
+    sha256_init(&ctx->sha256_ctx);
+}
+
+void loader_sha256_update(loader_sha256_context *ctx, const uint8_t *input, uint32_t ilen)
+{
+    sha256_update(&ctx->sha256_ctx, input, ilen);
+}
+
+int loader_sha256_final(loader_sha256_context *ctx, uint8_t output[SHA256_DIGEST_SIZE])
+{
+    sha256_final(&ctx->sha256_ctx, output);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef LOADER_SHA256_H_
+#define LOADER_SHA256_H_
+
+#include "autoconf.h"
+#include "types.h"
+#include "libsig.h"
+
+/*
+ * SHA-256 backend used for the firmware integrity check. Depending on the
+ * configuration, this is either libecc software implementation, the HASH
+ * processor (fed by DMA) or the software model of the HASH processor.
+ *
+ * INFO: the HASH processor being a single resource, only one hardware
+ * backed context can be used at a time.
+ *
+ * With the HASH processor, big aligned buffers are read by DMA after
+ * loader_sha256_update() returns: they must not be modified until the next
+ * update or final call.
+ */
+typedef struct {
+#if defined(CONFIG_LOADER_SHA256_HW) || defined(CONFIG_LOADER_SHA256_HW_MODEL)
+    uint32_t last;       /* input bytes not yet forming a complete word */
+    uint8_t  last_len;
+    int      error;
+#else
+    sha256_context sha256_ctx;
+#endif
+} loader_sha256_context;
+
+void loader_sha256_init(loader_sha256_context *ctx);
+
+void loader_sha256_update(loader_sha256_context *ctx, const uint8_t *input, uint32_t ilen);
+
+/* returns 0 on success, -1 if the digest can't be trusted */
+int loader_sha256_final(loader_sha256_context *ctx, uint8_t output[SHA256_DIGEST_SIZE]);
+
+#endif
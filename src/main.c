@@ -53,9 +53,11 @@
 #include "soc-rng.h"
 #include "soc-rcc.h"
 #include "soc-interrupts.h"
+#include "soc-dwt.h"
 #include "boot_mode.h"
 #include "shr.h"
 #include "crc32.h"
+#include "profile.h"
 #include "gpio.h"
 #include "types.h"
 #include "flash.h"
@@ -103,6 +105,24 @@ app_entry_t dfu2_main = (app_entry_t) (DFU2_START);
  * definition and declaration of the loader context
  */
 
+#if CONFIG_WOOKEY && defined(CONFIG_FIRMWARE_DFU) && defined(CONFIG_LOADER_DFU_WAIT_PRECHECK)
+# define LOADER_PRECHECK 1
+/*
+ * Results of the firmware checks executed during the DFU button wait window,
+ * consumed later by the corresponding automaton states, if (and only if) the
+ * firmware they apply to is the one selected by the SELECTBANK state.
+ */
+typedef struct loader_precheck {
+    const t_firmware_state *fw;
+    uint32_t crc;
+    uint32_t crc_inv;           /* ~crc, checked before use */
+# ifdef CONFIG_LOADER_FW_HASH_CHECK
+    secbool integrity;
+    uint32_t integrity_inv;     /* ~integrity, checked before use */
+# endif
+} loader_precheck_t;
+#endif
+
 typedef struct loader_ctx {
     uint8_t status;
     volatile secbool dfu_mode;
@@ -113,6 +133,9 @@ typedef struct loader_ctx {
     volatile uint32_t dfu_waitsec;
     const t_firmware_state *fw;
     app_entry_t  next_stage;
+#ifdef LOADER_PRECHECK
+    loader_precheck_t precheck;
+#endif
 } loader_ctx_t;
 
 static loader_ctx_t ctx = {
@@ -124,7 +147,18 @@ static loader_ctx_t ctx = {
 #endif
     .dfu_waitsec = 2,
     .fw = 0,
-    .next_stage = 0
+    .next_stage = 0,
+#ifdef LOADER_PRECHECK
+    .precheck = {
+        .fw = 0,
+        .crc = 0,
+        .crc_inv = ~(uint32_t)0,
+# ifdef CONFIG_LOADER_FW_HASH_CHECK
+        .integrity = secfalse,
+        .integrity_inv = ~(uint32_t)secfalse,
+# endif
+    },
+#endif
 };
 
 
@@ -133,40 +167,23 @@ static loader_ctx_t ctx = {
  * automaton
  *************************************************************************/
 
-void hexdump(const uint8_t *bin, uint32_t len)
-{
-  for (uint32_t i = 0; i < len; i++) {
-    dbg_log("%x ", bin[i]);
-    if ((i % 16 == 0) && (i != 0)) {
-      dbg_log("\n");
-    }
-    dbg_flush();
-  }
-  dbg_log("\n");
-  dbg_flush();
-}
-
 void dump_fw_header(const t_firmware_state *fw)
 {
-    dbg_flush();
-    dbg_log("Magic    :  %x\n", fw->fw_sig.magic);
-    dbg_log("Version  :  %x\n", fw->fw_sig.version);
-    dbg_log("Siglen   :  %x\n", fw->fw_sig.siglen);
-    dbg_log("Len      :  %x\n", fw->fw_sig.len);
-    dbg_log("Chunksize:  %x\n", fw->fw_sig.chunksize);
-    dbg_log("Sig      :\n");
-    dbg_flush();
+    dbg_info("Magic    :  %x\n", fw->fw_sig.magic);
+    dbg_info("Version  :  %x\n", fw->fw_sig.version);
+    dbg_info("Siglen   :  %x\n", fw->fw_sig.siglen);
+    dbg_info("Len      :  %x\n", fw->fw_sig.len);
+    dbg_info("Chunksize:  %x\n", fw->fw_sig.chunksize);
+    dbg_info("Sig      :\n");
     if (fw->fw_sig.siglen) {
-        hexdump(fw->fw_sig.sig, fw->fw_sig.siglen);
+        dbg_hexdump(fw->fw_sig.sig, fw->fw_sig.siglen);
     } else {
-        hexdump(fw->fw_sig.sig, EC_MAX_SIGLEN);
+        dbg_hexdump(fw->fw_sig.sig, EC_MAX_SIGLEN);
     }
-    dbg_flush();
-    dbg_log("Crc32    :  %x\n", fw->fw_sig.crc32);
-    dbg_log("Bash     :\n");
-    hexdump(fw->fw_sig.hash, SHA256_DIGEST_SIZE);
-    dbg_log("Bootable :  %x\n", fw->bootable);
-    dbg_flush();
+    dbg_info("Crc32    :  %x\n", fw->fw_sig.crc32);
+    dbg_info("Bash     :\n");
+    dbg_hexdump(fw->fw_sig.hash, SHA256_DIGEST_SIZE);
+    dbg_info("Bootable :  %x\n", fw->bootable);
 }
 
 extern const shr_vars_t flip_shared_vars;
@@ -174,6 +191,111 @@ extern const shr_vars_t flip_shared_vars;
 extern const shr_vars_t flop_shared_vars;
 #endif
 
+/*
+ * Compute the CRC32 of the firmware header sector, considering the crc32
+ * and sig fields as filled with 0xff
+ */
+static uint32_t loader_fw_header_crc(const t_firmware_state *fw)
+{
+    uint32_t crc;
+    const crc32_block_t blocks[] = {
+        /* header fields, up to the crc32 field (excluded) */
+        { (const uint8_t*)fw, sizeof(t_firmware_signature) - sizeof(uint32_t) - SHA256_DIGEST_SIZE - EC_MAX_SIGLEN, 0 },
+        /* crc32 field */
+        { NULL, sizeof(uint32_t), 0xff },
+        { (const uint8_t*)(fw->fw_sig.hash), SHA256_DIGEST_SIZE, 0 },
+        /* sig field */
+        { NULL, EC_MAX_SIGLEN, 0xff },
+        /* padding (fill field) */
+        { (const uint8_t*)(fw->fill), SHR_SECTOR_SIZE - sizeof(t_firmware_signature), 0 },
+        /* bootable flag */
+        { (const uint8_t*)&(fw->bootable), sizeof(uint32_t), 0 },
+        { (const uint8_t*)&(fw->fill2), SHR_SECTOR_SIZE - sizeof(uint32_t), 0 },
+    };
+
+    profile_mark(PROFILE_HDRCRC_START);
+    crc = crc32_blocks(blocks, sizeof(blocks) / sizeof(crc32_block_t), 0xffffffff);
+    profile_mark(PROFILE_HDRCRC_END);
+
+    return crc;
+}
+
+#ifdef LOADER_PRECHECK
+/*
+ * Get the firmware the SELECTBANK state is expected to select. There is no
+ * need for fault protection here: the selection itself is made (and
+ * protected) by SELECTBANK, this one is only used to execute the firmware
+ * checks in advance.
+ */
+static const t_firmware_state *loader_precheck_candidate(uint32_t *partition_addr,
+                                                         uint32_t *partition_size)
+{
+# ifdef CONFIG_FIRMWARE_DUALBANK
+    if ((flip_shared_vars.fw.bootable == FW_BOOTABLE) && (flop_shared_vars.fw.bootable == FW_BOOTABLE)) {
+        if (flip_shared_vars.fw.fw_sig.version > flop_shared_vars.fw.fw_sig.version) {
+            goto flip;
+        }
+        if (flop_shared_vars.fw.fw_sig.version > flip_shared_vars.fw.fw_sig.version) {
+            goto flop;
+        }
+        return NULL;
+    }
+    if (flop_shared_vars.fw.bootable == FW_BOOTABLE) {
+        goto flop;
+    }
+# endif
+    if (flip_shared_vars.fw.bootable == FW_BOOTABLE) {
+        goto flip;
+    }
+    return NULL;
+flip:
+    *partition_addr = FLIP_BASE;
+    *partition_size = FLIP_SIZE;
+    return &flip_shared_vars.fw;
+# ifdef CONFIG_FIRMWARE_DUALBANK
+flop:
+    *partition_addr = FLOP_BASE;
+    *partition_size = FLOP_SIZE;
+    return &flop_shared_vars.fw;
+# endif
+}
+
+/* Execute the header CRC and firmware integrity checks of the candidate firmware */
+static void loader_precheck_fw(void)
+{
+    const t_firmware_state *fw;
+    uint32_t partition_addr = 0;
+    uint32_t partition_size = 0;
+
+    fw = loader_precheck_candidate(&partition_addr, &partition_size);
+    if (fw == NULL) {
+        return;
+    }
+    ctx.precheck.crc = loader_fw_header_crc(fw);
+    ctx.precheck.crc_inv = ~ctx.precheck.crc;
+# ifdef CONFIG_LOADER_FW_HASH_CHECK
+    profile_mark(PROFILE_SHA256_START);
+    ctx.precheck.integrity = check_fw_hash(fw, partition_addr, partition_size);
+    ctx.precheck.integrity_inv = ~(uint32_t)ctx.precheck.integrity;
+    profile_mark(PROFILE_SHA256_END);
+# endif
+    ctx.precheck.fw = fw;
+}
+
+/* return sectrue if the precheck results apply to the selected firmware */
+static secbool loader_precheck_valid(void)
+{
+    if ((ctx.precheck.fw != NULL) && (ctx.precheck.fw == ctx.fw)) {
+        /* Double check for faults */
+        if (ctx.precheck.fw != ctx.fw) {
+            return secfalse;
+        }
+        return sectrue;
+    }
+    return secfalse;
+}
+#endif
+
 /**************************************************************************
  * Successive transition functions, each handling one given transition
  *************************************************************************/
@@ -202,19 +324,18 @@ static loader_request_t loader_exec_req_init(loader_state_t nextstate)
     /* entering transition target state (here LOADER_INIT) */
     loader_set_state(nextstate);
 
-    dbg_log("======= Wookey Loader ========\n");
-    dbg_log("Built date\t: %s at %s\n", __DATE__, __TIME__);
+    dbg_info("======= Wookey Loader ========\n");
+    dbg_info("Built date\t: %s at %s\n", __DATE__, __TIME__);
 #if defined(CONFIG_STM32F429)
-    dbg_log("Board\t\t: STM32F429\n");
+    dbg_info("Board\t\t: STM32F429\n");
 #elif defined(CONFIG_STM32F439)
-    dbg_log("Board\t\t: STM32F439\n");
+    dbg_info("Board\t\t: STM32F439\n");
 #elif defined(CONFIG_STM32F407)
-    dbg_log("Board\t\t: STM32F407\n");
+    dbg_info("Board\t\t: STM32F407\n");
 #else
-    dbg_log("Board\t\t: Unknown!!\n");
+    dbg_info("Board\t\t: Unknown!!\n");
 #endif
-    dbg_log("==============================\n");
-    dbg_flush();
+    dbg_info("==============================\n");
 
     /* There is no specific error handling in INIT state by now.
      * We can directly request the next transition... */
@@ -251,8 +372,7 @@ static loader_request_t loader_exec_req_rdpcheck(loader_state_t nextstate)
             NVIC_SystemReset();
             while (1);
         case FLASH_RDP_CHIPPROTECT:
-            dbg_log("Flash is fully protected\n");
-            dbg_flush();
+            dbg_info("Flash is fully protected\n");
             /* valid behavior */
             switch (prevstate) {
                 case LOADER_INIT:
@@ -315,6 +435,49 @@ static loader_request_t loader_exec_req_rdpcheck(loader_state_t nextstate)
     return nextreq;
 }
 
+#if CONFIG_WOOKEY && defined(CONFIG_FIRMWARE_DFU)
+/* INFO: DFU button is on GPIO E4 on Wookey board, routed to EXTI line 4 */
+#define EXTI_LINE4              ((uint32_t)0x10)
+#define r_CORTEX_M_SYSCFG_EXTICR2  REG_ADDR(SYSCFG_BASE + (uint32_t)0x0C)
+#define SYSCFG_EXTICR2_EXTI4_Pos   0
+#define SYSCFG_EXTICR2_EXTI4_Msk   ((uint32_t)0xf << SYSCFG_EXTICR2_EXTI4_Pos)
+
+#define DFU_WAIT_CYCLES_PER_SEC    ((uint32_t)PROD_CORE_FREQUENCY * 1000)
+
+static void dfu_button_exti_configure(void)
+{
+    set_reg_bits(r_CORTEX_M_RCC_APB2ENR, RCC_APB2ENR_SYSCFGEN);
+    /* EXTI line 4 source is port E */
+    set_reg(r_CORTEX_M_SYSCFG_EXTICR2, GPIO_PE, SYSCFG_EXTICR2_EXTI4);
+    /* clear any previous event */
+    write_reg_value(EXTI_PR, EXTI_LINE4);
+    NVIC_ClearPendingIRQ(EXTI4_IRQ - 0x10);
+    /* rising edge (button push) generates an interrupt */
+    set_reg_bits(EXTI_RTSR, EXTI_LINE4);
+    set_reg_bits(EXTI_IMR, EXTI_LINE4);
+    NVIC_EnableIRQ(EXTI4_IRQ - 0x10);
+}
+
+static void dfu_button_exti_release(void)
+{
+    NVIC_DisableIRQ(EXTI4_IRQ - 0x10);
+    clear_reg_bits(EXTI_IMR, EXTI_LINE4);
+    clear_reg_bits(EXTI_RTSR, EXTI_LINE4);
+    write_reg_value(EXTI_PR, EXTI_LINE4);
+    NVIC_ClearPendingIRQ(EXTI4_IRQ - 0x10);
+    set_reg(r_CORTEX_M_SYSCFG_EXTICR2, 0, SYSCFG_EXTICR2_EXTI4);
+}
+
+/* DFU button push handler (EXTI line 4) */
+void exti_button_handler(uint8_t irq __attribute__((unused)),
+                         uint32_t sr __attribute__((unused)),
+                         uint32_t dr __attribute__((unused)))
+{
+    write_reg_value(EXTI_PR, EXTI_LINE4);
+    ctx.dfu_mode = sectrue;
+}
+#endif
+
 static loader_request_t loader_exec_req_dfucheck(loader_state_t nextstate)
 {
 
@@ -338,9 +501,7 @@ static loader_request_t loader_exec_req_dfucheck(loader_state_t nextstate)
 # ifdef CONFIG_FIRMWARE_DFU
     dev_gpio_info_t gpio = { 0 };
 
-    soc_dwt_init();
-    dbg_log("Registering button on GPIO E4\n");
-    dbg_flush();
+    dbg_debug("Registering button on GPIO E4\n");
 
     gpio.kref.port = GPIO_PE; /* INFO: this is Wookey board specific */
     gpio.kref.pin = 4;        /* INFO: this is Wookey board specific */
@@ -356,32 +517,38 @@ static loader_request_t loader_exec_req_dfucheck(loader_state_t nextstate)
     gpio.lck = 0;
 
     soc_gpio_set_config(&gpio);
+    /* button push is detected by the EXTI line 4 IRQ (rising edge)... */
+    dfu_button_exti_configure();
+    /* ... but the button may have been pushed before */
+    if (soc_gpio_get(gpio.kref) != 0) {
+        ctx.dfu_mode = sectrue;
+    }
 
-    // wait 1s for button push...
-
-    dbg_log("Waiting for DFU jump through button push (%d seconds)\n", ctx.dfu_waitsec);
-    uint32_t start, stop;
-    uint8_t button_pushed;
-    do {
-        // in millisecs
-        start = soc_dwt_getcycles() / 168000;
-        do {
-            stop = soc_dwt_getcycles() / 168000;
-            button_pushed = soc_gpio_get(gpio.kref);
-            if (button_pushed != 0) {
-                ctx.dfu_mode = sectrue;
-                break;
-            }
-        } while ((stop - start) < 1000); // < 1s
-        dbg_log(".");
-        dbg_flush();
+    dbg_info("Waiting for DFU jump through button push (%d seconds)\n", ctx.dfu_waitsec);
+    uint32_t start = soc_dwt_getcycles();
+#  ifdef LOADER_PRECHECK
+    /* Instead of busy waiting, check the candidate firmware. This is made
+     * in the DFU mode too, as the DFU mode of the same firmware is booted */
+    loader_precheck_fw();
+#  endif
+    /* wait for the remaining of the window (if any) */
+    while (ctx.dfu_waitsec > 0) {
+        while ((soc_dwt_getcycles() - start) < DFU_WAIT_CYCLES_PER_SEC) {
+            continue;
+        }
+        start += DFU_WAIT_CYCLES_PER_SEC;
+        dbg_info(".");
         ctx.dfu_waitsec--;
-    } while (ctx.dfu_waitsec > 0);
-    /* now we have finished with the DFU button, release the GPIO */
+    }
+    if (soc_gpio_get(gpio.kref) != 0) {
+        ctx.dfu_mode = sectrue;
+    }
+    /* now we have finished with the DFU button, release the EXTI and the GPIO */
+    dfu_button_exti_release();
     soc_gpio_release(&gpio);
-    dbg_log("Booting...\n");
+    dbg_info("Booting...\n");
 # else
-    dbg_log("Booting...\n");
+    dbg_info("Booting...\n");
 # endif
 #endif
     return LOADER_REQ_RDPCHECK;
@@ -409,12 +576,11 @@ static loader_request_t loader_exec_req_selectbank(loader_state_t nextstate)
         !(flip_shared_vars.fw.bootable != FW_BOOTABLE || flop_shared_vars.fw.bootable != FW_BOOTABLE)){
         ctx.boot_flip = sectrue;
         ctx.boot_flop = sectrue;
-        dbg_log("Both firwares have FW_BOOTABLE\n");
-        dbg_log(COLOR_REVERSE "Flip version: %d\n" COLOR_NORMAL,
+        dbg_info("Both firwares have FW_BOOTABLE\n");
+        dbg_info(COLOR_REVERSE "Flip version: %d\n" COLOR_NORMAL,
             flip_shared_vars.fw.fw_sig.version);
-        dbg_log(COLOR_REVERSE "Flop version: %d\n" COLOR_NORMAL,
+        dbg_info(COLOR_REVERSE "Flop version: %d\n" COLOR_NORMAL,
             flop_shared_vars.fw.fw_sig.version);
-        dbg_flush();
         if (flip_shared_vars.fw.fw_sig.version > flop_shared_vars.fw.fw_sig.version) {
             /* Sanity check agaist fault on rollback */
             if(!(flip_shared_vars.fw.fw_sig.version > flop_shared_vars.fw.fw_sig.version)){
@@ -439,8 +605,7 @@ static loader_request_t loader_exec_req_selectbank(loader_state_t nextstate)
         }
         /* end of select sanitize... */
         if (!ctx.fw) {
-            dbg_log(COLOR_REDBG "Unable to choose! leaving!\n" COLOR_NORMAL);
-            dbg_flush();
+            dbg_err(COLOR_REDBG "Unable to choose! leaving!\n" COLOR_NORMAL);
             goto err;
         }
 
@@ -457,15 +622,13 @@ static loader_request_t loader_exec_req_selectbank(loader_state_t nextstate)
             goto err;
         }
         ctx.boot_flop = sectrue;
-        dbg_log("Flop seems bootable\n");
-        dbg_log(COLOR_REVERSE "Flop version: %d\n" COLOR_NORMAL, flop_shared_vars.fw.fw_sig.version);
-        dbg_flush();
+        dbg_info("Flop seems bootable\n");
+        dbg_info(COLOR_REVERSE "Flop version: %d\n" COLOR_NORMAL, flop_shared_vars.fw.fw_sig.version);
         ctx.boot_flip = secfalse;
         ctx.fw = &flop_shared_vars.fw;
         /* end of select sanitize... */
         if (!ctx.fw) {
-            dbg_log(COLOR_REDBG "Unable to choose! leaving!\n" COLOR_NORMAL);
-            dbg_flush();
+            dbg_err(COLOR_REDBG "Unable to choose! leaving!\n" COLOR_NORMAL);
             goto err;
         }
         /* postcheck: FIA protection */
@@ -478,33 +641,30 @@ static loader_request_t loader_exec_req_selectbank(loader_state_t nextstate)
 #endif
     /* In one bank configuration, only FLIP can be started */
     if (flip_shared_vars.fw.bootable == FW_BOOTABLE) {
-        dbg_log(COLOR_REVERSE "Flip version: %d\n" COLOR_NORMAL, flip_shared_vars.fw.fw_sig.version);
+        dbg_info(COLOR_REVERSE "Flip version: %d\n" COLOR_NORMAL, flip_shared_vars.fw.fw_sig.version);
         ctx.boot_flip = sectrue;
-        dbg_log("Flip seems bootable\n");
-        dbg_flush();
+        dbg_info("Flip seems bootable\n");
 #ifdef CONFIG_FIRMWARE_DUALBANK
         ctx.boot_flop = secfalse;
 #endif
         ctx.fw = &flip_shared_vars.fw;
         /* end of select sanitize... */
         if (!ctx.fw) {
-            dbg_log(COLOR_REDBG "Unable to choose! leaving!\n" COLOR_NORMAL);
-            dbg_flush();
+            dbg_err(COLOR_REDBG "Unable to choose! leaving!\n" COLOR_NORMAL);
             goto err;
         }
         goto check_crc;
     }
 
     /* fallback, none of the above allows to go to check_crc step */
-    dbg_log(COLOR_REDBG "Panic! unable to boot on any firmware! none bootable\n" COLOR_NORMAL);
-    dbg_log("Flip header:\n");
+    dbg_err(COLOR_REDBG "Panic! unable to boot on any firmware! none bootable\n" COLOR_NORMAL);
+    dbg_info("Flip header:\n");
     dump_fw_header(&(flip_shared_vars.fw));
 #ifdef CONFIG_FIRMWARE_DUALBANK
-    dbg_log("------------\n");
-    dbg_log("Flop header:\n");
+    dbg_info("------------\n");
+    dbg_info("Flop header:\n");
     dump_fw_header(&(flop_shared_vars.fw));
 #endif
-    dbg_flush();
     goto err;
 
 check_crc:
@@ -527,16 +687,14 @@ static loader_request_t loader_exec_req_crccheck(loader_state_t nextstate)
         /* Sanity check on the current selected partition and the header in flash */
         if (ctx.boot_flip == sectrue) {
             if((ctx.fw)->fw_sig.type != PART_FLIP){
-                dbg_log(COLOR_REDBG "Error: FLIP selected, but partition type in flash header is not conforming!\n" COLOR_NORMAL);
-                dbg_flush();
+                dbg_err(COLOR_REDBG "Error: FLIP selected, but partition type in flash header is not conforming!\n" COLOR_NORMAL);
                 goto err;
             }
         }
 #ifdef CONFIG_FIRMWARE_DUALBANK
         else if((ctx.boot_flip == secfalse) && (ctx.boot_flop == sectrue)){
             if((ctx.fw)->fw_sig.type != PART_FLOP){
-                dbg_log(COLOR_REDBG "Error: FLOP selected, but partition type in flash header is not conforming!\n" COLOR_NORMAL);
-                dbg_flush();
+                dbg_err(COLOR_REDBG "Error: FLOP selected, but partition type in flash header is not conforming!\n" COLOR_NORMAL);
                 goto err;
             }
         }
@@ -547,33 +705,37 @@ static loader_request_t loader_exec_req_crccheck(loader_state_t nextstate)
     }
     /* sanity check okay, calculating CRC32 */
     {
-        uint32_t buf = 0xffffffff;
 #if CONFIG_LOADER_EXTRA_DEBUG
         dump_fw_header(ctx.fw);
 #endif
         uint32_t crc = 0;
         /* checking CRC32 header check */
-        crc = crc32((const uint8_t*)ctx.fw, sizeof(t_firmware_signature) - sizeof(uint32_t) - SHA256_DIGEST_SIZE - EC_MAX_SIGLEN, 0xffffffff);
-        crc = crc32((uint8_t*)&buf, sizeof(uint32_t), crc);
-        crc = crc32((const uint8_t*)((ctx.fw)->fw_sig.hash), SHA256_DIGEST_SIZE, crc);
-        for (uint32_t i = 0; i <  EC_MAX_SIGLEN; ++i) {
-            crc = crc32((uint8_t*)&buf, sizeof(uint8_t), crc);
+#ifdef LOADER_PRECHECK
+        secbool precheck = loader_precheck_valid();
+        if (precheck == sectrue) {
+            /* already computed during the DFU wait */
+            crc = ctx.precheck.crc;
+        } else {
+            crc = loader_fw_header_crc(ctx.fw);
         }
-        /* check CRC of padding (fill field) */
-        crc = crc32((const uint8_t*)((ctx.fw)->fill), SHR_SECTOR_SIZE - sizeof(t_firmware_signature), crc);
-        /* check CRC of bootable flag  */
-        crc = crc32((const uint8_t*)&((ctx.fw)->bootable), sizeof(uint32_t), crc);
-        crc = crc32((const uint8_t*)&((ctx.fw)->fill2), SHR_SECTOR_SIZE - sizeof(uint32_t), crc);
+#else
+        crc = loader_fw_header_crc(ctx.fw);
+#endif
 
 	/* Double check for faults */
         if (crc != (ctx.fw)->fw_sig.crc32) {
-            dbg_log(COLOR_REDBG "Invalid fw header CRC32: %x, %x required!!! leaving...\n" COLOR_NORMAL, crc, (ctx.fw)->fw_sig.crc32);
-            dbg_flush();
+            dbg_err(COLOR_REDBG "Invalid fw header CRC32: %x, %x required!!! leaving...\n" COLOR_NORMAL, crc, (ctx.fw)->fw_sig.crc32);
             goto err;
         }
+#ifdef LOADER_PRECHECK
+        /* the CRC32 computed during the DFU wait is not trusted alone:
+         * the double check is made on its redundant copy */
+        if (precheck == sectrue) {
+            crc = ~ctx.precheck.crc_inv;
+        }
+#endif
         if (crc != (ctx.fw)->fw_sig.crc32) {
-            dbg_log(COLOR_REDBG "Invalid fw header CRC32: %x, %x required!!! leaving...\n" COLOR_NORMAL, crc, (ctx.fw)->fw_sig.crc32);
-            dbg_flush();
+            dbg_err(COLOR_REDBG "Invalid fw header CRC32: %x, %x required!!! leaving...\n" COLOR_NORMAL, crc, (ctx.fw)->fw_sig.crc32);
             goto err;
         }
     }
@@ -610,12 +772,44 @@ static loader_request_t loader_exec_req_integritycheck(loader_state_t nextstate)
     else{
         goto err;
     }
-    if (check_fw_hash(ctx.fw, partition_addr, partition_size) != sectrue)
+# if CONFIG_LOADER_EXTRA_DEBUG
+    uint32_t start = soc_dwt_getcycles();
+# endif
+    secbool integrity = secfalse;
+# ifdef LOADER_PRECHECK
+    if (loader_precheck_valid() == sectrue) {
+        /* already computed during the DFU wait */
+        integrity = ctx.precheck.integrity;
+        /* Double check for faults: the cached result must match its
+         * redundant copy, and the header it was checked against must be
+         * the one checked by CRCCHECK */
+        if ((ctx.precheck.integrity_inv != ~(uint32_t)integrity) ||
+            (ctx.precheck.crc_inv != ~(ctx.fw)->fw_sig.crc32)) {
+            integrity = secfalse;
+        }
+    } else {
+        profile_mark(PROFILE_SHA256_START);
+        integrity = check_fw_hash(ctx.fw, partition_addr, partition_size);
+        profile_mark(PROFILE_SHA256_END);
+    }
+# else
+    profile_mark(PROFILE_SHA256_START);
+    integrity = check_fw_hash(ctx.fw, partition_addr, partition_size);
+    profile_mark(PROFILE_SHA256_END);
+# endif
+    if (integrity != sectrue)
+    {
+        dbg_err(COLOR_REDBG "Error while checking firmware integrity! Leaving \n" COLOR_NORMAL);
+        goto err;
+    }
+    /* Double check for faults */
+    if (integrity != sectrue)
     {
-        dbg_log(COLOR_REDBG "Error while checking firmware integrity! Leaving \n" COLOR_NORMAL);
-        dbg_flush();
         goto err;
     }
+# if CONFIG_LOADER_EXTRA_DEBUG
+    dbg_debug("Firmware integrity checked in %d cycles\n", soc_dwt_getcycles() - start);
+# endif
 
 #endif
     return LOADER_REQ_RDPCHECK;
@@ -638,58 +832,56 @@ static loader_request_t loader_exec_req_flashlock(loader_state_t nextstate)
 
     if (ctx.dfu_mode == sectrue) {
         if (ctx.boot_flip == sectrue) {
-            dbg_log("Locking local bank write\n");
+            dbg_info("Locking local bank write\n");
             flash_unlock_opt();
             flash_writelock_bank1();
             flash_writeunlock_bank2();
             flash_lock_opt();
-            dbg_log(COLOR_REVERSE "Booting FLIP in DFU mode\n" COLOR_NORMAL);
-            dbg_log("Jumping to DFU mode: %x\n", DFU1_START);
+            dbg_info(COLOR_REVERSE "Booting FLIP in DFU mode\n" COLOR_NORMAL);
+            dbg_info("Jumping to DFU mode: %x\n", DFU1_START);
             ctx.next_stage = (app_entry_t)DFU1_START;
         }
 #ifdef CONFIG_FIRMWARE_DUALBANK
         else if ((ctx.boot_flip == secfalse) && (ctx.boot_flop == sectrue)) {
-            dbg_log("locking local bank write\n");
+            dbg_info("locking local bank write\n");
             flash_unlock_opt();
             flash_writeunlock_bank1();
             flash_writelock_bank2();
             flash_lock_opt();
-            dbg_log(COLOR_REVERSE "Booting FLOP in DFU mode\n" COLOR_NORMAL);
-            dbg_log("Jumping to DFU mode: %x\n", DFU2_START);
+            dbg_info(COLOR_REVERSE "Booting FLOP in DFU mode\n" COLOR_NORMAL);
+            dbg_info("Jumping to DFU mode: %x\n", DFU2_START);
             ctx.next_stage = (app_entry_t)DFU2_START;
         }
 #endif
         else{
             goto err;
         }
-        dbg_flush();
     } else if (ctx.dfu_mode == secfalse) {
         if (ctx.boot_flip == sectrue) {
-            dbg_log("Locking flash write\n");
+            dbg_info("Locking flash write\n");
             flash_unlock_opt();
             flash_writelock_bank1();
             flash_writelock_bank2();
             flash_lock_opt();
-            dbg_log(COLOR_REVERSE "Booting FLIP in nominal mode\n" COLOR_NORMAL);
-            dbg_log("Jumping to FW mode: %x\n", FW1_START);
+            dbg_info(COLOR_REVERSE "Booting FLIP in nominal mode\n" COLOR_NORMAL);
+            dbg_info("Jumping to FW mode: %x\n", FW1_START);
             ctx.next_stage = (app_entry_t)FW1_START;
         }
 #ifdef CONFIG_FIRMWARE_DUALBANK
         else if ((ctx.boot_flip == secfalse) && (ctx.boot_flop == sectrue)) {
-            dbg_log("Locking flash write\n");
+            dbg_info("Locking flash write\n");
             flash_unlock_opt();
             flash_writelock_bank1();
             flash_writelock_bank2();
             flash_lock_opt();
-            dbg_log(COLOR_REVERSE "Booting FLOP in nominal mode\n" COLOR_NORMAL);
-            dbg_log("Jumping to FW mode: %x\n", FW2_START);
+            dbg_info(COLOR_REVERSE "Booting FLOP in nominal mode\n" COLOR_NORMAL);
+            dbg_info("Jumping to FW mode: %x\n", FW2_START);
             ctx.next_stage = (app_entry_t)FW2_START;
         }
 #endif
         else{
             goto err;
         }
-        dbg_flush();
     }
     else{
         goto err;
@@ -713,8 +905,7 @@ static loader_request_t loader_exec_req_boot(loader_state_t nextstate)
     }
     loader_set_state(nextstate);
 
-    dbg_log("Geronimo !\n");
-    dbg_flush();
+    dbg_info("Geronimo !\n");
     disable_irq();
 
     /* Sanity check */
@@ -772,6 +963,7 @@ static loader_request_t loader_exec_req_boot(loader_state_t nextstate)
         static unsigned int i;
         static uint32_t *bkp_ptr = (uint32_t*)BKPSRAM_BASE;
         static uint32_t random;
+        profile_mark(PROFILE_BKPSRAM_SCRUB_START);
         for(i = (BKPSRAM_EMULATE_OTP_SIZE / sizeof(uint32_t)); i < (BKPSRAM_SIZE / sizeof(uint32_t)); i++){
             if(soc_get_random((uint32_t*)&random)){
                 goto err;
@@ -784,6 +976,7 @@ static loader_request_t loader_exec_req_boot(loader_state_t nextstate)
             }
             bkp_ptr[i] = random;
         }
+        profile_mark(PROFILE_BKPSRAM_SCRUB_END);
 #if defined(CONFIG_LOADER_BSRAM_KEYBAG_AUTH) || defined(CONFIG_LOADER_BSRAM_KEYBAG_DFU) || defined(CONFIG_LOADER_BSRAM_FLASH_KEY)
         /* Now copy the appropriate keybag in SRAM */
         static uint8_t *bkp_ptr_char = (uint8_t*)BKPSRAM_BASE;
@@ -792,7 +985,8 @@ static loader_request_t loader_exec_req_boot(loader_state_t nextstate)
         static uint8_t *dfu_flash_key_iv_start = NULL;
 	static uint32_t dfu_flash_key_iv_len = 0;
         /* Slot size should be the same for keybags (checked before) */
-        static uint32_t keybag_slot_size = (uint32_t)&__noupgrade_dfu_flash_len;
+        static uint32_t keybag_slot_size;
+        keybag_slot_size = (uint32_t)&__noupgrade_dfu_flash_len;
         if (ctx.dfu_mode == sectrue){
 #if defined(CONFIG_LOADER_BSRAM_KEYBAG_DFU)
             keybag_flash_start = (uint8_t*)&__noupgrade_dfu_flash_start;
@@ -814,6 +1008,7 @@ static loader_request_t loader_exec_req_boot(loader_state_t nextstate)
             goto err;
         }
 
+        profile_mark(PROFILE_KEYBAG_COPY_START);
         /* Copy keybag if we can */
         if(IS_IN_FLASH((physaddr_t)keybag_flash_start) && IS_IN_FLASH((physaddr_t)(keybag_flash_start + keybag_flash_len))){
             for(i = 0; i < keybag_flash_len; i++){
@@ -828,6 +1023,14 @@ static loader_request_t loader_exec_req_boot(loader_state_t nextstate)
                 }
             }
         }
+        profile_mark(PROFILE_KEYBAG_COPY_END);
+#endif
+
+        /* export the boot time samples, after the keybags */
+#if defined(CONFIG_LOADER_BSRAM_KEYBAG_AUTH) || defined(CONFIG_LOADER_BSRAM_KEYBAG_DFU) || defined(CONFIG_LOADER_BSRAM_FLASH_KEY)
+        profile_export(bsram_len_to_copy);
+#else
+        profile_export(BKPSRAM_EMULATE_OTP_SIZE);
 #endif
 
 #ifdef CONFIG_LOADER_USE_PVD
@@ -847,8 +1050,7 @@ err:
 
 static loader_request_t loader_exec_error(loader_state_t state)
 {
-    dbg_log("ERROR! entering error from state %x!\n", state);
-    dbg_flush();
+    dbg_err("ERROR! entering error from state %x!\n", state);
     NVIC_SystemReset();
     while (1); /* waiting for reset */
     return LOADER_REQ_ERROR;
@@ -856,8 +1058,7 @@ static loader_request_t loader_exec_error(loader_state_t state)
 
 static loader_request_t loader_exec_secbreach(loader_state_t state)
 {
-    dbg_log("ERROR! entering Security breach from state %x!\n", state);
-    dbg_flush();
+    dbg_err("ERROR! entering Security breach from state %x!\n", state);
     /*In case of security breach, we may react differently before reseting */
     /* let's lock both flash bank*/
 #if CONFIG_LOADER_ERASE_ON_SECBREACH
@@ -1032,6 +1233,8 @@ void loader_basic_init(void)
 {
     disable_irq();
     core_systick_init();
+    /* cycle counter, used for DFU button wait and boot time measurement */
+    soc_dwt_init();
     // button now managed at kernel boot to detect if DFU mode
     debug_console_init();
 
@@ -1094,9 +1297,8 @@ int main(void)
      * with the stack.
      */
     static uint32_t sp = (BKPSRAM_BASE + BKPSRAM_SIZE);
-    __asm__ volatile ("mov sp, %0" :: "r" (sp) :);
-    __asm__ volatile ("isb");
-    __asm__ volatile ("dsb");
+    core_write_msp((void*)sp);
+    full_memory_barrier();
 
 #ifdef CONFIG_LOADER_USE_PVD
     PVD_configuration();
@@ -1118,8 +1320,7 @@ int main(void)
 
     loader_exec_automaton(initial_req);
 
-    dbg_log(COLOR_REDBG "Error while selecting next level! leaving!\n" COLOR_NORMAL);
-    dbg_flush();
+    dbg_err(COLOR_REDBG "Error while selecting next level! leaving!\n" COLOR_NORMAL);
     loader_exec_error(loader_get_state());
     return 0;
 err:
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "autoconf.h"
+#include "profile.h"
+#include "m4-cpu.h"
+#include "soc-dwt.h"
+#include "soc-init.h"
+
+#ifdef CONFIG_LOADER_BOOT_PROFILE
+
+static profile_table_t profile_table;
+
+void profile_mark(uint32_t id)
+{
+    uint64_t cycles;
+
+    /* catch the 32 bits cycle counter wrap (about 25 seconds at 168MHz) */
+    soc_dwt_ovf_manage();
+    cycles = soc_dwt_getcycles_64();
+    if (profile_table.count >= PROFILE_MAX_MARKS) {
+        profile_table.dropped++;
+        goto end;
+    }
+    profile_table.samples[profile_table.count].id = id;
+    profile_table.samples[profile_table.count].reserved = 0;
+    profile_table.samples[profile_table.count].cycles = cycles;
+    profile_table.count++;
+end:
+    return;
+}
+
+void profile_export(uint32_t reserved)
+{
+    volatile uint32_t *dst = (volatile uint32_t *)PROFILE_TABLE_ADDR;
+    const uint32_t *src = (const uint32_t *)&profile_table;
+    uint32_t sp;
+    uint32_t i;
+
+    profile_mark(PROFILE_NEXT_STAGE);
+    /* the table must overlap neither the keybags... */
+    if (reserved > PROFILE_BKPSRAM_OFFSET) {
+        goto end;
+    }
+    /* ... nor the stack, which is in Backup SRAM */
+    sp = (uint32_t)core_read_msp();
+    if ((sp >= BKPSRAM_BASE) && (sp < (PROFILE_TABLE_ADDR + sizeof(profile_table_t)))) {
+        goto end;
+    }
+    profile_table.magic = PROFILE_MAGIC;
+    profile_table.version = PROFILE_VERSION;
+    profile_table.core_freq = PROD_CORE_FREQUENCY;
+    /* the magic is written last: a partially written table is invalid */
+    for (i = 1; i < (sizeof(profile_table_t) / sizeof(uint32_t)); i++) {
+        dst[i] = src[i];
+    }
+    dst[0] = src[0];
+end:
+    return;
+}
+
+#endif
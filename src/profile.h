@@ -0,0 +1,106 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "autoconf.h"
+#include "types.h"
+#include "soc-bkpsram.h"
+
+/*
+ * Boot time profiler: the DWT cycle counter is sampled at each automaton
+ * state transition and at the beginning and end of the main boot phases.
+ * The samples are exported, just before booting the next stage, in a table
+ * at a fixed Backup SRAM address, where the next stage can read them, and
+ * which can be decoded from a memory dump by tools/profile_dump.py.
+ *
+ * The table is exported once the Backup SRAM has been scrubbed and the
+ * keybags copied, and is left untouched if it would overlap the keybags or
+ * the loader stack.
+ */
+#define PROFILE_MAGIC           0x464f5250  /* "PROF" */
+#define PROFILE_VERSION         1
+#define PROFILE_MAX_MARKS       32
+#define PROFILE_BKPSRAM_OFFSET  0x800
+#define PROFILE_TABLE_ADDR      (BKPSRAM_BASE + PROFILE_BKPSRAM_OFFSET)
+
+/*
+ * Phases marks. The automaton state transitions are marked with the new
+ * state value (loader_state_t), which never has its high byte set.
+ */
+typedef enum {
+    PROFILE_HDRCRC_START        = 0xf0000001,
+    PROFILE_HDRCRC_END          = 0xf0000002,
+    PROFILE_SHA256_START        = 0xf0000003,
+    PROFILE_SHA256_END          = 0xf0000004,
+    PROFILE_BKPSRAM_SCRUB_START = 0xf0000005,
+    PROFILE_BKPSRAM_SCRUB_END   = 0xf0000006,
+    PROFILE_KEYBAG_COPY_START   = 0xf0000007,
+    PROFILE_KEYBAG_COPY_END     = 0xf0000008,
+    PROFILE_NEXT_STAGE          = 0xf00000ff,
+} profile_mark_t;
+
+typedef struct {
+    uint32_t id;        /* profile_mark_t or loader_state_t */
+    uint32_t reserved;
+    uint64_t cycles;    /* DWT cycle count since the loader start */
+} profile_sample_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;     /* number of valid samples */
+    uint32_t core_freq; /* core frequency, in kHz */
+    uint32_t dropped;   /* samples dropped while the table was full */
+    profile_sample_t samples[PROFILE_MAX_MARKS];
+} profile_table_t;
+
+#ifdef CONFIG_LOADER_BOOT_PROFILE
+/**
+ * profile_mark - record the current cycle count
+ * @id: phase mark (profile_mark_t) or new automaton state
+ */
+void profile_mark(uint32_t id);
+
+/**
+ * profile_export - export the samples table in Backup SRAM
+ * @reserved: Backup SRAM bytes already used (keybags), from its base
+ */
+void profile_export(uint32_t reserved);
+#else
+# define profile_mark(id)           do { (void)(id); } while (0)
+# define profile_export(reserved)   do { (void)(reserved); } while (0)
+#endif
+
+#endif/*!PROFILE_H_*/
@@ -43,6 +43,21 @@
 #define READ_BIT(REG, BIT)    ((REG) & (BIT))
 #define CLEAR_REG(REG)        ((REG) = (0x0))
 
+/*
+ * Host build: the 32 bits register accesses made through these helpers are
+ * notified to the simulated SoC (before a read, after a write), which models
+ * the peripherals side effects (see arch/socs/host/soc-host.h).
+ */
+#ifdef LOADER_HOST
+void soc_host_reg_read(volatile const uint32_t *reg);
+void soc_host_reg_write(volatile const uint32_t *reg);
+# define reg_read_notify(reg)   soc_host_reg_read(reg)
+# define reg_write_notify(reg)  soc_host_reg_write(reg)
+#else
+# define reg_read_notify(reg)   do { } while (0)
+# define reg_write_notify(reg)  do { } while (0)
+#endif
+
 #define ARRAY_SIZE(array, type)	(sizeof(array) / sizeof(type))
 
 /* implicit convertion to int */
@@ -91,6 +106,7 @@ __INLINE uint32_t get_reg_value(volatile const uint32_t * reg, uint32_t mask,
     if ((mask == 0x00) || (pos > 31))
         return 0;
 
+    reg_read_notify(reg);
     return (uint32_t) (((*reg) & mask) >> pos);
 }
 
@@ -113,6 +129,7 @@ __INLINE int8_t set_reg_value(volatile uint32_t * reg, uint32_t value,
 
     if (mask == 0xFFFFFFFF) {
         (*reg) = value;
+        reg_write_notify(reg);
     } else {
         tmp = read_reg_value(reg);
         tmp &= ~mask;
@@ -145,6 +162,7 @@ __INLINE int8_t set_reg16_value(volatile uint16_t * reg, uint16_t value,
 
 __INLINE uint32_t read_reg_value(volatile uint32_t * reg)
 {
+    reg_read_notify(reg);
     return (uint32_t) (*reg);
 }
 
@@ -156,6 +174,7 @@ __INLINE uint16_t read_reg16_value(volatile uint16_t * reg)
 __INLINE void write_reg_value(volatile uint32_t * reg, uint32_t value)
 {
     (*reg) = value;
+    reg_write_notify(reg);
 }
 
 __INLINE void write_reg16_value(volatile uint16_t * reg, uint16_t value)
@@ -165,7 +184,9 @@ __INLINE void write_reg16_value(volatile uint16_t * reg, uint16_t value)
 
 __INLINE void set_reg_bits(volatile uint32_t * reg, uint32_t value)
 {
+    reg_read_notify(reg);
     *reg |= value;
+    reg_write_notify(reg);
 }
 
 __INLINE void set_reg16_bits(volatile uint16_t * reg, uint16_t value)
@@ -175,7 +196,9 @@ __INLINE void set_reg16_bits(volatile uint16_t * reg, uint16_t value)
 
 __INLINE void clear_reg_bits(volatile uint32_t * reg, uint32_t value)
 {
+    reg_read_notify(reg);
     *reg &= (uint32_t) ~ (value);
+    reg_write_notify(reg);
 }
 
 __INLINE uint32_t to_big32(uint32_t value)
@@ -106,6 +106,16 @@ typedef struct __packed {
     uint8_t                fill2[SHR_SECTOR_SIZE - sizeof(uint32_t)];
 } t_firmware_state;
 
+/*
+ * When using chunked firmware integrity check, the firmware header padding
+ * (fill field) hosts the chunk digest table: one SHA-256 digest per
+ * fw_sig.chunksize bytes of firmware, the last chunk being potentially
+ * shorter. The header hash is then the hash of the header fields followed
+ * by this table.
+ */
+#define FW_CHUNK_TABLE_MAX_ENTRIES \
+    (sizeof(((t_firmware_state*)0)->fill) / SHA256_DIGEST_SIZE)
+
 typedef struct __packed {
         t_firmware_state fw;
 } shr_vars_t;
@@ -36,7 +36,9 @@
 
 #include "autoconf.h"
 
-#ifdef CONFIG_ARCH_ARMV7M
+#if defined(LOADER_HOST)
+# include "arch/cores/host/types.h"
+#elif defined(CONFIG_ARCH_ARMV7M)
 # include "arch/cores/armv7-m/types.h"
 #else
 # error "architecture not yet supported"
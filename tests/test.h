@@ -0,0 +1,130 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "types.h"
+#include "soc-host.h"
+
+/*
+ * Host tests: make tests
+ *
+ * Each tests/test_<name>.c is a program linked with the host build of the
+ * loader (without main.c), on top of the simulated SoC (soc-host.h). It is
+ * compiled with the loader configuration, plus its own TEST_CFLAGS_<name>
+ * options (see the Makefile). A test returns test_end() from main(): its
+ * exit status is nonzero if any check failed.
+ */
+
+static uint32_t test_checks;
+static uint32_t test_failures;
+
+#define TEST_CHECK(cond) do {                                           \
+    test_checks++;                                                      \
+    if (!(cond)) {                                                      \
+        test_failures++;                                                \
+        fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                __FILE__, __LINE__, #cond);                             \
+    }                                                                   \
+} while (0)
+
+/* same as TEST_CHECK(), also printing the compared values */
+#define TEST_CHECK_EQ(val, expected) do {                               \
+    uint64_t _val = (uint64_t)(val);                                    \
+    uint64_t _exp = (uint64_t)(expected);                               \
+    test_checks++;                                                      \
+    if (_val != _exp) {                                                 \
+        test_failures++;                                                \
+        fprintf(stderr, "%s:%d: check failed: %s == %s "                \
+                "(0x%llx, expected 0x%llx)\n", __FILE__, __LINE__,      \
+                #val, #expected, (unsigned long long)_val,              \
+                (unsigned long long)_exp);                              \
+    }                                                                   \
+} while (0)
+
+/* deterministic pseudo-random numbers (xorshift32), never 0 */
+static uint32_t test_rand_state = 0x2545f491;
+
+static inline uint32_t test_rand(void)
+{
+    test_rand_state ^= test_rand_state << 13;
+    test_rand_state ^= test_rand_state >> 17;
+    test_rand_state ^= test_rand_state << 5;
+    return test_rand_state;
+}
+
+static inline void test_rand_fill(uint8_t *buf, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = test_rand() >> 24;
+    }
+}
+
+/*
+ * Benchmarks: the simulated cycles only advance with the modeled
+ * peripherals operations, the code itself is timed with the host clock.
+ * The figures are host nanoseconds, only meaningful relatively to each
+ * other (same build, same host).
+ */
+static inline uint64_t test_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+#define TEST_BENCH(name, iterations, code) do {                         \
+    uint64_t _start = test_ns();                                        \
+    uint32_t _i;                                                        \
+    for (_i = 0; _i < (iterations); _i++) {                             \
+        code;                                                           \
+    }                                                                   \
+    fprintf(stderr, "[bench] %-40s %10.1f ns\n", (name),                \
+            (double)(test_ns() - _start) / (iterations));               \
+} while (0)
+
+static inline int test_end(const char *name)
+{
+    fprintf(stderr, "[test] %s: %u checks, %u failed\n", name,
+            test_checks, test_failures);
+    return (test_failures != 0) ? 1 : 0;
+}
+
+#endif /* TEST_H */
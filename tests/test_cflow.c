@@ -0,0 +1,155 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Control flow integrity: the boot sequence transitions are accepted and
+ * the out of sequence ones rejected, and the cost of a transition check
+ * with the precomputed tables, compared with the previous replay of the
+ * whole sequence (legacy sum of hash_state(), as in this test build).
+ */
+#include "test.h"
+#include "automaton.h"
+#include "hash.h"
+#include "soc-rng.h"
+
+#if !defined(CONFIG_LOADER_CFLOW_SUM)
+# error "this test requires CONFIG_LOADER_CFLOW_SUM"
+#endif
+
+#define SEQUENCE_LENGTH 14
+
+/* the automaton.c loader_controlflow[] sequence */
+static const loader_state_t sequence[SEQUENCE_LENGTH] = {
+    LOADER_START,
+    LOADER_INIT,
+    LOADER_RDPCHECK,
+    LOADER_DFUWAIT,
+    LOADER_RDPCHECK,
+    LOADER_SELECTBANK,
+    LOADER_RDPCHECK,
+    LOADER_HDRCRC,
+    LOADER_RDPCHECK,
+    LOADER_FWINTEGRITY,
+    LOADER_RDPCHECK,
+    LOADER_FLASHLOCK,
+    LOADER_RDPCHECK,
+    LOADER_BOOTFW,
+};
+
+/* a whole boot: the START step, then each transition update and check */
+static uint32_t boot(void)
+{
+    uint32_t failed = 0;
+    uint32_t i;
+
+    loader_init_controlflow();
+    loader_update_flowstate(sequence[0]);
+    for (i = 1; i < SEQUENCE_LENGTH; i++) {
+        loader_update_flowstate(sequence[i]);
+        if (loader_calculate_flowstate(sequence[i - 1], sequence[i]) != sectrue) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/* the previous implementation: replay of the sequence at each check */
+static uint32_t boot_replay(uint64_t seed)
+{
+    uint64_t current = seed;
+    uint64_t flow;
+    uint32_t failed = 0;
+    uint32_t i;
+    uint32_t j;
+
+    current += hash_state(sequence[0]);
+    for (i = 1; i < SEQUENCE_LENGTH; i++) {
+        current += hash_state(sequence[i]);
+        flow = seed;
+        for (j = 0; j < SEQUENCE_LENGTH - 1; j++) {
+            flow += hash_state(sequence[j]);
+            if (sequence[j] == sequence[i - 1] && sequence[j + 1] == sequence[i]) {
+                break;
+            }
+        }
+        flow += hash_state(sequence[i]);
+        if (flow != current) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+static void test_sequence(void)
+{
+    TEST_CHECK_EQ(boot(), 0);
+    TEST_CHECK_EQ(boot_replay(0x0123456789abcdefULL), 0);
+}
+
+static void test_out_of_sequence(void)
+{
+    loader_init_controlflow();
+    loader_update_flowstate(LOADER_START);
+    loader_update_flowstate(LOADER_INIT);
+    TEST_CHECK(loader_calculate_flowstate(LOADER_START, LOADER_INIT) == sectrue);
+    /* skipped state */
+    loader_update_flowstate(LOADER_DFUWAIT);
+    TEST_CHECK(loader_calculate_flowstate(LOADER_INIT, LOADER_DFUWAIT) == secfalse);
+    TEST_CHECK(loader_calculate_flowstate(LOADER_RDPCHECK, LOADER_DFUWAIT) == secfalse);
+
+    /* state out of the automaton */
+    loader_init_controlflow();
+    loader_update_flowstate(LOADER_START);
+    loader_update_flowstate(0x12345678);
+    TEST_CHECK(loader_calculate_flowstate(LOADER_START, 0x12345678) == secfalse);
+}
+
+static void test_bench(void)
+{
+    volatile uint32_t failed = 0;
+
+    TEST_BENCH("boot checks, sequence replay", 200,
+               failed += boot_replay(test_rand()));
+    TEST_BENCH("boot checks, precomputed tables", 200, failed += boot());
+    TEST_CHECK_EQ(failed, 0);
+}
+
+int main(void)
+{
+    /* the control flow seed (and MAC key) are drawn from the RNG */
+    soc_rng_init();
+    test_sequence();
+    test_out_of_sequence();
+    test_bench();
+    return test_end("cflow");
+}
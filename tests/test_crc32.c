@@ -0,0 +1,191 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * CRC32: equivalence of the slice-by-8 implementation, of the block API and
+ * of the closed form combination with the byte-wise CRC32 it replaced, on
+ * random buffers.
+ */
+#include <string.h>
+
+#include "test.h"
+#include "crc32.h"
+
+static uint32_t ref_tab[256];
+static uint8_t buf[4096 + 8] __attribute__((aligned(8)));
+
+/* the previous implementation: one table lookup per byte */
+static void ref_init(void)
+{
+    uint32_t crc;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xedb88320) : (crc >> 1);
+        }
+        ref_tab[i] = crc;
+    }
+}
+
+static uint32_t ref_crc32(const uint8_t *buf, uint32_t len, uint32_t init)
+{
+    uint32_t crc = init;
+
+    while (len > 0) {
+        crc = ref_tab[(crc ^ *buf) & 0xff] ^ (crc >> 8);
+        buf++;
+        len--;
+    }
+    return crc;
+}
+
+static void test_buffers(void)
+{
+    uint32_t round;
+    uint32_t off;
+    uint32_t len;
+    uint32_t init;
+    uint32_t bad = 0;
+
+    for (round = 0; round < 20000; round++) {
+        off = test_rand() % 8;
+        len = (round < 64) ? round : (test_rand() % (sizeof(buf) - 8));
+        init = (round & 1) ? 0xffffffff : test_rand();
+        test_rand_fill(&buf[off], len);
+        if (crc32(&buf[off], len, init) != ref_crc32(&buf[off], len, init)) {
+            fprintf(stderr, "mismatch: offset %u, length %u, init %08x\n",
+                    off, len, init);
+            bad++;
+        }
+    }
+    TEST_CHECK_EQ(bad, 0);
+    /* check value of the gdb convention (init 0xffffffff, no final xor) */
+    TEST_CHECK_EQ(~crc32((const unsigned char *)"123456789", 9, 0xffffffff),
+                  0xcbf43926);
+}
+
+static void test_blocks(void)
+{
+    crc32_block_t blocks[4];
+    uint32_t round;
+    uint32_t expected;
+    uint32_t total;
+    uint32_t len;
+    uint32_t i;
+    uint32_t bad = 0;
+
+    for (round = 0; round < 2000; round++) {
+        total = 0;
+        for (i = 0; i < 4; i++) {
+            len = test_rand() % 1024;
+            blocks[i].len = len;
+            blocks[i].fill = test_rand();
+            switch (test_rand() % 3) {
+                case 0:
+                    /* constant block */
+                    blocks[i].buf = NULL;
+                    memset(&buf[total], blocks[i].fill, len);
+                    break;
+                case 1:
+                    /* buffer block, with a constant content */
+                    blocks[i].buf = &buf[total];
+                    memset(&buf[total], blocks[i].fill, len);
+                    break;
+                default:
+                    blocks[i].buf = &buf[total];
+                    test_rand_fill(&buf[total], len);
+                    break;
+            }
+            total += len;
+        }
+        expected = ref_crc32(buf, total, 0xffffffff);
+        if (crc32_blocks(blocks, 4, 0xffffffff) != expected) {
+            bad++;
+        }
+    }
+    TEST_CHECK_EQ(bad, 0);
+}
+
+static void test_combine(void)
+{
+    uint32_t round;
+    uint32_t len_a;
+    uint32_t len_b;
+    uint32_t crc_a;
+    uint8_t fill;
+    uint32_t bad = 0;
+
+    for (round = 0; round < 2000; round++) {
+        len_a = test_rand() % 2048;
+        len_b = (round < 64) ? round : (test_rand() % 2048);
+        test_rand_fill(buf, len_a + len_b);
+        crc_a = ref_crc32(buf, len_a, 0xffffffff);
+        /* the CRC32 of the second part alone, with a null init, combined */
+        if (crc32_combine(crc_a, ref_crc32(&buf[len_a], len_b, 0), len_b) !=
+            ref_crc32(buf, len_a + len_b, 0xffffffff)) {
+            fprintf(stderr, "combine mismatch: lengths %u, %u\n", len_a, len_b);
+            bad++;
+        }
+        /* the second part replaced by a constant extension */
+        fill = test_rand();
+        memset(&buf[len_a], fill, len_b);
+        if (crc32_extend_constant(crc_a, fill, len_b) !=
+            ref_crc32(&buf[len_a], len_b, crc_a)) {
+            fprintf(stderr, "extend mismatch: fill %02x, length %u\n", fill, len_b);
+            bad++;
+        }
+    }
+    TEST_CHECK_EQ(bad, 0);
+}
+
+static void test_bench(void)
+{
+    volatile uint32_t crc = 0;
+
+    test_rand_fill(buf, 4096);
+    TEST_BENCH("crc32, byte-wise, 4 KB", 2000, crc = ref_crc32(buf, 4096, crc));
+    TEST_BENCH("crc32, slice-by-8, 4 KB", 2000, crc = crc32(buf, 4096, crc));
+}
+
+int main(void)
+{
+    ref_init();
+    test_buffers();
+    test_blocks();
+    test_combine();
+    test_bench();
+    return test_end("crc32");
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * CRC32 on the CRC calculation unit register model: crc32() (through
+ * crc32_hw() for the big buffers) is the byte-wise software CRC32.
+ */
+#include "test.h"
+#include "crc32.h"
+#include "soc-crc.h"
+
+#if !defined(CONFIG_LOADER_CRC32_HW_MODEL)
+# error "this test requires CONFIG_LOADER_CRC32_HW_MODEL"
+#endif
+
+static uint32_t ref_tab[256];
+static uint8_t buf[4096 + 8] __attribute__((aligned(8)));
+
+static void ref_init(void)
+{
+    uint32_t crc;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xedb88320) : (crc >> 1);
+        }
+        ref_tab[i] = crc;
+    }
+}
+
+static uint32_t ref_crc32(const uint8_t *buf, uint32_t len, uint32_t init)
+{
+    uint32_t crc = init;
+
+    while (len > 0) {
+        crc = ref_tab[(crc ^ *buf) & 0xff] ^ (crc >> 8);
+        buf++;
+        len--;
+    }
+    return crc;
+}
+
+/* the unit alone: 0xffffffff init, reflected words */
+static void test_unit(void)
+{
+    uint32_t nwords;
+
+    for (nwords = 1; nwords <= 64; nwords++) {
+        test_rand_fill(buf, 4 * nwords);
+        soc_crc_reset();
+        TEST_CHECK_EQ(soc_crc_reflected_update((const uint32_t *)buf, nwords),
+                      ref_crc32(buf, 4 * nwords, 0xffffffff));
+    }
+    soc_crc_release();
+}
+
+static void test_buffers(void)
+{
+    uint32_t round;
+    uint32_t off;
+    uint32_t len;
+    uint32_t init;
+    uint32_t bad = 0;
+
+    for (round = 0; round < 5000; round++) {
+        off = test_rand() % 8;
+        /* both sides of the CRC unit threshold (256 bytes) */
+        len = (round & 1) ? (test_rand() % 512) : (test_rand() % (sizeof(buf) - 8));
+        init = (round & 2) ? 0xffffffff : test_rand();
+        test_rand_fill(&buf[off], len);
+        if (crc32(&buf[off], len, init) != ref_crc32(&buf[off], len, init)) {
+            fprintf(stderr, "mismatch: offset %u, length %u, init %08x\n",
+                    off, len, init);
+            bad++;
+        }
+    }
+    TEST_CHECK_EQ(bad, 0);
+}
+
+int main(void)
+{
+    ref_init();
+    test_unit();
+    test_buffers();
+    return test_end("crc32_hw");
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Flash driver on the host flash controller model: erase and programming,
+ * the status register write-1-to-clear flags, and the sector copy.
+ */
+#include "test.h"
+#include "flash.h"
+#include "flash_regs.h"
+
+#define SR_ERRORS   (FLASH_SR_OPERR_Msk | FLASH_SR_WRPERR_Msk | \
+                     FLASH_SR_PGAERR_Msk | FLASH_SR_PGPERR_Msk | \
+                     FLASH_SR_PGSERR_Msk)
+
+static void test_sector_erase(void)
+{
+    uint32_t *sector = (uint32_t *)FLASH_SECTOR_3;
+    uint64_t erases = soc_host_events(HOST_FLASH_SECTOR_ERASE);
+    uint64_t cycles = soc_host_cycles();
+
+    /* a single erase, no retry, taking the 16 KB erase time */
+    sector[0] = 0;
+    sector[4095] = 0;
+    TEST_CHECK_EQ(flash_sector_erase(FLASH_SECTOR_3), 3);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_SECTOR_ERASE) - erases, 1);
+    TEST_CHECK(soc_host_cycles() - cycles >= SOC_HOST_ERASE_16K_CYCLES);
+    TEST_CHECK(soc_host_cycles() - cycles < 2 * SOC_HOST_ERASE_16K_CYCLES);
+    TEST_CHECK_EQ(sector[0], 0xffffffff);
+    TEST_CHECK_EQ(sector[4095], 0xffffffff);
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_SR) & SR_ERRORS, 0);
+}
+
+static void test_program_word(void)
+{
+    uint32_t *word = (uint32_t *)FLASH_SECTOR_1;
+    uint64_t erases = soc_host_events(HOST_FLASH_SECTOR_ERASE);
+
+    /* the first word of a sector erases it first */
+    word[1] = 0;
+    flash_program_word(word, 0x12345678);
+    flash_program_word(word + 2, 0x9abcdef0);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_SECTOR_ERASE) - erases, 1);
+    TEST_CHECK_EQ(word[0], 0x12345678);
+    TEST_CHECK_EQ(word[1], 0xffffffff);
+    TEST_CHECK_EQ(word[2], 0x9abcdef0);
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_SR) & SR_ERRORS, 0);
+}
+
+static void test_status_flags(void)
+{
+    uint64_t erases;
+
+    /* start without operation: programming sequence error */
+    TEST_CHECK_EQ(flash_unlock(), 0);
+    set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_STRT);
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_SR) & SR_ERRORS,
+                  FLASH_SR_PGSERR_Msk);
+    /* writing 0 keeps the flag, writing 1 clears it */
+    write_reg_value(r_CORTEX_M_FLASH_SR, 0);
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_SR) & SR_ERRORS,
+                  FLASH_SR_PGSERR_Msk);
+    write_reg_value(r_CORTEX_M_FLASH_SR, FLASH_SR_PGSERR_Msk);
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_SR) & SR_ERRORS, 0);
+
+    /* a pending error fails the next erase once, and is cleared */
+    set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_STRT);
+    erases = soc_host_events(HOST_FLASH_SECTOR_ERASE);
+    TEST_CHECK_EQ(flash_sector_erase(FLASH_SECTOR_2), 0xff);
+    TEST_CHECK_EQ(flash_sector_erase(FLASH_SECTOR_2), 2);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_SECTOR_ERASE) - erases, 2);
+    flash_lock();
+}
+
+static uint32_t progress_calls;
+static uint32_t progress_errors;
+
+/* called once per block, in order */
+static void test_progress(uint32_t done, uint32_t total)
+{
+    progress_calls++;
+    progress_errors += (done != progress_calls * 1024) || (total != 0x4000);
+}
+
+static void test_copy_sector(void)
+{
+    uint8_t block[1024];
+    uint32_t *src = (uint32_t *)FLASH_SECTOR_2;
+    uint32_t *dest = (uint32_t *)FLASH_SECTOR_3;
+    uint32_t i;
+    uint32_t diff = 0;
+
+    /* 16 KB source, each block being different */
+    TEST_CHECK_EQ(flash_sector_erase(FLASH_SECTOR_2), 2);
+    for (i = 0; i < 16 * sizeof(block); i++) {
+        block[i % sizeof(block)] = (uint8_t)((i * 7) + (i / sizeof(block)));
+        if ((i % sizeof(block)) == (sizeof(block) - 1)) {
+            TEST_CHECK_EQ(flash_program_buffer(FLASH_SECTOR_2 + i + 1 - sizeof(block),
+                                               block, sizeof(block)), 0);
+        }
+    }
+    dest[0] = 0;
+    dest[4095] = 0;
+    progress_calls = 0;
+    progress_errors = 0;
+    TEST_CHECK_EQ(flash_copy_sector(FLASH_SECTOR_3, FLASH_SECTOR_2, test_progress), 0);
+    for (i = 0; i < 4096; i++) {
+        diff += (dest[i] != src[i]);
+    }
+    TEST_CHECK_EQ(diff, 0);
+    TEST_CHECK_EQ(progress_calls, 16);
+    TEST_CHECK_EQ(progress_errors, 0);
+    /* without progress callback */
+    TEST_CHECK_EQ(flash_copy_sector(FLASH_SECTOR_1, FLASH_SECTOR_2, NULL), 0);
+    TEST_CHECK_EQ(((uint32_t *)FLASH_SECTOR_1)[4095], src[4095]);
+}
+
+static void test_copy_sector_errors(void)
+{
+    uint64_t erases = soc_host_events(HOST_FLASH_SECTOR_ERASE);
+
+    /* sectors of different sizes (16 KB and 64 KB), not sectors starts */
+    progress_calls = 0;
+    TEST_CHECK_EQ(flash_copy_sector(FLASH_SECTOR_4, FLASH_SECTOR_2, test_progress), 1);
+    TEST_CHECK_EQ(flash_copy_sector(FLASH_SECTOR_3, FLASH_SECTOR_4, test_progress), 1);
+    TEST_CHECK_EQ(flash_copy_sector(FLASH_SECTOR_3 + 4, FLASH_SECTOR_2, test_progress), 1);
+    TEST_CHECK_EQ(flash_copy_sector(FLASH_SECTOR_3, FLASH_SECTOR_3, test_progress), 1);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_SECTOR_ERASE) - erases, 0);
+
+    /* a word of the sixth block keeps a bit erased: verification error */
+    soc_host_flash_fault(FLASH_SECTOR_3 + 0x1404, 0x10);
+    TEST_CHECK_EQ(flash_copy_sector(FLASH_SECTOR_3, FLASH_SECTOR_2, test_progress), 4);
+    soc_host_flash_fault(0, 0);
+    TEST_CHECK_EQ(progress_calls, 5);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_SECTOR_ERASE) - erases, 1);
+}
+
+int main(void)
+{
+    test_sector_erase();
+    test_program_word();
+    test_status_flags();
+    test_copy_sector();
+    test_copy_sector_errors();
+    return test_end("flash");
+}
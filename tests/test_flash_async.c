@@ -0,0 +1,235 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Asynchronous flash operations on the host flash controller model: the
+ * queue is consumed by the flash interrupt, the failures being reported by
+ * the callbacks and counted by flash_async_wait().
+ */
+#include "test.h"
+#include "flash.h"
+#include "flash_regs.h"
+#include "m4-cpu.h"
+
+static uint32_t cb_calls;
+static physaddr_t cb_addr;
+static int cb_status;
+
+static void test_cb(physaddr_t addr, int status)
+{
+    cb_calls++;
+    cb_addr = addr;
+    cb_status = status;
+}
+
+static void test_cb_reset(void)
+{
+    cb_calls = 0;
+    cb_addr = 0;
+    cb_status = -1;
+}
+
+static void test_erase_program(void)
+{
+    static const uint32_t data[64] = { 0x12345678, 0x9abcdef0, 0, 0xffffffff };
+    flash_op_t erase = { FLASH_OP_SECTOR_ERASE, FLASH_SECTOR_2, NULL, 0, test_cb };
+    flash_op_t program = { FLASH_OP_PROGRAM, FLASH_SECTOR_2 + 0x100, data, 64, test_cb };
+    uint32_t *sector = (uint32_t *)FLASH_SECTOR_2;
+    uint64_t erases = soc_host_events(HOST_FLASH_SECTOR_ERASE);
+    uint64_t words = soc_host_events(HOST_FLASH_PROGRAMMED_WORD);
+    uint64_t irqs = soc_host_events(HOST_FLASH_IRQ);
+    uint32_t i;
+
+    /* the program operation is issued by the interrupt ending the erase */
+    test_cb_reset();
+    sector[0] = 0;
+    sector[4095] = 0;
+    TEST_CHECK_EQ(flash_async_submit(&erase), 0);
+    TEST_CHECK_EQ(flash_async_submit(&program), 0);
+    TEST_CHECK_EQ(flash_async_pending(), 2);
+    TEST_CHECK_EQ(flash_async_wait(), 0);
+    TEST_CHECK_EQ(flash_async_pending(), 0);
+    TEST_CHECK_EQ(cb_calls, 2);
+    TEST_CHECK_EQ(cb_addr, program.addr);
+    TEST_CHECK_EQ(cb_status, 0);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_SECTOR_ERASE) - erases, 1);
+    TEST_CHECK_EQ(sector[0], 0xffffffff);
+    TEST_CHECK_EQ(sector[4095], 0xffffffff);
+    for (i = 0; i < 64; i++) {
+        TEST_CHECK_EQ(sector[0x40 + i], data[i]);
+    }
+    /* word programming: one interrupt per word, and one for the erase */
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_PROGRAMMED_WORD) - words, 64);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_IRQ) - irqs, 65);
+    /* the controller is left idle, without its interrupts */
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_CR) &
+                  (FLASH_CR_PG_Msk | FLASH_CR_SER_Msk | FLASH_CR_EOPIE_Msk |
+                   FLASH_CR_ERRIE_Msk), 0);
+}
+
+static void test_error(void)
+{
+    static const uint32_t data[4] = { 1, 2, 3, 4 };
+    flash_op_t program = { FLASH_OP_PROGRAM, FLASH_SECTOR_2 + 0x400, data, 4, test_cb };
+    uint32_t *word = (uint32_t *)program.addr;
+    uint64_t words = soc_host_events(HOST_FLASH_PROGRAMMED_WORD);
+
+    /* a start without operation leaves a programming sequence error */
+    TEST_CHECK_EQ(flash_unlock(), 0);
+    set_reg(r_CORTEX_M_FLASH_CR, 1, FLASH_CR_STRT);
+    TEST_CHECK(read_reg_value(r_CORTEX_M_FLASH_SR) & FLASH_SR_PGSERR_Msk);
+
+    /* the pending error fails the next operation, notified and counted */
+    test_cb_reset();
+    TEST_CHECK_EQ(flash_async_submit(&program), 0);
+    TEST_CHECK_EQ(cb_calls, 1);
+    TEST_CHECK_EQ(cb_addr, program.addr);
+    TEST_CHECK_EQ(cb_status, 1);
+    TEST_CHECK_EQ(flash_async_pending(), 0);
+    TEST_CHECK_EQ(flash_async_wait(), 1);
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_SR) & FLASH_SR_PGSERR_Msk, 0);
+
+    /* the failures are counted once, the next operations succeed */
+    test_cb_reset();
+    TEST_CHECK_EQ(flash_async_submit(&program), 0);
+    TEST_CHECK_EQ(flash_async_wait(), 0);
+    TEST_CHECK_EQ(cb_calls, 1);
+    TEST_CHECK_EQ(cb_status, 0);
+    TEST_CHECK_EQ(word[0], 1);
+    TEST_CHECK_EQ(word[3], 4);
+    /* 1 word refused, then 4 words */
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_PROGRAMMED_WORD) - words, 5);
+}
+
+/* write protect (or unprotect) a bank 1 sector through the option bytes */
+static void test_write_protect(uint8_t sector, bool protect)
+{
+    uint32_t nwrp = (uint32_t)1 << (FLASH_OPTCR_nWRP_Pos + sector);
+
+    write_reg_value(r_CORTEX_M_FLASH_OPTKEYR, OPTKEY1);
+    write_reg_value(r_CORTEX_M_FLASH_OPTKEYR, OPTKEY2);
+    if (protect) {
+        clear_reg_bits(r_CORTEX_M_FLASH_OPTCR, nwrp);
+    } else {
+        set_reg_bits(r_CORTEX_M_FLASH_OPTCR, nwrp);
+    }
+    set_reg_bits(r_CORTEX_M_FLASH_OPTCR, FLASH_OPTCR_OPTLOCK_Msk);
+}
+
+static void test_error_next_word(void)
+{
+    static const uint32_t data[4] = { 5, 6, 7, 8 };
+    /* the 2 last words of sector 2, then the 2 first ones of sector 3 */
+    flash_op_t program = { FLASH_OP_PROGRAM, FLASH_SECTOR_3 - 8, data, 4, test_cb };
+    flash_op_t next = { FLASH_OP_PROGRAM, FLASH_SECTOR_2 + 0x800, data, 4, test_cb };
+    uint32_t *word = (uint32_t *)program.addr;
+    uint64_t words = soc_host_events(HOST_FLASH_PROGRAMMED_WORD);
+
+    /* the third word is refused (WRPERR), without end of operation */
+    test_write_protect(3, true);
+    test_cb_reset();
+    TEST_CHECK_EQ(flash_async_submit(&program), 0);
+    TEST_CHECK_EQ(flash_async_submit(&next), 0);
+    TEST_CHECK_EQ(flash_async_wait(), 1);
+    test_write_protect(3, false);
+    TEST_CHECK_EQ(flash_async_pending(), 0);
+    TEST_CHECK_EQ(word[0], 5);
+    TEST_CHECK_EQ(word[1], 6);
+    TEST_CHECK_EQ(read_reg_value(r_CORTEX_M_FLASH_SR) & FLASH_SR_WRPERR_Msk, 0);
+
+    /* the next operation runs, the last callback being its success */
+    TEST_CHECK_EQ(cb_calls, 2);
+    TEST_CHECK_EQ(cb_addr, next.addr);
+    TEST_CHECK_EQ(cb_status, 0);
+    TEST_CHECK_EQ(((uint32_t *)next.addr)[3], 8);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_PROGRAMMED_WORD) - words, 6);
+}
+
+static void test_invalid(void)
+{
+    static const uint32_t data[4] = { 0 };
+    flash_op_t op = { FLASH_OP_PROGRAM, 0, data, 4, test_cb };
+    uint64_t erases = soc_host_events(HOST_FLASH_SECTOR_ERASE);
+    uint64_t words = soc_host_events(HOST_FLASH_PROGRAMMED_WORD);
+
+    test_cb_reset();
+    TEST_CHECK_EQ(flash_async_submit(NULL), 2);
+    /* out of the flash memory, at the start or at the end */
+    op.addr = 0x20000000;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    op.addr = FLASH_SECTOR_0 - 4;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    op.addr = FLASH_BANK2_END - 7;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    op.addr = FLASH_BANK2_END - 15;
+    op.len = 0x40000000;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    /* misaligned, empty or without data */
+    op.addr = FLASH_SECTOR_2 + 2;
+    op.len = 4;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    op.addr = FLASH_SECTOR_2;
+    op.len = 0;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    op.len = 4;
+    op.data = NULL;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    /* erase out of the flash memory, or of an unknown bank */
+    op.type = FLASH_OP_SECTOR_ERASE;
+    op.addr = 0x20000000;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    op.type = FLASH_OP_BANK_ERASE;
+    op.addr = 2;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+    op.type = (flash_op_type_t)3;
+    op.addr = FLASH_SECTOR_2;
+    TEST_CHECK_EQ(flash_async_submit(&op), 2);
+
+    /* nothing queued, started nor notified */
+    TEST_CHECK_EQ(flash_async_pending(), 0);
+    TEST_CHECK_EQ(flash_async_wait(), 0);
+    TEST_CHECK_EQ(cb_calls, 0);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_SECTOR_ERASE) - erases, 0);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_PROGRAMMED_WORD) - words, 0);
+}
+
+int main(void)
+{
+    enable_irq();
+    test_erase_program();
+    test_error();
+    test_error_next_word();
+    test_invalid();
+    flash_lock();
+    return test_end("flash_async");
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Buffered flash programming on the host flash controller model, for each
+ * supply voltage range: the parallelism selection, the unaligned head and
+ * tail, and the destination bounds.
+ */
+#include "test.h"
+#include "flash.h"
+#include "flash_regs.h"
+
+/* parallelism expected for the configured supply voltage range */
+#if defined(CONFIG_LOADER_FLASH_VRANGE_1V8)
+# define TEST_PSIZE 0
+#elif defined(CONFIG_LOADER_FLASH_VRANGE_2V1)
+# define TEST_PSIZE 1
+#elif defined(CONFIG_LOADER_FLASH_VRANGE_VPP)
+# define TEST_PSIZE 3
+#else
+# define TEST_PSIZE 2
+#endif
+
+#ifdef FLASH_BANK2_END
+# define TEST_FLASH_END FLASH_BANK2_END
+#else
+# define TEST_FLASH_END FLASH_SECTOR_11_END
+#endif
+
+#define TEST_SECTOR FLASH_SECTOR_5
+
+static uint8_t data[256];
+
+/*
+ * word (x32) writes of a programming with the largest naturally aligned
+ * elements: only these ones are seen by the flash model
+ */
+static uint64_t test_words(physaddr_t dst, uint32_t len)
+{
+    physaddr_t end = dst + len;
+    uint64_t words = 0;
+    int psize;
+
+    while (dst < end) {
+        for (psize = TEST_PSIZE; psize > 0; psize--) {
+            if (!(dst & ((1U << psize) - 1)) && ((end - dst) >= (1U << psize))) {
+                break;
+            }
+        }
+        words += (psize == 2);
+        dst += 1U << psize;
+    }
+    return words;
+}
+
+/* program len bytes at dst, checking the content and the bytes around */
+static void test_program(physaddr_t dst, uint32_t len)
+{
+    uint8_t *flash = (uint8_t *)dst;
+    uint8_t before = flash[-1];
+    uint8_t after = flash[len];
+    uint64_t words = soc_host_events(HOST_FLASH_PROGRAMMED_WORD);
+    uint32_t i;
+    uint32_t diff = 0;
+
+    TEST_CHECK_EQ(flash_program_buffer(dst, data, len), 0);
+    for (i = 0; i < len; i++) {
+        diff += (flash[i] != data[i]);
+    }
+    TEST_CHECK_EQ(diff, 0);
+    TEST_CHECK_EQ(flash[-1], before);
+    TEST_CHECK_EQ(flash[len], after);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_PROGRAMMED_WORD) - words,
+                  test_words(dst, len));
+    TEST_CHECK_EQ(get_reg(r_CORTEX_M_FLASH_CR, FLASH_CR_PG), 0);
+}
+
+static void test_erase_psize(void)
+{
+    /* the erase parallelism is the widest allowed one */
+    TEST_CHECK_EQ(flash_sector_erase(TEST_SECTOR), 5);
+    TEST_CHECK_EQ(get_reg(r_CORTEX_M_FLASH_CR, FLASH_CR_PSIZE), TEST_PSIZE);
+}
+
+static void test_aligned(void)
+{
+    /* the body only, with the widest parallelism */
+    test_program(TEST_SECTOR + 0x100, 8);
+    test_program(TEST_SECTOR + 0x200, 256);
+    TEST_CHECK_EQ(*(uint32_t *)(TEST_SECTOR + 0x100), 0x04030201);
+    TEST_CHECK_EQ(*(uint32_t *)(TEST_SECTOR + 0x104), 0x08070605);
+}
+
+static void test_unaligned(void)
+{
+    uint32_t offset;
+    uint32_t len;
+    physaddr_t dst = TEST_SECTOR + 0x1000;
+
+    /* odd destination: byte, half-word (and word) head */
+    test_program(TEST_SECTOR + 0x401, 64);
+    /* odd length: sub-word tail */
+    test_program(TEST_SECTOR + 0x500, 7);
+    test_program(TEST_SECTOR + 0x510, 13);
+    /* odd destination and length, shorter than an element */
+    test_program(TEST_SECTOR + 0x603, 1);
+    test_program(TEST_SECTOR + 0x611, 2);
+    test_program(TEST_SECTOR + 0x625, 3);
+    /* every head and tail alignment */
+    for (offset = 0; offset < 8; offset++) {
+        for (len = 1; len < 24; len++) {
+            test_program(dst + offset, len);
+            dst += 0x20;
+        }
+    }
+}
+
+static void test_neighbours(void)
+{
+    uint8_t *flash = (uint8_t *)(TEST_SECTOR + 0x3000);
+
+    /* consecutive bytes, each one programmed alone */
+    test_program(TEST_SECTOR + 0x3001, 1);
+    test_program(TEST_SECTOR + 0x3000, 1);
+    test_program(TEST_SECTOR + 0x3002, 1);
+    TEST_CHECK_EQ(flash[0], data[0]);
+    TEST_CHECK_EQ(flash[1], data[0]);
+    TEST_CHECK_EQ(flash[2], data[0]);
+    TEST_CHECK_EQ(flash[3], 0xff);
+    /* a buffer between programmed bytes */
+    test_program(TEST_SECTOR + 0x3003, 5);
+    test_program(TEST_SECTOR + 0x3009, 2);
+    test_program(TEST_SECTOR + 0x3008, 1);
+    TEST_CHECK_EQ(flash[7], data[4]);
+    TEST_CHECK_EQ(flash[8], data[0]);
+    TEST_CHECK_EQ(flash[9], data[0]);
+    TEST_CHECK_EQ(flash[11], 0xff);
+}
+
+static void test_bounds(void)
+{
+    uint64_t words = soc_host_events(HOST_FLASH_PROGRAMMED_WORD);
+
+    TEST_CHECK_EQ(flash_program_buffer(TEST_SECTOR, data, 0), 0);
+    TEST_CHECK_EQ(flash_program_buffer(TEST_SECTOR, NULL, 4), 1);
+    TEST_CHECK_EQ(flash_program_buffer(FLASH_SECTOR_0 - 4, data, 8), 1);
+    TEST_CHECK_EQ(flash_program_buffer(TEST_FLASH_END - 3, data, 8), 1);
+    /* a length wrapping around back into the flash */
+    TEST_CHECK_EQ(flash_program_buffer(TEST_SECTOR + 0x4000, data,
+                                       0xffffff00), 1);
+    TEST_CHECK_EQ(flash_program_buffer(TEST_SECTOR, data,
+                                       0xffffffff - TEST_SECTOR + 2), 1);
+    TEST_CHECK_EQ(soc_host_events(HOST_FLASH_PROGRAMMED_WORD) - words, 0);
+}
+
+int main(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i + 1);
+    }
+    test_erase_psize();
+    test_aligned();
+    test_unaligned();
+    test_neighbours();
+    test_bounds();
+    flash_lock();
+    return test_end("flash_buffer");
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Flash sectors lookup, for each flash layout (1 MB single bank, 1 MB dual
+ * bank, 2 MB, see tests/conf): the sectors boundaries, the bank 2 start and
+ * the addresses out of the flash. The expected layouts are the reference
+ * manual ones (STM-RM0090, tables 5 to 7), not the flash.h definitions.
+ * flash.c is included for its static functions.
+ */
+#include "test.h"
+#include "flash.c"
+
+#if CONFIG_USR_DRV_FLASH_1M && CONFIG_USR_DRV_FLASH_DUAL_BANK
+# define TEST_BANK_SECTORS  8
+# define TEST_BANK2_BASE    0x08080000
+#elif CONFIG_USR_DRV_FLASH_1M
+# define TEST_BANK_SECTORS  12
+#else
+# define TEST_BANK_SECTORS  12
+# define TEST_BANK2_BASE    0x08100000
+#endif
+
+/* size of the sectors found, by sector number */
+static uint32_t test_sizes[32];
+
+/* sector i of a bank: 4 x 16 KB, 1 x 64 KB, then 128 KB */
+static uint32_t test_sector_size(uint32_t i)
+{
+    return (i < 4) ? 0x4000 : ((i == 4) ? 0x10000 : 0x20000);
+}
+
+/* check the sectors of a bank, returning its end (excluded) */
+static physaddr_t test_bank(physaddr_t base, uint8_t first_num, uint8_t first_snb)
+{
+    const flash_sector_t *sector;
+    uint32_t size;
+    uint32_t i;
+
+    for (i = 0; i < TEST_BANK_SECTORS; i++) {
+        size = test_sector_size(i);
+        test_sizes[first_num + i] = size;
+        sector = flash_sector_lookup(base);
+        TEST_CHECK(sector != NULL);
+        if (sector == NULL) {
+            return base;
+        }
+        TEST_CHECK_EQ(sector->base, base);
+        TEST_CHECK_EQ(sector->size, size);
+        TEST_CHECK_EQ(sector->num, first_num + i);
+        TEST_CHECK_EQ(sector->snb, first_snb + i);
+        /* first and last bytes */
+        TEST_CHECK(flash_sector_lookup(base + size - 1) == sector);
+        TEST_CHECK_EQ(flash_select_sector(base), first_snb + i);
+        TEST_CHECK_EQ(flash_select_sector(base + size - 1), first_snb + i);
+        TEST_CHECK(is_sector_start(base));
+        TEST_CHECK(!is_sector_start(base + 4));
+        TEST_CHECK(!is_sector_start(base + size - 1));
+        base += size;
+    }
+    return base;
+}
+
+static void test_layout(void)
+{
+    physaddr_t end;
+    uint32_t sectors = TEST_BANK_SECTORS;
+
+    end = test_bank(0x08000000, 0, 0x00);
+#ifdef TEST_BANK2_BASE
+    /* the bank 2 follows the bank 1, its numbering starting with 12 */
+    TEST_CHECK_EQ(end, TEST_BANK2_BASE);
+    TEST_CHECK_EQ(flash_sector_lookup(end - 1)->num, TEST_BANK_SECTORS - 1);
+    TEST_CHECK_EQ(flash_sector_lookup(end)->num, 12);
+    end = test_bank(TEST_BANK2_BASE, 12, 0x10);
+    sectors *= 2;
+#endif
+    TEST_CHECK_EQ(FLASH_SECTORS_NUM, sectors);
+
+    /* out of the flash */
+    TEST_CHECK(flash_sector_lookup(0x08000000 - 1) == NULL);
+    TEST_CHECK(flash_sector_lookup(end) == NULL);
+    TEST_CHECK(flash_sector_lookup(0) == NULL);
+    TEST_CHECK(flash_sector_lookup(0xffffffff) == NULL);
+    TEST_CHECK(!is_sector_start(end));
+}
+
+static void test_sizes_by_number(void)
+{
+    uint32_t num;
+
+    /* 0 for the sector numbers not in the layout */
+    for (num = 0; num < 32; num++) {
+        TEST_CHECK_EQ(flash_sector_size(num), test_sizes[num]);
+    }
+    TEST_CHECK_EQ(flash_sector_size(0xff), 0);
+}
+
+int main(void)
+{
+    test_layout();
+    test_sizes_by_number();
+    return test_end("flash_geometry");
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * Loader printf numbers formatting: equivalence of the division-free
+ * format_number() with the division based digits generation it replaced,
+ * and their cost. debug.c is included, to test its static functions (with
+ * the loader libc declarations, hence no C library string functions).
+ */
+#include "test.h"
+#include "debug.c"
+
+/* the previous ring_buffer_write_number() digits, written in str */
+static uint8_t format_number_div(char *str, uint64_t value, uint8_t base)
+{
+    uint8_t number[64] = { 0 };
+    int     index = 0;
+    uint8_t len;
+
+    for (; (value / base) != 0; value /= base) {
+        number[index++] = value % base;
+    }
+    number[index++] = value % base;
+    index--;
+    for (len = 0; index >= 0; index--) {
+        str[len++] = number_digits[number[index]];
+    }
+    return len;
+}
+
+static uint32_t format_mismatches;
+
+static bool digits_equal(const char *a, const char *b, uint8_t len)
+{
+    uint8_t i;
+
+    for (i = 0; i < len; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_number(uint64_t value, uint8_t base)
+{
+    fs_number_t num;
+    char expected[64];
+    uint8_t len;
+    uint8_t expected_len;
+
+    len = format_number(&num, value, base);
+    expected_len = format_number_div(expected, value, base);
+    if (len != expected_len || len != num.len ||
+        !digits_equal(&num.digits[NUMBER_MAX_DIGITS - len], expected, len)) {
+        if (format_mismatches++ < 16) {
+            fprintf(stderr, "format_number(0x%llx, %u): %.*s, expected %.*s\n",
+                    (unsigned long long)value, base, len,
+                    &num.digits[NUMBER_MAX_DIGITS - len], expected_len, expected);
+        }
+    }
+}
+
+static void check_number_bases(uint64_t value)
+{
+    check_number(value, 10);
+    check_number(value, 16);
+    check_number(value, 8);
+}
+
+static void test_small_values(void)
+{
+    uint32_t value;
+
+    format_mismatches = 0;
+    for (value = 0; value < (1 << 22); value++) {
+        check_number_bases(value);
+    }
+    TEST_CHECK_EQ(format_mismatches, 0);
+}
+
+/* around the powers of 2 and of 10, and the 32 bits reciprocal limits */
+static void test_edge_values(void)
+{
+    uint64_t power;
+    uint32_t i;
+    int32_t delta;
+
+    format_mismatches = 0;
+    for (i = 0; i < 64; i++) {
+        power = (uint64_t)1 << i;
+        for (delta = -1024; delta <= 1024; delta++) {
+            check_number_bases(power + delta);
+        }
+    }
+    for (i = 0, power = 1; i < 20; i++, power *= 10) {
+        for (delta = -1024; delta <= 1024; delta++) {
+            check_number_bases(power + delta);
+            check_number_bases(power * 2 + delta);
+            check_number_bases(power * 5 + delta);
+        }
+    }
+    /* 2^64 - 1024 .. 2^64 - 1, the sign-extended negative %d values */
+    for (delta = -1024; delta < 0; delta++) {
+        check_number_bases((uint64_t)(int64_t)delta);
+    }
+    TEST_CHECK_EQ(format_mismatches, 0);
+}
+
+/* random values, of random magnitude */
+static void test_random_values(void)
+{
+    uint64_t value;
+    uint32_t i;
+
+    format_mismatches = 0;
+    for (i = 0; i < 1000000; i++) {
+        value = ((uint64_t)test_rand() << 32) | test_rand();
+        check_number_bases(value >> (test_rand() & 0x3f));
+    }
+    TEST_CHECK_EQ(format_mismatches, 0);
+}
+
+static void test_bench(void)
+{
+    fs_number_t num;
+    char str[64];
+
+    TEST_BENCH("%u, divisions", 100000,
+               format_number_div(str, test_rand(), 10));
+    TEST_BENCH("%u, division-free", 100000,
+               format_number(&num, test_rand(), 10));
+    TEST_BENCH("%x, divisions", 100000,
+               format_number_div(str, test_rand(), 16));
+    TEST_BENCH("%x, division-free", 100000,
+               format_number(&num, test_rand(), 16));
+    TEST_BENCH("%llu, divisions", 100000,
+               format_number_div(str, ((uint64_t)test_rand() << 32) | test_rand(), 10));
+    TEST_BENCH("%llu, division-free", 100000,
+               format_number(&num, ((uint64_t)test_rand() << 32) | test_rand(), 10));
+}
+
+int main(void)
+{
+    test_small_values();
+    test_edge_values();
+    test_random_values();
+    test_bench();
+    return test_end("format");
+}
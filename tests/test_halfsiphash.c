@@ -0,0 +1,164 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * HalfSipHash-2-4: reference implementation test vectors (64 bits output,
+ * key 00 01 .. 07, messages 00 01 .. of 0 to 63 bytes), and the cost of a
+ * control flow step, compared with the legacy SHA-256 based state hash.
+ */
+#include "test.h"
+#include "halfsiphash.h"
+#include "hash.h"
+
+#define VECTORS 64
+
+/* vectors_hsip64[] of the HalfSipHash reference implementation */
+static const uint8_t vectors[VECTORS][8] = {
+    { 0x21, 0x8d, 0x1f, 0x59, 0xb9, 0xb8, 0x3c, 0xc8 },
+    { 0xbe, 0x55, 0x24, 0x12, 0xf8, 0x38, 0x73, 0x15 },
+    { 0x06, 0x4f, 0x39, 0xef, 0x7c, 0x50, 0xeb, 0x57 },
+    { 0xce, 0x0f, 0x1a, 0x45, 0xf7, 0x06, 0x06, 0x79 },
+    { 0xd5, 0xe7, 0x8a, 0x17, 0x5b, 0xe5, 0x2e, 0xa1 },
+    { 0xcb, 0x9d, 0x7c, 0x3f, 0x2f, 0x3d, 0xb5, 0x80 },
+    { 0xce, 0x3e, 0x91, 0x35, 0x8a, 0xa2, 0xbc, 0x25 },
+    { 0xff, 0x20, 0x27, 0x28, 0xb0, 0x7b, 0xc6, 0x84 },
+    { 0xed, 0xfe, 0xe8, 0x20, 0xbc, 0xe4, 0x85, 0x8c },
+    { 0x5b, 0x51, 0xcc, 0xcc, 0x13, 0x88, 0x83, 0x07 },
+    { 0x95, 0xb0, 0x46, 0x9f, 0x06, 0xa6, 0xf2, 0xee },
+    { 0xae, 0x26, 0x33, 0x39, 0x94, 0xdd, 0xcd, 0x48 },
+    { 0x7b, 0xc7, 0x1f, 0x9f, 0xae, 0xf5, 0xc7, 0x99 },
+    { 0x5a, 0x23, 0x52, 0xd7, 0x5a, 0x0c, 0x37, 0x44 },
+    { 0x3b, 0xb1, 0xa8, 0x70, 0xea, 0xe8, 0xe6, 0x58 },
+    { 0x21, 0x7d, 0x0b, 0xcb, 0x4e, 0x81, 0xc9, 0x02 },
+    { 0x73, 0x36, 0xaa, 0xd2, 0x5f, 0x7b, 0xf3, 0xb5 },
+    { 0x37, 0xad, 0xc0, 0x64, 0x1c, 0x4c, 0x4f, 0x6a },
+    { 0xc9, 0xb2, 0xdb, 0x2b, 0x9a, 0x3e, 0x42, 0xf9 },
+    { 0xf9, 0x10, 0xe4, 0x80, 0x20, 0xab, 0x36, 0x3c },
+    { 0x1b, 0xf5, 0x2b, 0x0a, 0x6f, 0xee, 0xa7, 0xdb },
+    { 0x00, 0x74, 0x1d, 0xc2, 0x69, 0xe8, 0xb3, 0xef },
+    { 0xe2, 0x01, 0x03, 0xfa, 0x1b, 0xa7, 0x76, 0xef },
+    { 0x4c, 0x22, 0x10, 0xe5, 0x4b, 0x68, 0x1d, 0x73 },
+    { 0x70, 0x74, 0x10, 0x45, 0xae, 0x3f, 0xa6, 0xf1 },
+    { 0x0c, 0x86, 0x40, 0x37, 0x39, 0x71, 0x40, 0x38 },
+    { 0x0d, 0x89, 0x9e, 0xd8, 0x11, 0x29, 0x23, 0xf0 },
+    { 0x22, 0x6b, 0xf5, 0xfa, 0xb8, 0x1e, 0xe1, 0xb8 },
+    { 0x2d, 0x92, 0x5f, 0xfb, 0x1e, 0x00, 0x16, 0xb5 },
+    { 0x36, 0x19, 0x58, 0xd5, 0x2c, 0xee, 0x10, 0xf1 },
+    { 0x29, 0x1a, 0xaf, 0x86, 0x48, 0x98, 0x17, 0x9d },
+    { 0x86, 0x3c, 0x7f, 0x15, 0x5c, 0x34, 0x11, 0x7c },
+    { 0x28, 0x70, 0x9d, 0x46, 0xd8, 0x11, 0x62, 0x6c },
+    { 0x24, 0x84, 0x77, 0x68, 0x1d, 0x28, 0xf8, 0x9c },
+    { 0x83, 0x24, 0xe4, 0xd7, 0x52, 0x8f, 0x98, 0x30 },
+    { 0xf9, 0xef, 0xd4, 0xe1, 0x3a, 0xea, 0x6b, 0xd8 },
+    { 0x86, 0xd6, 0x7a, 0x40, 0xec, 0x42, 0x76, 0xdc },
+    { 0x3f, 0x62, 0x92, 0xec, 0xcc, 0xa9, 0x7e, 0x35 },
+    { 0xcb, 0xd9, 0x2e, 0xe7, 0x24, 0xd4, 0x21, 0x09 },
+    { 0x36, 0x8d, 0xf6, 0x80, 0x8d, 0x40, 0x3d, 0x79 },
+    { 0x5b, 0x38, 0xc8, 0x1c, 0x67, 0xc8, 0xae, 0x4c },
+    { 0x95, 0xab, 0x71, 0x89, 0xd4, 0x39, 0xac, 0xb3 },
+    { 0xa9, 0x1a, 0x52, 0xc0, 0x25, 0x32, 0x70, 0x24 },
+    { 0x5b, 0x00, 0x87, 0xc6, 0x95, 0x28, 0xac, 0xea },
+    { 0x1e, 0x30, 0xf3, 0xad, 0x27, 0xdc, 0xb1, 0x5a },
+    { 0x69, 0x7f, 0x5c, 0x9a, 0x90, 0x32, 0x4e, 0xd4 },
+    { 0x49, 0x5c, 0x0f, 0x99, 0x55, 0x57, 0xdc, 0x38 },
+    { 0x94, 0x27, 0x20, 0x2a, 0x3c, 0x29, 0xf9, 0x4d },
+    { 0xa9, 0xea, 0xa8, 0xc0, 0x4b, 0xa9, 0x3e, 0x3e },
+    { 0xee, 0xa4, 0xc1, 0x73, 0x7d, 0x01, 0x12, 0x18 },
+    { 0x91, 0x2d, 0x56, 0x8f, 0xd8, 0xf6, 0x5a, 0x49 },
+    { 0x56, 0x91, 0x95, 0x96, 0xb0, 0xff, 0x5c, 0x97 },
+    { 0x02, 0x44, 0x5a, 0x79, 0x98, 0xf5, 0x50, 0xe1 },
+    { 0x86, 0xec, 0x46, 0x6c, 0xe7, 0x1d, 0x1f, 0xb2 },
+    { 0x35, 0x95, 0x69, 0xe7, 0xd2, 0x89, 0xe3, 0xbc },
+    { 0x87, 0x1b, 0x05, 0xca, 0x62, 0xbb, 0x7c, 0x96 },
+    { 0xa1, 0xa4, 0x92, 0xf9, 0x42, 0xf1, 0x5f, 0x1d },
+    { 0x12, 0xec, 0x26, 0x7f, 0xf6, 0x09, 0x5b, 0x6e },
+    { 0x5d, 0x1b, 0x5e, 0xa1, 0xb2, 0x31, 0xd8, 0x9d },
+    { 0xd8, 0xcf, 0xb4, 0x45, 0x3f, 0x92, 0xee, 0x54 },
+    { 0xd6, 0x76, 0x28, 0x90, 0xbf, 0x26, 0xe4, 0x60 },
+    { 0x31, 0x35, 0x63, 0xa4, 0xb7, 0xed, 0x5c, 0xf3 },
+    { 0xf9, 0x0b, 0x3a, 0xb5, 0x72, 0xd4, 0x66, 0x93 },
+    { 0x2e, 0xa6, 0x3c, 0x71, 0xbf, 0x32, 0x60, 0x87 },
+};
+
+static uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void test_vectors(void)
+{
+    const uint32_t key[HALFSIPHASH_KEY_WORDS] = { 0x03020100, 0x07060504 };
+    /* the messages at a word aligned and at a misaligned address */
+    uint32_t aligned[VECTORS / 4];
+    uint8_t misaligned[VECTORS + 1];
+    uint8_t *msg = (uint8_t*)aligned;
+    uint64_t mac;
+    uint32_t i;
+
+    for (i = 0; i < VECTORS; i++) {
+        msg[i] = (uint8_t)i;
+        misaligned[i + 1] = (uint8_t)i;
+    }
+    for (i = 0; i < VECTORS; i++) {
+        mac = halfsiphash_2_4_64(key, msg, i);
+        TEST_CHECK_EQ((uint32_t)mac, load_le32(&vectors[i][0]));
+        TEST_CHECK_EQ((uint32_t)(mac >> 32), load_le32(&vectors[i][4]));
+        mac = halfsiphash_2_4_64(key, &misaligned[1], i);
+        TEST_CHECK_EQ((uint32_t)mac, load_le32(&vectors[i][0]));
+        TEST_CHECK_EQ((uint32_t)(mac >> 32), load_le32(&vectors[i][4]));
+    }
+}
+
+/* a control flow step: flow = MAC(key, flow || state), or flow += hash(state) */
+static void test_bench(void)
+{
+    const uint32_t key[HALFSIPHASH_KEY_WORDS] = { test_rand(), test_rand() };
+    volatile uint64_t flow = ((uint64_t)test_rand() << 32) | test_rand();
+    uint32_t msg[3];
+
+    TEST_BENCH("control flow step, SHA-256 state hash", 10000,
+               flow += hash_state(test_rand()));
+    TEST_BENCH("control flow step, HalfSipHash-2-4", 10000,
+               msg[0] = (uint32_t)flow;
+               msg[1] = (uint32_t)(flow >> 32);
+               msg[2] = test_rand();
+               flow = halfsiphash_2_4_64(key, (const uint8_t*)msg, sizeof(msg)));
+}
+
+int main(void)
+{
+    test_vectors();
+    test_bench();
+    return test_end("halfsiphash");
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * SHA-256 backend on the HASH processor register model: reference vectors,
+ * and libecc equivalence for any input alignment and update split.
+ */
+#include <string.h>
+
+#include "test.h"
+#include "loader_sha256.h"
+
+#if !defined(CONFIG_LOADER_SHA256_HW_MODEL)
+# error "this test requires CONFIG_LOADER_SHA256_HW_MODEL"
+#endif
+
+/* FIPS 180-2 examples */
+static const struct {
+    const char *msg;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+} sha256_vectors[] = {
+    { "", {
+        0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
+        0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+        0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+        0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55 } },
+    { "abc", {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+        0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+        0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad } },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", {
+        0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8,
+        0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+        0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+        0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1 } }
+};
+
+static uint8_t buf[1100] __attribute__((aligned(4)));
+
+static void test_vectors(void)
+{
+    loader_sha256_context ctx;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint32_t len;
+    uint32_t i;
+    uint32_t off;
+
+    for (i = 0; i < (sizeof(sha256_vectors) / sizeof(sha256_vectors[0])); i++) {
+        len = strlen(sha256_vectors[i].msg);
+        /* every input alignment */
+        for (off = 0; off < 4; off++) {
+            memcpy(&buf[off], sha256_vectors[i].msg, len);
+            loader_sha256_init(&ctx);
+            loader_sha256_update(&ctx, &buf[off], len);
+            TEST_CHECK_EQ(loader_sha256_final(&ctx, digest), 0);
+            TEST_CHECK(memcmp(digest, sha256_vectors[i].digest, sizeof(digest)) == 0);
+        }
+    }
+}
+
+/* random lengths, alignments and splits in two or three updates */
+static void test_splits(void)
+{
+    loader_sha256_context ctx;
+    sha256_context ref;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t expected[SHA256_DIGEST_SIZE];
+    uint32_t round;
+    uint32_t off;
+    uint32_t len;
+    uint32_t cut1;
+    uint32_t cut2;
+
+    for (round = 0; round < 2000; round++) {
+        off = test_rand() % 4;
+        len = test_rand() % (sizeof(buf) - 4);
+        cut1 = (len > 0) ? test_rand() % (len + 1) : 0;
+        cut2 = cut1 + ((len > cut1) ? test_rand() % (len - cut1 + 1) : 0);
+        test_rand_fill(&buf[off], len);
+
+        sha256_init(&ref);
+        sha256_update(&ref, &buf[off], len);
+        sha256_final(&ref, expected);
+
+        loader_sha256_init(&ctx);
+        loader_sha256_update(&ctx, &buf[off], cut1);
+        loader_sha256_update(&ctx, &buf[off + cut1], cut2 - cut1);
+        loader_sha256_update(&ctx, &buf[off + cut2], len - cut2);
+        TEST_CHECK_EQ(loader_sha256_final(&ctx, digest), 0);
+        if (memcmp(digest, expected, sizeof(digest)) != 0) {
+            fprintf(stderr, "mismatch: offset %u, length %u, splits %u %u\n",
+                    off, len, cut1, cut2);
+            TEST_CHECK(0);
+        }
+    }
+}
+
+int main(void)
+{
+    test_vectors();
+    test_splits();
+    return test_end("sha256");
+}
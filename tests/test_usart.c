@@ -0,0 +1,174 @@
+/*
+ * Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+ *   - Ryad     Benadjila
+ *   - Arnauld  Michelizza
+ *   - Mathieu  Renard
+ *   - Philippe Thierry
+ *   - Philippe Trebuchet
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of mosquitto nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * USART baudrate divider: USART_BAUD_CYCLES(), USART_BAUD_OVER8() and
+ * USART_BAUD_ERROR() on the bus clock of each USART, given by
+ * soc_usart_get_bus_clock(), and the BRR value of soc_usart_set_baudrate().
+ */
+#include "test.h"
+#include "soc-usart.h"
+#include "soc-usart-regs.h"
+
+/* the Kconfig console baudrates, then a few other common ones */
+static const uint32_t console_baudrates[] = {
+    115200, 230400, 460800, 921600, 1000000, 2000000, 3000000, 5250000,
+    10500000
+};
+
+static const uint32_t other_baudrates[] = {
+    2400, 4800, 9600, 19200, 38400, 57600, 1500000, 4000000, 4500000
+};
+
+/* baudrate error with this number of cycles per bit, times the cycles */
+static uint64_t baud_error(uint32_t fck, uint32_t baud, uint64_t cycles)
+{
+    return (fck > cycles * baud) ? fck - cycles * baud : cycles * baud - fck;
+}
+
+/* the number of cycles per bit giving the nearest baudrate, by search */
+static uint32_t nearest_cycles(uint32_t fck, uint32_t baud)
+{
+    uint32_t best = 8;
+    uint64_t best_err = baud_error(fck, baud, 8);
+    uint32_t cycles;
+    uint64_t err;
+
+    for (cycles = 9; cycles <= 0xffff; cycles++) {
+        err = baud_error(fck, baud, cycles);
+        if (err * best < best_err * cycles) {
+            best = cycles;
+            best_err = err;
+        }
+    }
+    return best;
+}
+
+static void check_baudrate(uint8_t usart, uint32_t baud, bool console)
+{
+    usart_config_t config = { .usart = usart, .baudrate = baud };
+    uint32_t fck = soc_usart_get_bus_clock(&config);
+    uint32_t cycles = (uint32_t)USART_BAUD_CYCLES(fck, baud);
+    uint32_t error = (uint32_t)USART_BAUD_ERROR(fck, baud);
+    uint32_t brr;
+    double rate;
+
+    if (console) {
+        /* the debug.c build time checks of a console baudrate */
+        TEST_CHECK(cycles >= 8 || (fck == PROD_CLOCK_APB1 && baud > fck / 8));
+        if (cycles < 8) {
+            return;
+        }
+        TEST_CHECK(error <= 200);
+    }
+    TEST_CHECK_EQ(cycles, nearest_cycles(fck, baud));
+    rate = (double)fck / cycles;
+    TEST_CHECK_EQ(error, (uint32_t)(((rate > baud) ? rate - baud : baud - rate)
+                                    * 10000 / baud));
+
+    /* BRR, as decoded by the USART, gives back the cycles per bit */
+    if (USART_BAUD_OVER8(fck, baud)) {
+        config.options_cr1 = USART_CR1_OVER8_Msk;
+    }
+    soc_usart_set_baudrate(&config);
+    brr = read_reg_value(r_CORTEX_M_USART_BRR(usart));
+    if (USART_BAUD_OVER8(fck, baud)) {
+        TEST_CHECK(cycles < 16);
+        TEST_CHECK_EQ(brr & 0x8, 0);
+        TEST_CHECK_EQ(((brr >> 4) * 8) + (brr & 0x7), cycles);
+    } else {
+        TEST_CHECK(cycles >= 16);
+        TEST_CHECK_EQ(brr, cycles);
+    }
+}
+
+static void test_bus_clock(void)
+{
+    usart_config_t config = { 0 };
+    uint8_t usart;
+
+    for (usart = 1; usart <= 6; usart++) {
+        config.usart = usart;
+        TEST_CHECK_EQ(soc_usart_get_bus_clock(&config),
+                      (usart == 1 || usart == 6) ? PROD_CLOCK_APB2 : PROD_CLOCK_APB1);
+    }
+}
+
+static void test_baudrates(void)
+{
+    uint8_t usart;
+    uint32_t i;
+
+    for (usart = 1; usart <= 6; usart++) {
+        for (i = 0; i < sizeof(console_baudrates) / sizeof(console_baudrates[0]); i++) {
+            check_baudrate(usart, console_baudrates[i], true);
+        }
+        for (i = 0; i < sizeof(other_baudrates) / sizeof(other_baudrates[0]); i++) {
+            check_baudrate(usart, other_baudrates[i], false);
+        }
+    }
+}
+
+/* the divider rounding, on every baudrate from fck / 0xffff to fck / 8 */
+static void test_rounding(void)
+{
+    const uint32_t clocks[] = { PROD_CLOCK_APB1, PROD_CLOCK_APB2 };
+    uint32_t failures = 0;
+    uint32_t baud;
+    uint32_t fck;
+    uint64_t cycles;
+    uint64_t err;
+    uint32_t i;
+
+    for (i = 0; i < 2; i++) {
+        fck = clocks[i];
+        for (baud = fck / 0xffff + 1; baud <= fck / 8; baud++) {
+            cycles = USART_BAUD_CYCLES(fck, baud);
+            err = baud_error(fck, baud, cycles);
+            /* no neighbour gives a nearer baudrate */
+            if (err * (cycles + 1) > baud_error(fck, baud, cycles + 1) * cycles ||
+                err * (cycles - 1) > baud_error(fck, baud, cycles - 1) * cycles) {
+                failures++;
+            }
+        }
+    }
+    TEST_CHECK_EQ(failures, 0);
+}
+
+int main(void)
+{
+    test_bus_clock();
+    test_baudrates();
+    test_rounding();
+    return test_end("usart");
+}
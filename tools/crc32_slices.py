@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+#
+# Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+#
+# This software is published under a dual license form: LGPL2.1+ or BSD3
+# clause on the user's choice.
+#
+"""
+Print the slice-by-8 CRC32 tables of src/crc32.c (crc32_slices[][]):
+
+    crc32_slices.py > slices.txt
+
+crc32_slices[k - 1][i] is the CRC32 register update of the i byte followed
+by k null bytes, the slice 0 being crc32_tab (reflected 0x04c11db7
+polynomial).
+"""
+
+CRC32_POLY = 0xedb88320
+
+
+def crc32_tab():
+    tab = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ CRC32_POLY if crc & 1 else crc >> 1
+        tab.append(crc)
+    return tab
+
+
+def crc32_slices(tab):
+    slices = [[0] * 256 for _ in range(7)]
+    for i in range(256):
+        crc = tab[i]
+        for k in range(7):
+            crc = tab[crc & 0xff] ^ (crc >> 8)
+            slices[k][i] = crc
+    return slices
+
+
+def main():
+    slices = crc32_slices(crc32_tab())
+    print("static const uint32_t crc32_slices[7][256] =")
+    print("{")
+    for k, table in enumerate(slices):
+        print("{")
+        for i in range(0, 256, 8):
+            line = ", ".join("0x%08x" % v for v in table[i:i + 8])
+            print(line + ("," if i + 8 < 256 else ""))
+        print("}," if k < 6 else "}")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+#
+# Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+#
+# This software is published under a dual license form: LGPL2.1+ or BSD3
+# clause on the user's choice.
+#
+"""
+Decode the loader tokenized console output (CONFIG_LOADER_SERIAL_TOKENIZED).
+
+The format strings are read from the .dbg_fmt section of the loader ELF file,
+and the console byte stream is read from a file, a tty, or stdin:
+
+    stty -F /dev/ttyUSB0 115200 raw
+    dbg_decode.py build/armv7-m/wookey/loader/loader.elf /dev/ttyUSB0
+
+Each record is: sync (0xa5) | payload length | id (16 bits LE) | payload,
+the id being the format string offset in the .dbg_fmt section. Any other
+byte (e.g. panic() messages) is printed as is.
+"""
+
+import struct
+import sys
+
+DBG_TOKEN_SYNC = 0xa5
+DBG_TOKEN_HDR_LEN = 4
+DBG_FMT_SECTION = b".dbg_fmt"
+
+
+class DecodeError(Exception):
+    pass
+
+
+def elf_section(path, name):
+    """Return the content of the given ELF section (ELF32/ELF64, LE or BE)"""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        raise ValueError("%s: not an ELF file" % path)
+    is64 = elf[4] == 2
+    end = "<" if elf[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(end + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x3a)
+        shdr = end + "IIQQQQIIQQ"
+    else:
+        shoff, = struct.unpack_from(end + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x2e)
+        shdr = end + "IIIIIIIIII"
+    sections = [struct.unpack_from(shdr, elf, shoff + i * shentsize)
+                for i in range(shnum)]
+    # (name, type, flags, addr, offset, size, ...)
+    strtab = sections[shstrndx]
+    for sec in sections:
+        start = strtab[4] + sec[0]
+        if elf[start:elf.index(b"\0", start)] == name:
+            return elf[sec[4]:sec[4] + sec[5]]
+    raise ValueError("%s: no %s section (tokenized console disabled?)" %
+                     (path, name.decode()))
+
+
+def format_number(value, base, size, pad):
+    digits = {10: "%d", 16: "%x", 8: "%o"}[base] % value
+    if pad and len(digits) < size:
+        digits = "0" * (size - len(digits)) + digits
+    return digits
+
+
+def format_record(fmt, payload):
+    """Format a record payload the same way the loader print() does"""
+    out = []
+    pos = 0
+    i = 0
+
+    def word(nbytes):
+        nonlocal pos
+        if pos + nbytes > len(payload):
+            raise DecodeError("truncated payload")
+        val = int.from_bytes(payload[pos:pos + nbytes], "little")
+        pos += nbytes
+        return val
+
+    while i < len(fmt):
+        c = fmt[i]
+        i += 1
+        if c != "%":
+            out.append(c)
+            continue
+        size = 0
+        zero = False
+        while True:
+            if i >= len(fmt):
+                raise DecodeError("invalid format string")
+            c = fmt[i]
+            i += 1
+            if c == "%":
+                out.append("%")
+                break
+            if c == "0":
+                zero = True
+                while i < len(fmt) and fmt[i].isdigit():
+                    size = size * 10 + int(fmt[i])
+                    i += 1
+                continue
+            pad = zero and size != 0
+            if c == "d":
+                # signed values are printed as sign extended 64 bits values
+                val = word(4)
+                val = (val - (1 << 32) if val & 0x80000000 else val) % (1 << 64)
+                out.append(format_number(val, 10, size, pad))
+            elif c == "l":
+                if i < len(fmt) and fmt[i] == "l":
+                    i += 1
+                    val = word(8)
+                else:
+                    val = word(4)
+                    val = (val - (1 << 32) if val & 0x80000000 else val) % (1 << 64)
+                out.append(format_number(val, 10, size, pad))
+            elif c in "hu":
+                out.append(format_number(word(4), 10, size, pad))
+            elif c == "p":
+                out.append("0x" + format_number(word(4), 16, size, True))
+            elif c == "x":
+                out.append(format_number(word(4), 16, size, pad))
+            elif c == "o":
+                out.append(format_number(word(4), 8, size, pad))
+            elif c == "s":
+                if pad:
+                    raise DecodeError("invalid format string")
+                try:
+                    nul = payload.index(b"\0", pos)
+                except ValueError:
+                    raise DecodeError("truncated payload")
+                out.append(payload[pos:nul].decode("latin-1"))
+                pos = nul + 1
+            else:
+                raise DecodeError("invalid format string")
+            break
+    if pos != len(payload):
+        raise DecodeError("payload length mismatch")
+    return "".join(out)
+
+
+class Decoder:
+    """Incremental console stream decoder"""
+
+    def __init__(self, strings, output):
+        self.strings = strings
+        self.output = output
+        self.buf = b""
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            buf = self.buf
+            if buf[0] != DBG_TOKEN_SYNC:
+                # plain text output
+                self.output.write(buf[:1].decode("latin-1").replace("\r", ""))
+                self.buf = buf[1:]
+                continue
+            if len(buf) < DBG_TOKEN_HDR_LEN or \
+               len(buf) < DBG_TOKEN_HDR_LEN + buf[1]:
+                break
+            length = DBG_TOKEN_HDR_LEN + buf[1]
+            ident = buf[2] | (buf[3] << 8)
+            try:
+                if ident >= len(self.strings):
+                    raise DecodeError("unknown id")
+                fmt = self.strings[ident:self.strings.index(b"\0", ident)]
+                self.output.write(format_record(fmt.decode("latin-1"),
+                                                buf[DBG_TOKEN_HDR_LEN:length]))
+                self.buf = buf[length:]
+            except DecodeError as e:
+                # corrupted record (dropped bytes?): resync on next sync byte
+                self.output.write("<%s: record 0x%04x dropped>\n" % (e, ident))
+                self.buf = buf[1:]
+        self.output.flush()
+
+
+def decode(strings, stream, output):
+    decoder = Decoder(strings, output)
+    while True:
+        data = stream.read(1)
+        if not data:
+            break
+        decoder.feed(data)
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.stderr.write("usage: %s loader.elf [console_dump|tty]\n" % argv[0])
+        return 1
+    strings = elf_section(argv[1], DBG_FMT_SECTION)
+    if len(argv) == 3:
+        with open(argv[2], "rb", buffering=0) as stream:
+            decode(strings, stream, sys.stdout)
+    else:
+        decode(strings, sys.stdin.buffer, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main(sys.argv))
+    except KeyboardInterrupt:
+        sys.exit(0)
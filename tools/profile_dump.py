@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+#
+# Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+#
+# This software is published under a dual license form: LGPL2.1+ or BSD3
+# clause on the user's choice.
+#
+"""
+Print the loader boot time profile (CONFIG_LOADER_BOOT_PROFILE) from a memory
+dump holding the Backup SRAM, e.g. with openocd:
+
+    dump_image bkpsram.bin 0x40024000 0x1000
+    profile_dump.py bkpsram.bin
+
+The dump is expected to start at the Backup SRAM base address, unless another
+base address is given with -b.
+"""
+
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from swo_decode import LOADER_STATES  # noqa: E402
+
+# see src/profile.h
+BKPSRAM_BASE = 0x40024000
+PROFILE_TABLE_ADDR = BKPSRAM_BASE + 0x800
+PROFILE_MAGIC = 0x464f5250
+PROFILE_VERSION = 1
+PROFILE_MAX_MARKS = 32
+PROFILE_HDR = "<IHHII"
+PROFILE_SAMPLE = "<IIQ"
+
+PROFILE_MARKS = {
+    0xf0000001: "HDRCRC_START",
+    0xf0000002: "HDRCRC_END",
+    0xf0000003: "SHA256_START",
+    0xf0000004: "SHA256_END",
+    0xf0000005: "BKPSRAM_SCRUB_START",
+    0xf0000006: "BKPSRAM_SCRUB_END",
+    0xf0000007: "KEYBAG_COPY_START",
+    0xf0000008: "KEYBAG_COPY_END",
+    0xf00000ff: "NEXT_STAGE",
+}
+
+
+def mark_name(ident):
+    if ident in PROFILE_MARKS:
+        return PROFILE_MARKS[ident]
+    if ident in LOADER_STATES:
+        return "state => " + LOADER_STATES[ident]
+    return "0x%08x" % ident
+
+
+def parse_table(dump, offset):
+    hdr_len = struct.calcsize(PROFILE_HDR)
+    sample_len = struct.calcsize(PROFILE_SAMPLE)
+    if offset < 0 or offset + hdr_len > len(dump):
+        raise ValueError("the dump doesn't hold the profile table")
+    magic, version, count, freq, dropped = \
+        struct.unpack_from(PROFILE_HDR, dump, offset)
+    if magic != PROFILE_MAGIC:
+        raise ValueError("no profile table (invalid magic 0x%08x)" % magic)
+    if version != PROFILE_VERSION or count > PROFILE_MAX_MARKS:
+        raise ValueError("unsupported profile table (version %d, %d samples)" %
+                         (version, count))
+    if offset + hdr_len + count * sample_len > len(dump):
+        raise ValueError("truncated profile table")
+    samples = []
+    for i in range(count):
+        ident, _, cycles = struct.unpack_from(PROFILE_SAMPLE, dump,
+                                              offset + hdr_len + i * sample_len)
+        samples.append((ident, cycles))
+    return freq, dropped, samples
+
+
+def print_table(freq, dropped, samples, output):
+    # freq is in kHz: cycles / freq gives milliseconds
+    output.write("core clock: %d kHz, %d samples%s\n\n" %
+                 (freq, len(samples),
+                  (", %d dropped" % dropped) if dropped else ""))
+    output.write("%3s  %-32s %12s %10s %12s %10s\n" %
+                 ("#", "mark", "cycles", "time (ms)", "delta", "delta (ms)"))
+    prev = None
+    for i, (ident, cycles) in enumerate(samples):
+        delta = cycles - prev if prev is not None else 0
+        output.write("%3d  %-32s %12d %10.3f %12d %10.3f\n" %
+                     (i, mark_name(ident), cycles, cycles / freq,
+                      delta, delta / freq))
+        prev = cycles
+    # phases durations
+    starts = {}
+    phases = []
+    for ident, cycles in samples:
+        name = PROFILE_MARKS.get(ident, "")
+        if name.endswith("_START"):
+            starts[name[:-6]] = cycles
+        elif name.endswith("_END") and name[:-4] in starts:
+            phases.append((name[:-4], cycles - starts.pop(name[:-4])))
+    if phases:
+        output.write("\n%-32s %12s %10s\n" % ("phase", "cycles", "time (ms)"))
+        for name, cycles in phases:
+            output.write("%-32s %12d %10.3f\n" % (name, cycles, cycles / freq))
+
+
+def main(argv):
+    args = argv[1:]
+    base = BKPSRAM_BASE
+    if len(args) >= 2 and args[0] == "-b":
+        base = int(args[1], 0)
+        args = args[2:]
+    if len(args) != 1:
+        sys.stderr.write("usage: %s [-b dump_base_address] memory_dump\n" % argv[0])
+        return 1
+    with open(args[0], "rb") as f:
+        dump = f.read()
+    try:
+        freq, dropped, samples = parse_table(dump, PROFILE_TABLE_ADDR - base)
+    except ValueError as e:
+        sys.stderr.write("%s: %s\n" % (args[0], e))
+        return 1
+    print_table(freq, dropped, samples, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
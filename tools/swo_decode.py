@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+#
+# Copyright 2019 The wookey project team <wookey@ssi.gouv.fr>
+#
+# This software is published under a dual license form: LGPL2.1+ or BSD3
+# clause on the user's choice.
+#
+"""
+Decode the loader ITM/SWO trace output (CONFIG_LOADER_CONSOLE_BACKEND_ITM).
+
+The SWO stream (TPIU formatter bypassed) is read from a file, a tty, or stdin,
+e.g. as captured by openocd:
+
+    tpiu config internal swo.log uart off 168000000 2000000
+    swo_decode.py swo.log
+
+The loader ITM stimulus ports are:
+- port 0: console output
+- port 1: automaton states (32 bits), at each state transition
+- port 2: DWT cycle counter (32 bits), just before each log and state
+  transition
+
+Each log and state transition is printed with its timestamp, in cycles. When
+the loader is built with a tokenized console (CONFIG_LOADER_SERIAL_TOKENIZED),
+the loader ELF file must be given with -e to decode the console output.
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import dbg_decode  # noqa: E402
+
+ITM_PORT_CONSOLE = 0
+ITM_PORT_STATE = 1
+ITM_PORT_TIMESTAMP = 2
+
+# see src/automaton.h
+LOADER_STATES = {
+    0x00000003: "LOADER_START",
+    0x0000000c: "LOADER_INIT",
+    0x00000035: "LOADER_RDPCHECK",
+    0x000000ca: "LOADER_DFUWAIT",
+    0x00000350: "LOADER_SELECTBANK",
+    0x00000ca3: "LOADER_HDRCRC",
+    0x000035cf: "LOADER_FWINTEGRITY",
+    0x0000ca0c: "LOADER_FLASHLOCK",
+    0x00035c30: "LOADER_BOOTFW",
+    0x000ca3f3: "LOADER_ERROR",
+    0x0035cfcf: "LOADER_SECBREACH",
+}
+
+
+class TimestampedOutput:
+    """Console output, prefixing the lines of each log with its timestamp"""
+
+    def __init__(self, output):
+        self.output = output
+        self.timestamp = None
+        self.newline = True
+
+    def write(self, text):
+        for c in text:
+            if self.newline:
+                if self.timestamp is not None:
+                    self.output.write("[%10d] " % self.timestamp)
+                else:
+                    self.output.write(" " * 13)
+                self.newline = False
+            self.output.write(c)
+            if c == "\n":
+                self.newline = True
+                self.timestamp = None
+
+    def event(self, text):
+        timestamp = self.timestamp
+        if not self.newline:
+            self.write("\n")
+        self.timestamp = timestamp
+        self.write(text + "\n")
+
+    def flush(self):
+        self.output.flush()
+
+
+class TextDecoder:
+    """Plain text console stream decoder"""
+
+    def __init__(self, output):
+        self.output = output
+
+    def feed(self, data):
+        self.output.write(data.decode("latin-1").replace("\r", ""))
+        self.output.flush()
+
+
+def itm_packets(stream):
+    """Yield the (port, payload) instrumentation packets of an SWO stream"""
+    while True:
+        header = stream.read(1)
+        if not header:
+            return
+        header = header[0]
+        if header == 0x00 or header == 0x80:
+            # synchronization packet
+            continue
+        if header == 0x70:
+            yield (None, b"overflow")
+            continue
+        size = header & 0x3
+        if size == 0:
+            # protocol packet (timestamp, extension): skip continuation bytes
+            cont = header & 0x80
+            while cont:
+                byte = stream.read(1)
+                if not byte:
+                    return
+                cont = byte[0] & 0x80
+            continue
+        payload = stream.read({1: 1, 2: 2, 3: 4}[size])
+        if header & 0x4:
+            # hardware source (DWT) packet
+            continue
+        yield (header >> 3, payload)
+
+
+def decode(stream, console, output):
+    for port, payload in itm_packets(stream):
+        if port is None:
+            output.event("<ITM overflow, trace data lost>")
+        elif port == ITM_PORT_CONSOLE:
+            console.feed(payload)
+        elif port == ITM_PORT_TIMESTAMP:
+            output.timestamp = int.from_bytes(payload, "little")
+        elif port == ITM_PORT_STATE:
+            state = int.from_bytes(payload, "little")
+            output.event("state => %s" %
+                         LOADER_STATES.get(state, "0x%08x" % state))
+        output.flush()
+
+
+def main(argv):
+    args = argv[1:]
+    elf = None
+    if len(args) >= 2 and args[0] == "-e":
+        elf = args[1]
+        args = args[2:]
+    if len(args) > 1:
+        sys.stderr.write("usage: %s [-e loader.elf] [swo_dump|tty]\n" % argv[0])
+        return 1
+    output = TimestampedOutput(sys.stdout)
+    if elf is not None:
+        strings = dbg_decode.elf_section(elf, dbg_decode.DBG_FMT_SECTION)
+        console = dbg_decode.Decoder(strings, output)
+    else:
+        console = TextDecoder(output)
+    if args:
+        with open(args[0], "rb", buffering=0) as stream:
+            decode(stream, console, output)
+    else:
+        decode(sys.stdin.buffer, console, output)
+    return 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main(sys.argv))
+    except KeyboardInterrupt:
+        sys.exit(0)